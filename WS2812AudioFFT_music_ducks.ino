@@ -6,27 +6,11 @@
 #include <EEPROM.h>
 #include <SPI.h>
 #include <SD.h>
-#include <vector>
 #include <WS2812Serial.h>
 #include <Audio.h>
 #include <Snooze.h>
 #include <FastLED.h>
 
-namespace std {
-  void __throw_bad_alloc()
-  {
-    Serial.println("Unable to allocate memory");
-    for(;;);
-  }
-
-  void __throw_length_error( char const*e )
-  {
-    Serial.print("Length Error :");
-    Serial.println(e);
-    for(;;);
-  }
-}
-
 ///// Requirements:
 /// * newest FastLED from GitHub (master branch > 3.1.6)
 /// * PJRC Audio (included in Teensyduino)
@@ -46,15 +30,54 @@ namespace std {
 
 #define PHOTORESISTOR_PIN 17
 
+// #define USE_PROFILER  //cycle histograms per animation and task, see profiler.h and Serial command p
+// #define USE_SD_CARD  //replay audio files from SD card instead of the microphone, see audio_replay.h
+//SD card on the audio board, MISO moved from 12 (button) to 8
+#define SDCARD_CS_PIN 10
+#define SDCARD_MOSI_PIN 7
+#define SDCARD_MISO_PIN 8
+#define SDCARD_SCK_PIN 14
+#define REPLAY_FILENAME "REPLAY.WAV"
+#define RECORD_FILENAME "RECORD.LED"  //frames and audio features, see sd_recording.h and Serial command w
+#define PLAYBACK_FILENAME "SHOW.LED"  //played by anim_sd_playback, e.g. generated by tools/ledrec.py
+
+#ifndef NUM_LEDS //host builds benchmark other lengths, see CMakeLists.txt
 #define NUM_LEDS 150
-#define BUTTON_DEBOUNCE  500
-#define LIGHT_THRESHOLD (500*3300/4096)  //500mV
-#define LIGHT_DEBOUNCE 50000
-
-#define EEPROM_CURRENT_VERSION 0
-#define EEPROM_ADDR_VERS 0
-#define EEPROM_ADDR_CURANIM 1
+#endif
+#define BUTTON_PERIOD_US 1000
+#define BUTTON_IDLE_PERIOD_US 100000 //while released, a pin interrupt makes the button task due
+#define BUTTON_DEBOUNCE  50  //in BUTTON_PERIOD_US ticks, i.e. 50ms
+#define LIGHT_PERIOD_US 100000  //10Hz
+#define LIGHT_DARK_MV 450  //darkness once the filtered level drops below, see light_sensor.h
+#define LIGHT_BRIGHT_MV 550  //daylight once it rises above
+#define LIGHT_TIME_CONSTANT_MS 1000
+#define AMBIENT_BRIGHTNESS_MIN 128  //global brightness scale in pitch dark, up to 255 at LIGHT_BRIGHT_MV. Only with PHOTORESISTOR_USE_ADC
+#define HEARTBEAT_ON_US 20000
+#define HEARTBEAT_OFF_US 1980000
+
+#define SETTINGS_VERSION 1  //bump when struct Settings changes, old records are ignored then
+#define SETTINGS_EEPROM_START 0
+#define SETTINGS_EEPROM_SIZE 2048  //all of the Teensy 3.2 EEPROM, see settings_store.h
+//before the settings store: a version byte and the current animation
+#define EEPROM_LEGACY_VERSION 0
+#define EEPROM_LEGACY_ADDR_VERS 0
+#define EEPROM_LEGACY_ADDR_CURANIM 1
+
+//// audio analysis: PJRC Audio, or our own sampling and FFT (see audio_capture.h, fixed_fft.h)
+#define USE_PJRC_AUDIO 1
+#ifndef USE_PJRC_AUDIO
+#define USE_FIXED_FFT 1
+#endif
+#if defined(USE_PJRC_AUDIO) || defined(USE_FIXED_FFT)
+#define USE_AUDIO 1
+#endif
+// #define USE_OVERLAP_FFT  //PJRC Audio: spectra from fixed_fft.h with the settings below instead of AudioAnalyzeFFT256
+#define FFT_SIZE 256 //PJRC Audio: always 256, USE_FIXED_FFT/USE_OVERLAP_FFT: 128, 256 or 512
+// #define FIXED_FFT_HOP (FFT_SIZE/4)  //an FFT every hop samples, default FFT_SIZE/2 (50% overlap)
+// #define FIXED_FFT_AVERAGE 1  //FFTs per spectrum, default 8. Less latency, more CPU, see fixed_fft.h
+// #define FIXED_FFT_WINDOW FFT_WINDOW_HAMMING  //default FFT_WINDOW_HANN
 
+#ifdef USE_PJRC_AUDIO
 // GUItool: begin automatically generated code
 #ifdef PHOTORESISTOR_USE_ADC
 AudioInputAnalogStereo   adc_stereo(MICROPHONE_AIN, PHOTORESISTOR_AIN);          //xy=70.33332824707031,228.33334350585938
@@ -62,7 +85,9 @@ AudioInputAnalogStereo   adc_stereo(MICROPHONE_AIN, PHOTORESISTOR_AIN);
 AudioInputAnalog   		 adc_stereo(MICROPHONE_AIN);          //xy=70.33332824707031,228.33334350585938
 #endif
 AudioAnalyzeRMS          audioRMS;           //xy=297.33331298828125,201.33334350585938
+#ifndef USE_OVERLAP_FFT
 AudioAnalyzeFFT256       audioFFT;       //xy=305.33331298828125,240.33334350585938
+#endif
 AudioAnalyzePeak         audioPeak;
 #ifdef PHOTORESISTOR_USE_ADC
 AudioAnalyzePeak         photoPeak;          //xy=310.33331298828125,287.33331298828125
@@ -70,7 +95,9 @@ AudioAnalyzePeak         photoPeak;          //xy=310.33331298828125,287.3333129
 //AudioOutputAnalog        dac1;           //xy=329,47 --> DAC Pin
 //AudioOutputUSB           usb1;           //xy=220.3333282470703,342.3333282470703
 AudioConnection          patchCord1(adc_stereo, 0, audioRMS, 0);
+#ifndef USE_OVERLAP_FFT
 AudioConnection          patchCord2(adc_stereo, 0, audioFFT, 0);
+#endif
 AudioConnection          patchCord3(adc_stereo, 0, audioPeak, 0);
 #ifdef PHOTORESISTOR_USE_ADC
 AudioConnection          patchCord4(adc_stereo, 1, photoPeak, 0);
@@ -79,14 +106,22 @@ AudioConnection          patchCord4(adc_stereo, 1, photoPeak, 0);
 //AudioConnection          patchCord6(adc_stereo, 1, usb1, 1);
 //AudioConnection          patchCord7(adc_stereo, 0, dac1, 0);
 // GUItool: end automatically generated code
-
-#define FFT_SIZE 256
+#ifdef USE_OVERLAP_FFT
+AudioRecordQueue         audioQueue;
+AudioConnection          patchCord8(adc_stereo, 0, audioQueue, 0);
+#endif
+#endif
 
 
-CRGB leds_[NUM_LEDS];
+//// framebuffers: leds_ points to the one the current animation renders into,
+//// the second one and leds_out_ are only used while crossfading between animations
+CRGB framebuffers_[2][NUM_LEDS];
+CRGB leds_out_[NUM_LEDS];
+CRGB *leds_ = framebuffers_[0];
+uint32_t leds_origin_ = 0; //physical position of leds_[0], see RotatingStrip
 bool is_dark_=true;
-int32_t dark_count_=0;
-uint16_t light_level=0;
+#include "light_sensor.h"
+LightSensor light_sensor_(LIGHT_DARK_MV, LIGHT_BRIGHT_MV, LIGHT_TIME_CONSTANT_MS, LIGHT_PERIOD_US);
 
 //// define Sleep Config
 
@@ -95,108 +130,228 @@ SnoozeDigital sleep_digital_;
 SnoozeBlock sleep_config_(sleep_timer_,sleep_digital_);
 
 //// define Animations
-#define USE_PJRC_AUDIO 1
+#include "crossfade.h"
+Crossfade crossfade_(framebuffers_[0], framebuffers_[1], leds_out_);
 #include "animations.h"
+#include "fixed_fft.h"
+#include "scheduler.h"
+#include "strip_layout.h"
+#if defined(USE_FIXED_FFT) || defined(USE_OVERLAP_FFT)
+FixedFFTAnalyzer<FFT_SIZE, FIXED_FFT_HOP, FIXED_FFT_AVERAGE> fft_analyzer_(FIXED_FFT_WINDOW);
+#endif
+#ifdef USE_FIXED_FFT
+#include "audio_capture.h"
+#endif
+#if defined(USE_SD_CARD) && defined(USE_PJRC_AUDIO)
+#include "audio_replay.h"
+AudioReplay audio_replay_;
+#endif
+
+//// physical LED layout, one segment per WS2812Serial pin, see strip_layout.h
+StripSegment strip_segments_[] = {
+	//first, count, reversed
+	{0, NUM_LEDS, false},
+};
+StripLayout strip_layout_(strip_segments_, sizeof(strip_segments_)/sizeof(StripSegment));
+#include "benchmark.h"
+#include "frame_stream.h"
+FrameStream frame_stream_;
+#include "golden.h"
+#ifdef USE_SD_CARD
+#include "sd_recording.h"
+SDRecorder sd_recorder_;
+#endif
 
 AnimationBlackSleepTeensy anim_fade_to_black(sleep_config_);
 AnimationPlasma anim_plasma;
-RunOnlyInDarkness anim_plasma_when_dark(anim_plasma, anim_fade_to_black);
-#ifdef USE_PJRC_AUDIO
+auto anim_plasma_when_dark = runOnlyInDarkness(anim_plasma, anim_fade_to_black);
+#ifdef USE_AUDIO
 AnimationRMSHue anim_rms_hue;
 AnimationRMSConfetti anim_rms_confetti;
-RunOnlyInDarkness anim_rms_confetti_when_dark(anim_rms_confetti, anim_fade_to_black);
+auto anim_rms_confetti_when_dark = runOnlyInDarkness(anim_rms_confetti, anim_fade_to_black);
 AnimationFullFFT anim_fft_full_and_boring;
 AnimationFFTOctaves anim_fft_octaves;
-RunOnlyInDarkness anim_fft_octaves_when_dark(anim_fft_octaves, anim_fade_to_black);
-RunOnlyInDarkness anim_rms_hue_when_dark(anim_rms_hue, anim_fade_to_black);
+auto anim_fft_octaves_when_dark = runOnlyInDarkness(anim_fft_octaves, anim_fade_to_black);
+auto anim_rms_hue_when_dark = runOnlyInDarkness(anim_rms_hue, anim_fade_to_black);
 #endif
 AnimationGravityDots anim_gravity_dots;
-RunOnlyInDarkness anim_gravity_dots_when_dark(anim_gravity_dots, anim_fade_to_black);
+auto anim_gravity_dots_when_dark = runOnlyInDarkness(anim_gravity_dots, anim_fade_to_black);
 AnimationFireworks anim_fireworks;
-RunOnlyInDarkness anim_fireworks_when_dark(anim_fireworks, anim_fade_to_black);
+auto anim_fireworks_when_dark = runOnlyInDarkness(anim_fireworks, anim_fade_to_black);
 AnimationFire2012 anim_fire2012;
-RunOnlyInDarkness anim_fire2012_when_dark(anim_fire2012, anim_fade_to_black);
+auto anim_fire2012_when_dark = runOnlyInDarkness(anim_fire2012, anim_fade_to_black);
 AnimationRainbowGlitter anim_rainbow(false);
-RunOnlyInDarkness anim_rainbow_when_dark(anim_rainbow, anim_fade_to_black);
+auto anim_rainbow_when_dark = runOnlyInDarkness(anim_rainbow, anim_fade_to_black);
 AnimationConfetti anim_confetti;
-RunOnlyInDarkness anim_confetti_when_dark(anim_confetti, anim_fade_to_black);
+auto anim_confetti_when_dark = runOnlyInDarkness(anim_confetti, anim_fade_to_black);
 AnimationRainbowGlitter anim_rainbow_w_glitter(true);
-RunOnlyInDarkness anim_rainbow_w_glitter_when_dark(anim_rainbow_w_glitter, anim_fade_to_black);
+auto anim_rainbow_w_glitter_when_dark = runOnlyInDarkness(anim_rainbow_w_glitter, anim_fade_to_black);
 AnimationPhotosensorDebugging anim_photoresistor_debugging;
 AnimationStripTest anim_strip_debugging;
+#ifdef USE_SD_CARD
+AnimationSDPlayback anim_sd_playback(PLAYBACK_FILENAME);
+#endif
 AnimationCampingLight anim_camping_light;
-RunOnlyInDarkness anim_camping_light_when_dark(anim_camping_light, anim_fade_to_black);
+auto anim_camping_light_when_dark = runOnlyInDarkness(anim_camping_light, anim_fade_to_black);
 AnimationJustMaximumLight anim_maximum_light;
-RunOnlyInDarkness anim_maximum_light_when_dark(anim_maximum_light, anim_fade_to_black);
-std::vector<BaseAnimation*> collection_of_nice_animations1 =
-	{&anim_plasma,&anim_fireworks
-	,&anim_rainbow_w_glitter
-	,&anim_confetti,&anim_fire2012
-	};
-AutoSwitchAnimationCollection anim_collection_switcher1(1000*60*1,collection_of_nice_animations1);
-RunOnlyInDarkness anim_darkness_auto_collection1(anim_collection_switcher1, anim_fade_to_black);
-#ifdef USE_PJRC_AUDIO
-std::vector<BaseAnimation*> collection_of_audio_animations2 =
-	{&anim_rms_confetti
-	,&anim_fft_octaves
-	,&anim_rms_hue};
-AutoSwitchAnimationCollection anim_collection_switcher2(1000*60*2,collection_of_audio_animations2);
-RunOnlyInDarkness anim_darkness_auto_collection2(anim_collection_switcher2, anim_fade_to_black);
+auto anim_maximum_light_when_dark = runOnlyInDarkness(anim_maximum_light, anim_fade_to_black);
+auto anim_collection_switcher1 = autoSwitchAnimationCollection(1000*60*1
+	,anim_plasma,anim_fireworks
+	,anim_rainbow_w_glitter
+	,anim_confetti,anim_fire2012
+	);
+auto anim_darkness_auto_collection1 = runOnlyInDarkness(anim_collection_switcher1, anim_fade_to_black);
+#ifdef USE_AUDIO
+auto anim_collection_switcher2 = autoSwitchAnimationCollection(1000*60*2
+	,anim_rms_confetti
+	,anim_fft_octaves
+	,anim_rms_hue);
+auto anim_darkness_auto_collection2 = runOnlyInDarkness(anim_collection_switcher2, anim_fade_to_black);
 #endif
 
-std::vector<BaseAnimation*> animations_list_=
-	{
-#ifdef USE_PJRC_AUDIO
-	 &anim_fft_octaves
-	,&anim_fft_octaves_when_dark
-	,&anim_rms_hue
-	,&anim_rms_hue_when_dark
-	,&anim_rms_confetti
-	,&anim_rms_confetti_when_dark
+auto animations_ = makeAnimationRegistry(
+#ifdef USE_AUDIO
+	 anim_fft_octaves
+	,anim_fft_octaves_when_dark
+	,anim_rms_hue
+	,anim_rms_hue_when_dark
+	,anim_rms_confetti
+	,anim_rms_confetti_when_dark
 	,
 #endif
-	&anim_plasma
-	,&anim_plasma_when_dark
-	,&anim_gravity_dots
-	,&anim_gravity_dots_when_dark
-	,&anim_fireworks
-	,&anim_fireworks_when_dark
-	,&anim_fire2012
-	,&anim_fire2012_when_dark
-	,&anim_rainbow
-	,&anim_rainbow_when_dark
-	,&anim_confetti
-	,&anim_confetti_when_dark
-	,&anim_rainbow_w_glitter
-	,&anim_rainbow_w_glitter_when_dark
-#ifdef USE_PJRC_AUDIO
-	,&anim_fft_full_and_boring
+	anim_plasma
+	,anim_plasma_when_dark
+	,anim_gravity_dots
+	,anim_gravity_dots_when_dark
+	,anim_fireworks
+	,anim_fireworks_when_dark
+	,anim_fire2012
+	,anim_fire2012_when_dark
+	,anim_rainbow
+	,anim_rainbow_when_dark
+	,anim_confetti
+	,anim_confetti_when_dark
+	,anim_rainbow_w_glitter
+	,anim_rainbow_w_glitter_when_dark
+#ifdef USE_AUDIO
+	,anim_fft_full_and_boring
 #endif
-	,&anim_photoresistor_debugging
-	,&anim_strip_debugging
-	,&anim_darkness_auto_collection1
-	,&anim_camping_light_when_dark
-#ifdef USE_PJRC_AUDIO
-	,&anim_darkness_auto_collection2
+	,anim_photoresistor_debugging
+	,anim_strip_debugging
+	,anim_darkness_auto_collection1
+	,anim_camping_light_when_dark
+#ifdef USE_AUDIO
+	,anim_darkness_auto_collection2
+#endif
+	,anim_maximum_light_when_dark
+#ifdef USE_SD_CARD
+	,anim_sd_playback
 #endif
-	,&anim_maximum_light_when_dark
-	};
+	);
 
 uint8_t animation_current_= 1;
-#define NUM_ANIM animations_list_.size()
+uint8_t animation_previous_= 1;
+#define NUM_ANIM animations_.size()
+
+//// only run by the golden frame check (Serial command g, see golden.h):
+//// animations in no list above, and collections that switch within its run
+AnimationFireRing anim_fire_ring;
+AnimationTOCFairyDustLandingRing anim_toc_landing_ring;
+AnimationTOCFairyDustFire anim_toc_fire;
+AnimationBreatheLight anim_breathe_light;
+AnimationBatteryIndicator anim_battery_indicator(180);
+auto anim_golden_switcher1 = autoSwitchAnimationCollection(GOLDEN_SWITCH_MS
+	,anim_plasma,anim_fireworks
+	,anim_rainbow_w_glitter
+	,anim_confetti,anim_fire2012
+	);
+#ifdef USE_AUDIO
+auto anim_golden_switcher2 = autoSwitchAnimationCollection(GOLDEN_SWITCH_MS
+	,anim_rms_confetti
+	,anim_fft_octaves
+	,anim_rms_hue);
+#endif
+auto golden_extras_ = makeAnimationRegistry(
+	 anim_fire_ring
+	,anim_toc_landing_ring
+	,anim_toc_fire
+	,anim_breathe_light
+	,anim_battery_indicator
+	,anim_golden_switcher1
+#ifdef USE_AUDIO
+	,anim_golden_switcher2
+#endif
+	);
+
+//// persistent settings, see settings_store.h
+#include "settings_store.h"
+struct Settings
+{
+	uint8_t animation;
+	uint8_t brightness;  //global brightness scale, 255: as the animations set it
+	uint16_t light_dark_mv;
+	uint16_t light_bright_mv;
+	uint8_t switch_minutes[2];  //auto switching collections
+};
+Settings settings_ = {1, 255, LIGHT_DARK_MV, LIGHT_BRIGHT_MV, {1, 2}};
+SettingsStore<Settings, EEPROMSettingsBackend, SETTINGS_EEPROM_START, SETTINGS_EEPROM_SIZE> settings_store_(settings_, SETTINGS_VERSION);
+
+void button_isr();
+void save_settings();
+void load_settings();
+micros_t task_heartbeat();
+micros_t task_check_button();
+#ifdef USE_SD_CARD
+micros_t task_sd_recorder()
+{
+	sd_recorder_.recordAudio();
+	sd_recorder_.service();
+	return 0;
+}
+#endif
+
+micros_t task_check_lightlevel();
+micros_t task_sample_mic();
+micros_t task_animate_leds();
+micros_t task_serial_commands();
+micros_t task_settings();
+
+SchedulerTask tasks_[] = {
+	//name, function, period_us, deadline_us
+	{"heartbeat", task_heartbeat, HEARTBEAT_OFF_US, 1000},
+	{"button", task_check_button, BUTTON_PERIOD_US, BUTTON_PERIOD_US},
+	{"light", task_check_lightlevel, LIGHT_PERIOD_US, LIGHT_PERIOD_US},
+	{"mic", task_sample_mic, 1000, 1000},
+	{"leds", task_animate_leds, 10000, 5000},
+	{"serial", task_serial_commands, 10000, 10000},
+	{"settings", task_settings, 10000, 10000},
+#ifdef USE_SD_CARD
+	{"sdcard", task_sd_recorder, 1000, 5000},
+#endif
+};
+CooperativeScheduler scheduler_(tasks_, sizeof(tasks_)/sizeof(SchedulerTask));
 
 
 // This function sets up the ledsand tells the controller about them
 void setup() {
+	cycleCounterBegin(); //for profiler and FFT timing
 #ifdef USE_PJRC_AUDIO
 	AudioMemory(12);
 	delay(2000);
 #endif
+#ifdef USE_OVERLAP_FFT
+	audioQueue.begin();
+#endif
+#ifdef USE_FIXED_FFT
+	if (!audio_capture_.begin(MICROPHONE_AIN))
+		Serial.println("# no timer for sampling");
+#endif
 
-	FastLED.addLeds<WS2812SERIAL,WS2812_PIN,GRB>(leds_,NUM_LEDS);
+	strip_layout_.attach<WS2812_PIN,GRB>(0, leds_);
 	pinMode(LED_PIN,OUTPUT);
 	digitalWrite(LED_PIN, LOW);
 	pinMode(BUTTON_PIN, INPUT_PULLUP);
+	attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), button_isr, FALLING);
 	pinMode(PHOTORESISTOR_AIN, INPUT);
 	pinMode(PHOTORESISTOR_PIN, INPUT);
 	pinMode(MICROPHONE_AIN, INPUT);
@@ -205,96 +360,185 @@ void setup() {
 	sleep_timer_.setTimer(25*1000); // check for light every 25s
 	sleep_digital_.pinMode(BUTTON_PIN, INPUT_PULLUP, FALLING); //pin, mode, type
 
+#ifdef USE_SD_CARD
+	SPI.setMOSI(SDCARD_MOSI_PIN);
+	SPI.setMISO(SDCARD_MISO_PIN);
+	SPI.setSCK(SDCARD_SCK_PIN);
+	if (!SD.begin(SDCARD_CS_PIN))
+		Serial.println("# no SD card");
+#endif
+
+	//same sequence after every boot, like FastLED's fixed random8() seed before
+	random_stream_.seed(RANDOM_STREAM_SEED);
+
 	//init animation
-	load_from_EEPROM();
-	animations_list_[animation_current_]->init();
+	load_settings();
+	animations_.init(animation_current_);
+	scheduler_.begin();
 }
 
-void save_to_EEPROM()
+/// settings_ changed, written to EEPROM later by task_settings()
+void save_settings()
 {
-  if (EEPROM.read(EEPROM_ADDR_VERS) != EEPROM_CURRENT_VERSION)
-    EEPROM.write(EEPROM_ADDR_VERS, EEPROM_CURRENT_VERSION);
-  if (animation_current_ != EEPROM.read(EEPROM_ADDR_CURANIM))
-    EEPROM.write(EEPROM_ADDR_CURANIM, animation_current_);
+	settings_.animation = animation_current_;
+	settings_store_.changed(millis());
 }
 
-void load_from_EEPROM()
+void load_settings()
 {
-  if (EEPROM.read(EEPROM_ADDR_VERS) != EEPROM_CURRENT_VERSION)
-    return;
+	if (!settings_store_.load() && EEPROM.read(EEPROM_LEGACY_ADDR_VERS) == EEPROM_LEGACY_VERSION)
+	{
+		//first boot after the update, keep the animation
+		settings_.animation = EEPROM.read(EEPROM_LEGACY_ADDR_CURANIM);
+	}
+	animation_current_ = settings_.animation % NUM_ANIM;
+	light_sensor_.setThresholds(settings_.light_dark_mv, settings_.light_bright_mv);
+	anim_collection_switcher1.setSwitchInterval(1000UL*60*settings_.switch_minutes[0]);
+#ifdef USE_AUDIO
+	anim_collection_switcher2.setSwitchInterval(1000UL*60*settings_.switch_minutes[1]);
+#endif
+}
 
-  animation_current_ = EEPROM.read(EEPROM_ADDR_CURANIM) % NUM_ANIM;
+micros_t task_settings()
+{
+	settings_store_.service(millis());
+	return 0;
 }
 
 
-void task_check_lightlevel()
+micros_t task_check_lightlevel()
 {
+	uint16_t mv;
 #ifdef PHOTORESISTOR_USE_ADC
 #ifdef USE_PJRC_AUDIO
 	if (!photoPeak.available())
-		return;
-	light_level = photoPeak.read()*4095;
+		return 0;
+	mv = photoPeak.read()*LIGHT_SENSOR_FULL_SCALE_MV;
 #else
-	light_level = analogReadADC1(PHOTORESISTOR_AIN);
+	mv = static_cast<uint32_t>(analogReadADC1(PHOTORESISTOR_AIN))*LIGHT_SENSOR_FULL_SCALE_MV/4095;
 #endif
-	if (light_level > LIGHT_THRESHOLD)
 #else
-	if (digitalRead(PHOTORESISTOR_PIN) == LOW)
+	//comparator on the board: LOW means daylight
+	mv = (digitalRead(PHOTORESISTOR_PIN) == LOW) ? LIGHT_SENSOR_FULL_SCALE_MV : 0;
 #endif
+	light_sensor_.update(mv);
+	is_dark_ = light_sensor_.dark();
+	return 0;
+}
+
+micros_t task_sample_mic()
+{
+#if defined(USE_SD_CARD) && defined(USE_PJRC_AUDIO)
+	if (audio_replay_.active())
 	{
-		//assume daylight
-		if (dark_count_ < LIGHT_DEBOUNCE) {
-			dark_count_++;
-		}
-	} else {
-		//assume darkness
-		if (dark_count_ > -LIGHT_DEBOUNCE) {
-			dark_count_--;
-		}
+		//file instead of microphone, as many blocks as the clock has passed
+		while (audio_replay_.behind(micros()) && audio_replay_.nextBlock());
+		return 0;
+	}
+#endif
+#ifdef USE_PJRC_AUDIO
+	//analysis done by PJRC Audio, pass on results.
+	//PJRC does not say when a block was captured, so latency misses up to one mic task period
+	micros_t now = micros();
+	if (audioRMS.available() && audioPeak.available())
+	{
+		audio_features_.setLevels(audioRMS.read()*AUDIO_FULL_SCALE, audioPeak.read()*AUDIO_FULL_SCALE, now);
 	}
-	if (dark_count_ <= -LIGHT_DEBOUNCE)
+#ifdef USE_OVERLAP_FFT
+	const micros_t block_us = AUDIO_BLOCK_SAMPLES * 1000000.0f / AUDIO_SAMPLE_RATE_EXACT;
+	for (int queued = audioQueue.available(); queued > 0; queued--)
 	{
-		is_dark_ = true;
-	} else if (dark_count_ >= LIGHT_DEBOUNCE)
+		fft_analyzer_.feed(audioQueue.readBuffer(), AUDIO_BLOCK_SAMPLES, now - (queued-1)*block_us);
+		audioQueue.freeBuffer();
+	}
+#else
+	if (audioFFT.available())
 	{
-		is_dark_ = false;
+		audio_features_.setFFT(audioFFT.output, now);
 	}
+#endif
+#elif defined(USE_FIXED_FFT)
+	//our own sampling, analyze every full block
+	if (const int16_t *block = audio_capture_.readyBlock())
+	{
+		fft_analyzer_.analyze(block, AUDIO_CAPTURE_BLOCK, audio_capture_.readyTimeUs());
+		audio_capture_.release();
+	}
+#endif
+	return 0;
 }
 
-inline void task_sample_mic()
+void show_leds()
 {
-#ifdef USE_PJRC_AUDIO
-	//done by PJRC Audio
+	//crossfade output is already in physical order
+	ledctr_t origin = (crossfade_.active()) ? 0 : leds_origin_;
+	uint8_t brightness = FastLED.getBrightness();
+#ifdef PHOTORESISTOR_USE_ADC
+	//dimmer the darker it is around us, on top of the animation's brightness
+	uint8_t ambient = blend8(AMBIENT_BRIGHTNESS_MIN, 255, light_sensor_.ambient());
 #else
-	//TODO
+	//the comparator pin only knows dark or bright, dimming would just halve every night-time animation
+	uint8_t ambient = 255;
+#endif
+	uint8_t applied = scale8(scale8(brightness, ambient), settings_.brightness);
+	FastLED.setBrightness(applied);
+	const CRGB *shown = strip_layout_.show(crossfade_.outputBuffer(), origin, leds_out_);
+	FastLED.setBrightness(brightness);
+	audio_latency_.shown(micros(), strip_layout_.frameWireUs());
+	//remote preview, drops the frame if USB can not take it right now
+	frame_stream_.send(shown, applied);
+#ifdef USE_SD_CARD
+	//the animation's own brightness, played back the frame is dimmed by ambient and settings again
+	sd_recorder_.recordFrame(shown, brightness);
 #endif
 }
 
-void task_animate_leds()
+micros_t task_animate_leds()
 {
-	static millis_t next_run=0;
-
-	//ignore overflow for now, as the only thing that happens that we continue immediately once.
-	if (millis() < next_run)
-		return;
-
-	//run current animation
-	millis_t delay_ms = animations_list_[animation_current_]->run();
-
-	// Show the leds (only one of which is set to white, from above)
-	FastLED.show();
-	next_run=millis()+delay_ms;
+	millis_t delay_ms;
+	PROFILER_START(frame_start);
+	//run current animation, or crossfade from previous one
+	if (crossfade_.keepFading(&animations_, animations_.current(animation_previous_), animations_.current(animation_current_)))
+	{
+		delay_ms = crossfade_.run(
+			[]{return animations_.run(animation_previous_);},
+			[]{return animations_.run(animation_current_);});
+	} else {
+		delay_ms = animations_.run(animation_current_);
+	}
+	PROFILER_ADD(profilerAnimSlot(animation_current_), nullptr, frame_start);
+
+	PROFILER_START(show_start);
+	show_leds();
+	PROFILER_ADD(PROFILER_SLOT_SHOW, "show", show_start);
+	//could not keep up with the delay the animation asked for
+	PROFILER_BUDGET(profilerAnimSlot(animation_current_), frame_start, delay_ms*1000);
+	return delay_ms*1000;
 }
 
 void animation_switch_next()
 {
+	animation_previous_ = animation_current_;
 	animation_current_++;
 	animation_current_%=NUM_ANIM;
-	save_to_EEPROM();
-	animations_list_[animation_current_]->init();
+	save_settings();
+	//a crossfade started by a decorator is cut short, ours takes precedence
+	crossfade_.cancel();
+	bool fade = crossfade_.begin(&animations_);
+	animations_.init(animation_current_);
+	if (fade)
+		crossfade_.incomingInitialized();
+	scheduler_.runSoon(task_animate_leds);
 }
 
-void task_check_button()
+volatile bool button_wakeup_ = false;
+
+void button_isr()
+{
+	button_wakeup_ = true;
+}
+
+micros_t task_check_button()
 {
 	static uint16_t btn_count_=0;
 	if (digitalRead(BUTTON_PIN) == LOW)
@@ -314,19 +558,154 @@ void task_check_button()
 	{
 		animation_switch_next();
 	}
+	//debounce at BUTTON_PERIOD_US while pressed, otherwise wait for button_isr(), polling slowly in case it was missed
+	return (0 == btn_count_) ? BUTTON_IDLE_PERIOD_US : 0;
 }
 
-void task_heartbeat()
+micros_t task_heartbeat()
 {
-	static uint16_t hbled=0;
-	digitalWrite(LED_PIN,(hbled & 1<<12 )?HIGH:LOW);
-	hbled = ++hbled & (1<<13);
+	static bool hbled=false;
+	hbled = !hbled;
+	digitalWrite(LED_PIN,(hbled)?HIGH:LOW);
+	return (hbled)? HEARTBEAT_ON_US : HEARTBEAT_OFF_US;
+}
+
+/// Serial commands:
+///   b ... benchmark all animations (prints frame times) and wire time per strip segment
+///   g ... run every animation with fixed seed, clock and audio, compare frame hashes and times with golden_frames.h (see golden.h)
+///   t ... print task statistics and idle time, then reset them
+///   + ... brighter (global brightness, saved)
+///   - ... darker (global brightness, saved)
+///   s ... print settings store state
+///   v ... start/stop streaming frames to the host (binary, see frame_stream.h and tools/frame_stream_decode.py), prints stream stats on stop
+///   V ... same with audio features (rms, peak, lowest FFT bins) along
+///   p ... print cycle histograms per animation, task and show() (with USE_PROFILER), then reset them
+///   l ... print audio to LED latency (min/mean/p50/p99/max per stage), then reset it
+///   L ... feed a kick drum into the current animation in simulated time, print after how long the LEDs react
+///   f ... compare fixed_fft.h with a double precision DFT, print error and cycles (and analysis load with USE_FIXED_FFT)
+///   r ... start/stop replaying REPLAY_FILENAME from SD card instead of the microphone
+///   R ... render current animation from REPLAY_FILENAME as fast as possible, print onsets and throughput
+///   w ... start/stop recording frames and audio features to RECORD_FILENAME on SD card, prints recorder stats on stop
+micros_t task_serial_commands()
+{
+	if (!Serial.available())
+		return 0;
+	int c = Serial.read();
+	switch (c)
+	{
+		case 'b':
+			crossfade_.cancel();
+			benchmarkAnimations(Serial, animations_);
+			strip_layout_.printTiming(Serial);
+			animations_.init(animation_current_);
+			scheduler_.resetStats();
+			break;
+		case 'g':
+			goldenFrames(Serial, animations_, golden_extras_);
+			animations_.init(animation_current_);
+			audio_latency_.reset();
+			scheduler_.resetStats();
+			break;
+		case 't':
+			scheduler_.printStats(Serial);
+			scheduler_.resetStats();
+			break;
+		case '+':
+			settings_.brightness = qadd8(settings_.brightness, 16);
+			save_settings();
+			break;
+		case '-':
+			settings_.brightness = max(qsub8(settings_.brightness, 16), 16);
+			save_settings();
+			break;
+		case 's':
+			settings_store_.printStats(Serial);
+			break;
+		case 'v':
+		case 'V':
+			if (frame_stream_.active())
+			{
+				frame_stream_.end();
+				frame_stream_.printStats(Serial);
+			} else {
+				frame_stream_.begin(Serial, 'V' == c);
+			}
+			break;
+		case 'p':
+#ifdef USE_PROFILER
+			profiler_.print(Serial);
+			profiler_.reset();
+#else
+			Serial.println("# profiler not compiled in, define USE_PROFILER");
+#endif
+			break;
+		case 'l':
+			audio_latency_.print(Serial);
+			audio_latency_.reset();
+			break;
+		case 'L':
+			crossfade_.cancel();
+			benchmarkImpulseLatency(Serial, animations_, animation_current_);
+			animations_.init(animation_current_);
+			audio_latency_.reset();
+			scheduler_.resetStats();
+			break;
+		case 'f':
+			fixedFFTSelfTest<FFT_SIZE>(Serial);
+#if defined(USE_FIXED_FFT) || defined(USE_OVERLAP_FFT)
+			Serial.print("# analysis cycles last ");
+			Serial.print(fft_analyzer_.lastCycles());
+			Serial.print(" max ");
+			Serial.println(fft_analyzer_.maxCycles());
+			fft_analyzer_.resetCycles();
+#endif
+#ifdef USE_FIXED_FFT
+			Serial.print("# capture overruns ");
+			Serial.println(audio_capture_.overruns());
+#endif
+			scheduler_.resetStats();
+			break;
+#ifdef USE_SD_CARD
+		case 'w':
+			if (sd_recorder_.active())
+			{
+				sd_recorder_.end();
+				sd_recorder_.printStats(Serial);
+			} else if (!sd_recorder_.begin(RECORD_FILENAME)) {
+				Serial.println("# can not create " RECORD_FILENAME);
+			}
+			break;
+#endif
+#if defined(USE_SD_CARD) && defined(USE_PJRC_AUDIO)
+		case 'r':
+			if (audio_replay_.active())
+				audio_replay_.end();
+			else if (!audio_replay_.begin(REPLAY_FILENAME))
+				Serial.println("# can not open " REPLAY_FILENAME);
+			break;
+		case 'R':
+			crossfade_.cancel();
+			if (audio_replay_.begin(REPLAY_FILENAME))
+				replayFast(Serial, audio_replay_, animations_, animation_current_);
+			else
+				Serial.println("# can not open " REPLAY_FILENAME);
+			animations_.init(animation_current_);
+			scheduler_.resetStats();
+			break;
+#endif
+		default:
+			break;
+	}
+	return 0;
 }
 
 void loop() {
-   task_heartbeat();
-   task_check_button();
-   task_check_lightlevel();
-   task_sample_mic();
-   task_animate_leds();
+   scheduler_.runDue();
+   if (button_wakeup_)
+   {
+      button_wakeup_ = false;
+      scheduler_.runSoon(task_check_button);
+   }
+   //nothing due: halt until the next interrupt
+   scheduler_.sleepUntilDue();
 }
@@ -0,0 +1,44 @@
+#ifndef ANIMATION_CLOCK_INCLUDE__H
+#define ANIMATION_CLOCK_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Time as animations, decorators and the crossfade see it.
+/// millis() normally. A golden frame run (golden.h) switches to simulated time and advances it
+/// by the delay every frame asks for, so the output does not depend on how fast the CPU is.
+///
+/// // example use:
+/// millis_t now = animation_clock_.now();
+/// ...
+/// animation_clock_.simulate(0);
+/// animation_clock_.advance(animations_.run(idx));
+/// animation_clock_.realTime();
+///
+
+class AnimationClock
+{
+private:
+  bool simulated_=false;
+  unsigned long now_ms_=0;
+
+public:
+  unsigned long now() const { return simulated_ ? now_ms_ : millis(); }
+
+  /// from now on time only moves with advance()
+  void simulate(unsigned long start_ms)
+  {
+    simulated_ = true;
+    now_ms_ = start_ms;
+  }
+
+  void advance(unsigned long ms) { now_ms_ += ms; }
+
+  void realTime() { simulated_ = false; }
+
+  bool simulated() const { return simulated_; }
+};
+
+AnimationClock animation_clock_;
+
+#endif //ANIMATION_CLOCK_INCLUDE__H
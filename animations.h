@@ -7,7 +7,9 @@
 #if defined(ARDUINO_ARCH_ESP8266)
 #include "gpio.h"
 #endif
-#include <vector>
+#include <utility>
+#include <tuple>
+#include <type_traits>
 
 #ifndef min
 #define min(a,b) ((a)<(b)?(a):(b))
@@ -19,6 +21,19 @@
 typedef uint32_t ledctr_t;
 typedef unsigned long millis_t;
 
+#include "animation_clock.h"
+#include "pixel_kernels.h"
+#include "random_stream.h"
+#include "spectrum_colors.h"
+#include "geometry.h"
+#include "audio_features.h"
+
+/// shared by all animations, seed in setup()
+/// Animations take randomness only from here and time only from animation_clock_, and reset
+/// everything that affects their frames in init(). So the same seed, clock and audio input
+/// give the same frames, see golden.h.
+RandomStream random_stream_;
+
 bool areAllPixelsBlack(void)
 {
   uint32_t pxsum = 0;
@@ -31,12 +46,137 @@ bool areAllPixelsBlack(void)
   return (pxsum == 0);
 }
 
+//// Rotating view of leds_ for scrolling animations.
+//// leds_origin_ is the physical position of leds_[0], so scrolling the whole
+//// picture is O(1): move the origin and write only the new pixels.
+//// The origin is resolved once, when the frame is copied out for FastLED.show().
+//// BaseAnimation::init() resets the origin.
+class RotatingStrip
+{
+public:
+  /// leds_ index of physical position pos
+  static ledctr_t index(ledctr_t pos)
+  {
+    return (pos + NUM_LEDS - leds_origin_) % NUM_LEDS;
+  }
+
+  static CRGB &at(ledctr_t pos)
+  {
+    return leds_[index(pos)];
+  }
+
+  /// moves the picture towards the end of the strip
+  static void scroll(ledctr_t by)
+  {
+    leds_origin_ = (leds_origin_ + by) % NUM_LEDS;
+  }
+};
+
+/// copies src with given origin into dst in physical order
+inline void resolveStripOrigin(const CRGB *src, ledctr_t origin, CRGB *dst)
+{
+  memcpy(dst + origin, src, (NUM_LEDS - origin) * sizeof(CRGB));
+  memcpy(dst, src + NUM_LEDS - origin, origin * sizeof(CRGB));
+}
+
+//// Running statistics of a frame, kept up to date by TrackedFrame
+struct FrameStats
+{
+  uint8_t max_channel; //exact after fade()/fill()/measure(), an upper bound after set()/add()
+  uint32_t channel_sum;
+  ledctr_t lit_pixels;
+
+  bool isBlack() const { return 0 == channel_sum; }
+
+  /// rough supply current, assuming ~20mA per WS2812 channel at full duty
+  uint32_t estimatedMilliAmps(uint8_t brightness) const
+  {
+    return static_cast<uint64_t>(channel_sum) * brightness * 20 / (255UL*255UL);
+  }
+};
+
+//// Writes and fades leds_ while keeping FrameStats, so "is the strip dark"
+//// and "how much power does this frame draw" are O(1) queries
+//// instead of another pass over the whole strip.
+//// The stats describe the framebuffer the animation last rendered into. During a crossfade
+//// that holds because no animation object draws both sides (Crossfade::keepFading()).
+class TrackedFrame
+{
+private:
+  FrameStats stats_ = {0xFF, 0xFFFFFFFF, NUM_LEDS}; //unknown until first fade/fill/measure
+
+  static uint16_t channelSum(const CRGB &c) { return static_cast<uint16_t>(c.r) + c.g + c.b; }
+  static uint8_t channelMax(const CRGB &c) { return max(c.r, max(c.g, c.b)); }
+
+public:
+  const FrameStats &stats() const { return stats_; }
+
+  /// fadeToBlackBy() and measure in the same pass
+  const FrameStats &fade(uint8_t fade_by)
+  {
+    uint8_t scale = 255 - fade_by;
+    stats_ = {0, 0, 0};
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+    {
+      CRGB &px = leds_[l];
+      px.nscale8(scale);
+      uint16_t sum = channelSum(px);
+      stats_.channel_sum += sum;
+      stats_.lit_pixels += (sum > 0) ? 1 : 0;
+      stats_.max_channel = max(stats_.max_channel, channelMax(px));
+    }
+    return stats_;
+  }
+
+  void fill(const CRGB &color)
+  {
+    fill_solid(leds_, NUM_LEDS, color);
+    uint16_t sum = channelSum(color);
+    stats_ = {channelMax(color), static_cast<uint32_t>(sum) * NUM_LEDS, (sum > 0) ? static_cast<ledctr_t>(NUM_LEDS) : 0};
+  }
+
+  void set(ledctr_t l, const CRGB &color)
+  {
+    uint16_t old_sum = channelSum(leds_[l]);
+    uint16_t new_sum = channelSum(color);
+    leds_[l] = color;
+    stats_.channel_sum += new_sum;
+    stats_.channel_sum -= old_sum;
+    stats_.lit_pixels += ((new_sum > 0) ? 1 : 0);
+    stats_.lit_pixels -= ((old_sum > 0) ? 1 : 0);
+    stats_.max_channel = max(stats_.max_channel, channelMax(color));
+  }
+
+  /// saturating add, like leds_[l] += color
+  void add(ledctr_t l, const CRGB &color)
+  {
+    CRGB sum = leds_[l];
+    sum += color;
+    set(l, sum);
+  }
+
+  /// full pass, for when something untracked wrote to leds_
+  const FrameStats &measure()
+  {
+    stats_ = {0, 0, 0};
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+    {
+      uint16_t sum = channelSum(leds_[l]);
+      stats_.channel_sum += sum;
+      stats_.lit_pixels += (sum > 0) ? 1 : 0;
+      stats_.max_channel = max(stats_.max_channel, channelMax(leds_[l]));
+    }
+    return stats_;
+  }
+};
+
 class BaseAnimation
 {
 public:
   virtual void init()
   {
     fill_solid(leds_, NUM_LEDS, CRGB::Black);
+    leds_origin_ = 0;
     FastLED.setBrightness(80);
   }
 
@@ -44,9 +184,18 @@ public:
   {
     return 100;
   }
+
+  /// the animation that draws the frame, decorators pass this on to the one they run
+  virtual const BaseAnimation *current() const
+  {
+    return this;
+  }
 };
 
 class AnimationBlack : public BaseAnimation {
+private:
+  TrackedFrame frame_;
+
 public:
   virtual void init()
   { //leave previous leds as they are
@@ -54,7 +203,7 @@ public:
 
   virtual millis_t run()
   {
-    CPixelView<CRGB>(leds_,0,NUM_LEDS).fadeToBlackBy(20);
+    frame_.fade(20);
     return 200;
   }
 };
@@ -66,17 +215,19 @@ public:
 class AnimationBlackSleepESP8266 : public BaseAnimation {
 private:
   uint32_t wakup_pin_;
+  TrackedFrame frame_;
 
 public:
   AnimationBlackSleepESP8266(uint32_t wakup_pin) : wakup_pin_(wakup_pin) {}
 
   virtual void init()
   { //leave previous leds as they are
+    frame_ = TrackedFrame();
   }
 
   virtual millis_t run()
   {
-    if (areAllPixelsBlack()) //fadeout finished
+    if (frame_.stats().isBlack()) //fadeout finished, as of last frame
     {
       #ifdef LED_PIN
       digitalWrite(LED_PIN,LOW);
@@ -89,9 +240,9 @@ public:
       delay(100);
       gpio_pin_wakeup_disable();
       //delay(sleep_duration_s_*1000);
-      leds_[0] = CRGB::Red; //indicate wakeup. you have time to push button until red has faded out
+      frame_.set(0, CRGB::Red); //indicate wakeup. you have time to push button until red has faded out
     } else {
-      CPixelView<CRGB>(leds_,0,NUM_LEDS).fadeToBlackBy(20);
+      frame_.fade(20);
     }
     return 60;
   }
@@ -114,14 +265,15 @@ public:
 class AnimationBlackSleepTeensy : public BaseAnimation {
 private:
   SnoozeBlock sleep_config_;
+  TrackedFrame frame_;
 
 public:
   AnimationBlackSleepTeensy(SnoozeBlock &sleep_config) : sleep_config_(sleep_config) {}
 
   virtual millis_t run()
   {
-    CPixelView<CRGB>(leds_,0,NUM_LEDS).fadeToBlackBy(20);
-    if (areAllPixelsBlack()) //fadeout finished
+    //fadeout finished, but a golden frame run (simulated time) must not put us to sleep
+    if (frame_.fade(20).isBlack() && !animation_clock_.simulated())
     {
       #ifdef LED_PIN
       digitalWrite(LED_PIN,LOW);
@@ -133,72 +285,214 @@ public:
 };
 #endif
 
-// onlyInDarkness Decorator
-class RunOnlyInDarkness : public BaseAnimation {
+//// Compile time animation registry.
+//// Holds references to statically allocated animations of concrete types,
+//// no heap, no vector. run() and init() are called qualified, i.e. without
+//// going through the vtable, so the compiler can inline them.
+////
+//// // example use:
+//// AnimationPlasma anim_plasma;
+//// AnimationFire2012 anim_fire;
+//// auto animations_ = makeAnimationRegistry(anim_plasma, anim_fire);
+//// animations_.init(1);
+//// animations_.run(1);
+////
+template <class... Anims>
+class AnimationRegistry {
 private:
-  BaseAnimation *dark_animation;
-  BaseAnimation *light_animation;
-  bool  last_dark=false;
+  std::tuple<Anims&...> anims_;
+
+  template <class A> static void initDirect(A &a) { a.A::init(); }
+  template <class A> static millis_t runDirect(A &a) { return a.A::run(); }
+  template <class A> static const BaseAnimation *currentDirect(const A &a) { return a.A::current(); }
+
+  template <size_t I>
+  typename std::enable_if<(I < sizeof...(Anims)), void>::type initAt(uint8_t idx)
+  {
+    if (idx == I)
+      return initDirect(std::get<I>(anims_));
+    return initAt<I+1>(idx);
+  }
+  template <size_t I>
+  typename std::enable_if<(I >= sizeof...(Anims)), void>::type initAt(uint8_t) {}
+
+  template <size_t I>
+  typename std::enable_if<(I < sizeof...(Anims)), millis_t>::type runAt(uint8_t idx)
+  {
+    if (idx == I)
+      return runDirect(std::get<I>(anims_));
+    return runAt<I+1>(idx);
+  }
+  template <size_t I>
+  typename std::enable_if<(I >= sizeof...(Anims)), millis_t>::type runAt(uint8_t) { return 100; }
+
+  template <size_t I>
+  typename std::enable_if<(I < sizeof...(Anims)), const BaseAnimation*>::type currentAt(uint8_t idx) const
+  {
+    if (idx == I)
+      return currentDirect(std::get<I>(anims_));
+    return currentAt<I+1>(idx);
+  }
+  template <size_t I>
+  typename std::enable_if<(I >= sizeof...(Anims)), const BaseAnimation*>::type currentAt(uint8_t) const { return nullptr; }
+
+public:
+  AnimationRegistry(Anims&... anims) : anims_(anims...) {}
+
+  static constexpr uint8_t size() { return sizeof...(Anims); }
+
+  void init(uint8_t idx) { initAt<0>(idx); }
+  millis_t run(uint8_t idx) { return runAt<0>(idx); }
+  /// the animation at index I, with its concrete type
+  template <size_t I>
+  typename std::tuple_element<I, std::tuple<Anims...> >::type &at() { return std::get<I>(anims_); }
+  /// the animation object that draws for idx, see BaseAnimation::current()
+  const BaseAnimation *current(uint8_t idx) const { return currentAt<0>(idx); }
+};
+
+template <class... Anims>
+AnimationRegistry<Anims...> makeAnimationRegistry(Anims&... anims)
+{
+  return AnimationRegistry<Anims...>(anims...);
+}
+
+// onlyInDarkness Decorator, composed at compile time
+// crossfades on day/night changes if crossfade.h is included before animations.h
+template <class DarkAnim, class LightAnim>
+class RunOnlyInDarknessT : public BaseAnimation {
+private:
+  DarkAnim &dark_animation_;
+  LightAnim &light_animation_;
+  bool last_dark_=false;
+
+  millis_t runSide(bool dark)
+  {
+    if (dark)
+      return dark_animation_.DarkAnim::run();
+    else
+      return light_animation_.LightAnim::run();
+  }
+
+  const BaseAnimation *sideCurrent(bool dark) const
+  {
+    if (dark)
+      return dark_animation_.DarkAnim::current();
+    else
+      return light_animation_.LightAnim::current();
+  }
+
 public:
-  RunOnlyInDarkness(BaseAnimation &in_darkness, BaseAnimation &in_daylight) :dark_animation(&in_darkness), light_animation(&in_daylight) {}
+  RunOnlyInDarknessT(DarkAnim &in_darkness, LightAnim &in_daylight) : dark_animation_(in_darkness), light_animation_(in_daylight) {}
 
   virtual void init()
   {
-    last_dark = is_dark_;
+    last_dark_ = is_dark_;
     if (is_dark_)
-      return dark_animation->init();
+      dark_animation_.DarkAnim::init();
     else
-      return light_animation->init();
+      light_animation_.LightAnim::init();
   }
 
   virtual millis_t run()
   {
-    if (last_dark != is_dark_)
+    if (last_dark_ != is_dark_)
     {
-      this->init();
+#ifdef CROSSFADE_INCLUDE__H
+      bool fade = crossfade_.begin(this);
+      RunOnlyInDarknessT::init();
+      if (fade)
+        crossfade_.incomingInitialized();
+#else
+      RunOnlyInDarknessT::init();
+#endif
     }
 
-    if (is_dark_)
-      return dark_animation->run();
-    else
-      return light_animation->run();
+#ifdef CROSSFADE_INCLUDE__H
+    if (crossfade_.keepFading(this, sideCurrent(!last_dark_), sideCurrent(last_dark_)))
+    {
+      return crossfade_.run([this]{return runSide(!last_dark_);}, [this]{return runSide(last_dark_);});
+    }
+#endif
+    return runSide(is_dark_);
+  }
+
+  virtual const BaseAnimation *current() const
+  {
+    return sideCurrent(last_dark_);
   }
 };
 
+template <class DarkAnim, class LightAnim>
+RunOnlyInDarknessT<DarkAnim, LightAnim> runOnlyInDarkness(DarkAnim &in_darkness, LightAnim &in_daylight)
+{
+  return RunOnlyInDarknessT<DarkAnim, LightAnim>(in_darkness, in_daylight);
+}
 
-// AutoSwitch Collection Decorator
-class AutoSwitchAnimationCollection : public BaseAnimation {
+// AutoSwitch Collection Decorator, composed at compile time
+// crossfades between animations if crossfade.h is included before animations.h
+template <class... Anims>
+class AutoSwitchAnimationCollectionT : public BaseAnimation {
 private:
-  std::vector <BaseAnimation*> &autoswitch_list_;
-  std::vector <BaseAnimation*>::iterator curanim_;
+  AnimationRegistry<Anims...> collection_;
+  uint8_t curanim_=0;
+  uint8_t prevanim_=0;
   millis_t switch_after_ms_=0;
   millis_t next_switch_=0;
 
 public:
-  AutoSwitchAnimationCollection(millis_t switch_after_ms, std::vector<BaseAnimation*> &anim_list) : autoswitch_list_(anim_list), curanim_(autoswitch_list_.begin()), switch_after_ms_(switch_after_ms) {}
+  AutoSwitchAnimationCollectionT(millis_t switch_after_ms, Anims&... anims) : collection_(anims...), switch_after_ms_(switch_after_ms) {}
+
+  millis_t switchInterval() const { return switch_after_ms_; }
+  void setSwitchInterval(millis_t switch_after_ms) { switch_after_ms_ = switch_after_ms; }
 
+  /// starts over with the first animation, which gets the whole interval
   virtual void init()
   {
-    (*curanim_)->init();
+    curanim_ = 0;
+    prevanim_ = 0;
+    next_switch_ = animation_clock_.now() + switch_after_ms_;
+    collection_.init(curanim_);
   }
 
   virtual millis_t run()
   {
-    millis_t time=millis();
-    if (time > next_switch_)
+    millis_t time=animation_clock_.now();
+    if (static_cast<int32_t>(time - next_switch_) > 0)
     {
+      prevanim_ = curanim_;
       curanim_++;
-      if (autoswitch_list_.end() == curanim_)
-      {
-        curanim_ = autoswitch_list_.begin();
-      }
-      (*curanim_)->init();
+      curanim_ %= collection_.size();
+#ifdef CROSSFADE_INCLUDE__H
+      bool fade = crossfade_.begin(this);
+      collection_.init(curanim_);
+      if (fade)
+        crossfade_.incomingInitialized();
+#else
+      collection_.init(curanim_);
+#endif
       next_switch_ = time+switch_after_ms_;
     }
-    return (*curanim_)->run();
+#ifdef CROSSFADE_INCLUDE__H
+    if (crossfade_.keepFading(this, collection_.current(prevanim_), collection_.current(curanim_)))
+    {
+      return crossfade_.run([this]{return collection_.run(prevanim_);}, [this]{return collection_.run(curanim_);});
+    }
+#endif
+    return collection_.run(curanim_);
+  }
+
+  virtual const BaseAnimation *current() const
+  {
+    return collection_.current(curanim_);
   }
 };
 
+template <class... Anims>
+AutoSwitchAnimationCollectionT<Anims...> autoSwitchAnimationCollection(millis_t switch_after_ms, Anims&... anims)
+{
+  return AutoSwitchAnimationCollectionT<Anims...>(switch_after_ms, anims...);
+}
+
 
 class AnimationBatteryIndicator : public BaseAnimation {
 private:
@@ -209,7 +503,7 @@ private:
   CRGB darkyellow;
 
 public:
-  AnimationBatteryIndicator()
+  AnimationBatteryIndicator(uint8_t battery_byte=0) : battery_byte_(battery_byte)
   {
     hsv2rgb_rainbow(CHSV(64,255,128),darkyellow);
   }
@@ -222,7 +516,9 @@ public:
   virtual void init()
   {
     fill_solid(leds_, NUM_LEDS, CRGB::Black);
+    leds_origin_ = 0;
     FastLED.setBrightness(8);
+    working_ctr_=0;
   }
 
   virtual millis_t run()
@@ -236,7 +532,10 @@ public:
     leds_[wipos] = blend(leds_[wipos], darkyellow, (0xff/blendsteps_)*(blendsteps_ - working_ctr_%blendsteps_));
     leds_[wipos+1] = blend(leds_[wipos+1], darkyellow, (0xff/blendsteps_)*(working_ctr_%blendsteps_));
     working_ctr_++;
-    working_ctr_%=charge*blendsteps_;
+    if (charge > 0)
+      working_ctr_%=charge*blendsteps_;
+    else
+      working_ctr_=0;
     return 150;
   }
 };
@@ -254,6 +553,9 @@ public:
   virtual void init()
   {
     BaseAnimation::init();
+    brightness_drift_=0;
+    black_pos_=0;
+    black_size_=2;
     FastLED.setBrightness(blend8(brightness_lower,brightness_upper,quadwave8(brightness_drift_)));
   }
 
@@ -295,7 +597,7 @@ public:
     //start a new random black size
     if (0 == black_pos_)
     {
-      black_size_=random8(0,11);
+      black_size_=random_stream_.next8(0,11);
     }
 
     return 1000/30;
@@ -311,6 +613,7 @@ public:
   virtual void init()
   {
     BaseAnimation::init();
+    brightness_drift_=0;
     FastLED.setBrightness(blend8(brightness_lower,brightness_upper,quadwave8(brightness_drift_)));
   }
 
@@ -365,13 +668,14 @@ public:
   {
     BaseAnimation::init();
     FastLED.setBrightness(64);
+    steps_=0;
   }
 
   virtual millis_t run()
   {
-    for (uint8_t i=0;i<NUM_LEDS;i++)
+    for (ledctr_t i=0;i<NUM_LEDS;i++)
     {
-      uint16_t spani = (0x7f*(uint16_t)i)/(NUM_LEDS-1);
+      uint8_t spani = (0x7f*i)/(NUM_LEDS-1);
       uint8_t s = sin8(add8(steps_,mul8(spani,8)));
       uint8_t u = sin8(-(steps_*2)-(spani*3)+sin8(i*2));
       uint8_t v = max(0, 255-s-u); //sin((t+(t/2))+(i*5));
@@ -389,20 +693,20 @@ class AnimationPhotosensorDebugging : public BaseAnimation
 public:
   virtual millis_t run()
   {
-    for (ledctr_t l=0; l<NUM_LEDS; l++)
-    {
-      leds_[l]=CRGB::Black;
-    }
-    ledctr_t light_level_mapped_onto_leds = (light_level*NUM_LEDS/4095);
-    for (ledctr_t l=0; l<light_level_mapped_onto_leds; l++)
+    fill_solid(leds_, NUM_LEDS, CRGB::Black);
+    //blue: last sample, red: filtered level, white: thresholds, all 0..LIGHT_SENSOR_FULL_SCALE_MV
+    ledctr_t raw_mapped_onto_leds = min(static_cast<uint32_t>(light_sensor_.rawMV())*NUM_LEDS/LIGHT_SENSOR_FULL_SCALE_MV, static_cast<uint32_t>(NUM_LEDS));
+    for (ledctr_t l=0; l<raw_mapped_onto_leds; l++)
     {
       leds_[l].b=30;
     }
-    ledctr_t dark_count_mapped_onto_leds = min(NUM_LEDS, ((dark_count_+LIGHT_DEBOUNCE)*NUM_LEDS/(2*LIGHT_DEBOUNCE)));
-    for (ledctr_t l=0; l<dark_count_mapped_onto_leds; l++)
+    ledctr_t filtered_mapped_onto_leds = min(static_cast<uint32_t>(light_sensor_.mV())*NUM_LEDS/LIGHT_SENSOR_FULL_SCALE_MV, static_cast<uint32_t>(NUM_LEDS));
+    for (ledctr_t l=0; l<filtered_mapped_onto_leds; l++)
     {
       leds_[l].r=60;
     }
+    leds_[min(static_cast<uint32_t>(light_sensor_.darkThresholdMV())*NUM_LEDS/LIGHT_SENSOR_FULL_SCALE_MV, static_cast<uint32_t>(NUM_LEDS-1))] = CRGB(40,40,40);
+    leds_[min(static_cast<uint32_t>(light_sensor_.brightThresholdMV())*NUM_LEDS/LIGHT_SENSOR_FULL_SCALE_MV, static_cast<uint32_t>(NUM_LEDS-1))] = CRGB(40,40,40);
     if (is_dark_)
     {
       leds_[0].g=100;
@@ -416,6 +720,12 @@ private:
   ledctr_t whiteLed=0;
 
 public:
+  virtual void init()
+  {
+    BaseAnimation::init();
+    whiteLed=0;
+  }
+
   virtual millis_t run()
   {
     // Turn our current led on to white, then show the leds
@@ -430,26 +740,29 @@ public:
   }
 };
 
-#ifdef USE_PJRC_AUDIO
+#ifdef USE_AUDIO
 class AnimationRMSHue : public BaseAnimation {
 private:
   uint8_t hue=0;
+  AudioFeatureReader audio_;
 
 public:
+  virtual void init()
+  {
+    BaseAnimation::init();
+    hue=0;
+  }
+
   virtual millis_t run()
   {
-    if (!audioRMS.available() || !audioPeak.available())
+    if (!audio_.newLevels())
     {
       return 2;
     }
-    float rms = audioRMS.read(); //0.0 ... 1.0
-    uint8_t audiopower = static_cast<uint8_t>(rms*0xff);
-    //move pattern forwards
-    for (ledctr_t l=NUM_LEDS-1; l>0; l--)
-    {
-      leds_[l]=leds_[l-1];
-    }
-    hsv2rgb_rainbow(CHSV(hue,128,audiopower),leds_[0]);
+    uint8_t audiopower = static_cast<uint32_t>(audio_features_.rms)*0xff/AUDIO_FULL_SCALE;
+    //move pattern forwards, then paint the new first pixel
+    RotatingStrip::scroll(1);
+    RotatingStrip::at(0) = applyColorScale(rainbow_lut_.hue(hue), colorScale(128, audiopower));
     hue++;
     return 10;
   }
@@ -458,73 +771,227 @@ public:
 
 
 #define NUM_OCTAVES  8 //log2(256)
+#define FFT_OCTAVE_GAIN_X10 18 //1.8
 
-#ifdef USE_PJRC_AUDIO
-void fft_calc_octaves255(uint8_t led_octaves_magnitude[NUM_OCTAVES])
+//// Octave band edges, computed at compile time for any FFT_BINS and number of bands.
+//// Band b covers bins [fftBandEdge(b), fftBandEdge(b+1)), bin 0 (DC) is skipped.
+//// Edges are log spaced: 2^(b*log2(bins)/bands), but every band gets at least one bin.
+//// For the classic 8 octaves of a 256 FFT, the hand-tuned edges from before are used.
+constexpr uint16_t fft_octave_edges_256_8_[NUM_OCTAVES+1] = {1, 2, 3, 5, 9, 18, 36, 65, 128};
+
+constexpr uint8_t fftLog2(uint32_t x)
 {
-  const float gain = 1.8;
-  led_octaves_magnitude[0] = min(1.0,gain*audioFFT.read(1)) * 0xff;
-  led_octaves_magnitude[1] = min(1.0,gain*audioFFT.read(2)) * 0xff;
-  led_octaves_magnitude[2] = min(1.0,gain*audioFFT.read(3,  4)) * 0xff;
-  led_octaves_magnitude[3] = min(1.0,gain*audioFFT.read(5,  8)) * 0xff;
-  led_octaves_magnitude[4] = min(1.0,gain*audioFFT.read(9,  17)) * 0xff;
-  led_octaves_magnitude[5] = min(1.0,gain*audioFFT.read(18, 35)) * 0xff;
-  led_octaves_magnitude[6] = min(1.0,gain*audioFFT.read(36, 64)) * 0xff;
-  led_octaves_magnitude[7] = min(1.0,gain*audioFFT.read(65, 127)) * 0xff;
+  return (x <= 1) ? 0 : 1 + fftLog2(x >> 1);
 }
-#else
-void fft_calc_octaves255(uint8_t led_octaves_magnitude[NUM_OCTAVES])
+
+// 2^(x_q8/256) rounded to integer, mantissa via 2nd order approximation (error < 0.2%)
+constexpr uint32_t fftExp2Q8(uint32_t x_q8)
 {
-  //TODO
+  return ((((256 + (((x_q8 & 0xFF) * (168 + (((x_q8 & 0xFF) * 88) >> 8))) >> 8)) << (x_q8 >> 8)) + 128) >> 8);
+}
+
+constexpr uint16_t fftMaxU16(uint16_t a, uint16_t b)
+{
+  return (a > b) ? a : b;
+}
+
+template <uint16_t BINS, uint8_t BANDS>
+constexpr uint16_t fftBandEdge(uint8_t b)
+{
+  return (BINS == 128 && BANDS == 8) ? fft_octave_edges_256_8_[b]
+    : (b == 0) ? 1
+    : (b >= BANDS) ? BINS
+    : fftMaxU16(fftBandEdge<BINS,BANDS>(b-1)+1, fftExp2Q8(static_cast<uint32_t>(b) * fftLog2(BINS) * 256 / BANDS));
 }
-#endif
 
-uint8_t get_fft_octaves_beat(uint8_t led_octaves_magnitude[NUM_OCTAVES])
+template <uint16_t BINS, uint8_t BANDS, class Seq> struct FFTBandEdgeTable;
+template <uint16_t BINS, uint8_t BANDS, size_t... I>
+struct FFTBandEdgeTable<BINS, BANDS, std::index_sequence<I...> >
 {
-  const uint8_t beat_threshold=180;
-  uint8_t beat=0;
-  for (uint8_t o=1; o<NUM_OCTAVES; o++)
+  static constexpr uint16_t edges[BANDS+1] = { fftBandEdge<BINS,BANDS>(I)... };
+};
+template <uint16_t BINS, uint8_t BANDS, size_t... I>
+constexpr uint16_t FFTBandEdgeTable<BINS, BANDS, std::index_sequence<I...> >::edges[BANDS+1];
+
+typedef FFTBandEdgeTable<FFT_BINS, NUM_OCTAVES, std::make_index_sequence<NUM_OCTAVES+1> > FFTOctaveEdges;
+
+/// reduces raw FFT magnitude bins (as in AudioAnalyzeFFT256::output, where 16384 == 1.0)
+/// to 0..255 per octave. Integer only: mag = min(255, gain*255*sum/16384)
+void fft_calc_octaves255_from_bins(const uint16_t *bins, uint8_t led_octaves_magnitude[NUM_OCTAVES])
+{
+  const uint32_t gain255 = FFT_OCTAVE_GAIN_X10 * 255 / 10;
+  const uint32_t saturating_sum = ((255UL << 14) + gain255 - 1) / gain255;
+  for (uint8_t o=0; o<NUM_OCTAVES; o++)
   {
-    beat += ((led_octaves_magnitude[o] > beat_threshold)? 1:0);
+    uint32_t sum = 0;
+    for (uint16_t b=FFTOctaveEdges::edges[o]; b<FFTOctaveEdges::edges[o+1]; b++)
+    {
+      sum += bins[b];
+    }
+    led_octaves_magnitude[o] = (sum >= saturating_sum) ? 255 : static_cast<uint8_t>((sum * gain255) >> 14);
   }
-  //again for last one, adding +2 in sum if beat.
-  beat += ((led_octaves_magnitude[NUM_OCTAVES-1] > beat_threshold)? 1:0);
-  return beat;
 }
 
+void fft_calc_octaves255(uint8_t led_octaves_magnitude[NUM_OCTAVES])
+{
+  fft_calc_octaves255_from_bins(audio_features_.fft, led_octaves_magnitude);
+}
+
+//// Streaming onset (beat) detector working on the octave magnitudes.
+//// Call update() once per new spectrum (a "hop", one audio block for FFT256).
+////
+//// Per band spectral flux (rise of magnitude since the last hop) is summed over
+//// all bands but the first (mostly DC and rumble). An onset is detected on the hop
+//// in which the flux first crosses an adaptive threshold
+////   threshold = ONSET_MIN_FLUX + 2*median(flux history) + mean(flux history)/2
+//// so loud venues raise the threshold and quiet rooms lower it.
+//// After an onset, further onsets are suppressed for ONSET_REFRACTORY_HOPS.
+//// All integer, work per hop is bounded by NUM_OCTAVES + ONSET_HISTORY.
+#define ONSET_HISTORY 32
+#define ONSET_MIN_FLUX 24
+#define ONSET_REFRACTORY_HOPS 30 //~90ms at FFT256 rate of 344 spectra/s
+
+class OctaveOnsetDetector {
+private:
+  uint8_t prev_magnitude_[NUM_OCTAVES] = {0};
+  uint16_t flux_history_[ONSET_HISTORY] = {0}; //ring, in order of arrival
+  uint16_t flux_sorted_[ONSET_HISTORY] = {0}; //same values, sorted, for the running median
+  uint32_t flux_sum_ = 0;
+  uint8_t history_pos_ = 0;
+  uint16_t refractory_ = 0;
+  uint32_t hop_ = 0;
+  uint32_t rise_start_hop_ = 0;
+  bool rising_ = false;
+  bool onset_ = false;
+  uint8_t strength_ = 0;
+  uint8_t latency_hops_ = 0;
+  millis_t onset_millis_ = 0;
+
+  // replace oldest value in sorted array by new one. O(ONSET_HISTORY)
+  void updateSorted(uint16_t oldest, uint16_t flux)
+  {
+    uint8_t i=0;
+    while (i < ONSET_HISTORY-1 && flux_sorted_[i] != oldest)
+      i++;
+    //move towards the end while neighbour is smaller
+    while (i < ONSET_HISTORY-1 && flux_sorted_[i+1] < flux)
+    {
+      flux_sorted_[i] = flux_sorted_[i+1];
+      i++;
+    }
+    //move towards the start while neighbour is bigger
+    while (i > 0 && flux_sorted_[i-1] > flux)
+    {
+      flux_sorted_[i] = flux_sorted_[i-1];
+      i--;
+    }
+    flux_sorted_[i] = flux;
+  }
+
+public:
+  void update(const uint8_t magnitude[NUM_OCTAVES])
+  {
+    uint16_t flux = 0;
+    for (uint8_t o=1; o<NUM_OCTAVES; o++)
+    {
+      if (magnitude[o] > prev_magnitude_[o])
+        flux += magnitude[o] - prev_magnitude_[o];
+    }
+    for (uint8_t o=0; o<NUM_OCTAVES; o++)
+    {
+      prev_magnitude_[o] = magnitude[o];
+    }
+
+    uint16_t median = flux_sorted_[ONSET_HISTORY/2];
+    uint16_t mean = flux_sum_ / ONSET_HISTORY;
+    uint16_t threshold = ONSET_MIN_FLUX + 2*median + mean/2;
+
+    //remember when flux started rising above its typical level, to report latency
+    if (flux > median)
+    {
+      if (!rising_)
+        rise_start_hop_ = hop_;
+      rising_ = true;
+    } else {
+      rising_ = false;
+    }
+
+    onset_ = false;
+    if (refractory_ > 0)
+    {
+      refractory_--;
+    } else if (flux > threshold)
+    {
+      onset_ = true;
+      strength_ = min(255, 128UL * flux / threshold);
+      latency_hops_ = min(255, hop_ - rise_start_hop_);
+      onset_millis_ = animation_clock_.now();
+      refractory_ = ONSET_REFRACTORY_HOPS;
+    }
+
+    uint16_t oldest = flux_history_[history_pos_];
+    flux_sum_ += flux;
+    flux_sum_ -= oldest;
+    flux_history_[history_pos_] = flux;
+    history_pos_ = (history_pos_ + 1) % ONSET_HISTORY;
+    updateSorted(oldest, flux);
+    hop_++;
+  }
+
+  /// true if the last update() detected an onset
+  bool onset() const {return onset_;}
+  /// 128 at threshold up to 255 at twice the threshold, of the last onset
+  uint8_t strength() const {return strength_;}
+  /// animation_clock_ at the last onset
+  millis_t lastOnsetMillis() const {return onset_millis_;}
+  /// hops between flux starting to rise and the last onset being detected
+  uint8_t latencyHops() const {return latency_hops_;}
+};
+
 // heavily inspired and some calculations and estimations borrowed from buzzandy
 // (https://www.hackster.io/buzzandy/music-reactive-led-strip-5645ed)
 class AnimationFFTOctaves : public BaseAnimation {
 private:
   uint8_t last_beat=0;
-  ledctr_t led_shift=0;
+  uint8_t beat_envelope_=0;
+  OctaveOnsetDetector onset_detector_;
+  AudioFeatureReader audio_;
 
 public:
   virtual void init()
   {
     BaseAnimation::init();
     FastLED.setBrightness(255);
+    last_beat=0;
+    beat_envelope_=0;
+    onset_detector_ = OctaveOnsetDetector();
   }
 
   virtual millis_t run()
   {
     const millis_t default_delay=10;
-#ifdef USE_PJRC_AUDIO
-    if (!audioFFT.available() || !audioPeak.available())
+    if (!audio_.newFFT())
       return 2;
-#endif
     uint8_t led_octaves_magnitude[NUM_OCTAVES];
     //calc octaves magnitude
     fft_calc_octaves255(led_octaves_magnitude);
-    uint8_t beat = get_fft_octaves_beat(led_octaves_magnitude);
+    onset_detector_.update(led_octaves_magnitude);
+
+    //beat 0..7 follows onset strength and decays until the next onset
+    beat_envelope_ = qsub8(beat_envelope_, 8);
+    if (onset_detector_.onset())
+      beat_envelope_ = max(beat_envelope_, onset_detector_.strength());
+    uint8_t beat = beat_envelope_ >> 5;
 
-    //set brightness depending on beat
-    if (beat >= 7)
+    //set brightness depending on beat, flash on strong onsets
+    if (beat >= 7 && onset_detector_.onset())
     {
       fill_solid(leds_, NUM_LEDS, CRGB::Gray);
       FastLED.setBrightness(120);
       return default_delay;
-    } else if (last_beat != beat)
+    }
+    beat = min(beat, 6);
+    if (last_beat != beat)
     {
       FastLED.setBrightness( 40+beat*beat*5 );
       last_beat = beat;
@@ -534,38 +1001,29 @@ public:
     const ledctr_t spectr_width = (NUM_OCTAVES-start_octave)*2-1; //e.g. 8 + 7 in between = 15
     const ledctr_t spectr_repetitions = NUM_LEDS / spectr_width;
 
+    //saturation and value only depend on the magnitude, hue also on the repetition
+    ColorScale octave_scale[NUM_OCTAVES];
+    for (ledctr_t o=start_octave; o < NUM_OCTAVES; o++)
+    {
+      octave_scale[o] = colorScale(blend8(150,0xff,led_octaves_magnitude[o]), led_octaves_magnitude[o]);
+    }
+
     //repeat same pattern over whole strip
+    CRGB octave_colors[NUM_OCTAVES];
     for (ledctr_t repetition=0; repetition<spectr_repetitions; repetition++)
     {
-      ledctr_t start_pos = spectr_width*repetition;
-      //paint octaves to every second LED
-      //leaving one LED blank in between.
       for (ledctr_t o=start_octave; o < NUM_OCTAVES; o++)
       {
-        hsv2rgb_rainbow(
-          CHSV(led_octaves_magnitude[o] + repetition*30,    //H
-            blend8(150,0xff,led_octaves_magnitude[o]),  //S
-            led_octaves_magnitude[o])           //V
-          ,leds_[addmod8(start_pos+o*2,led_shift,NUM_LEDS)]
-        );
-      }
-
-      //interpolate color of LEDs in between (the one's we left free before)
-      for (ledctr_t o=start_octave; o < NUM_OCTAVES-1; o++)
-      {
-        ledctr_t pos_before = addmod8(start_pos+o*2,led_shift,NUM_LEDS);
-        ledctr_t pos_between = addmod8(pos_before,1,NUM_LEDS);
-        ledctr_t pos_after   = addmod8(pos_before,2,NUM_LEDS);
-        leds_[pos_between].r = (static_cast<uint16_t>(leds_[pos_before].r)+static_cast<uint16_t>(leds_[pos_after].r)) / 2;
-        leds_[pos_between].g = (static_cast<uint16_t>(leds_[pos_before].g)+static_cast<uint16_t>(leds_[pos_after].g)) / 2;
-        leds_[pos_between].b = (static_cast<uint16_t>(leds_[pos_before].b)+static_cast<uint16_t>(leds_[pos_after].b)) / 2;
+        octave_colors[o] = applyColorScale(rainbow_lut_.hue(led_octaves_magnitude[o] + repetition*30), octave_scale[o]);
       }
+      //paint octaves to every second LED, interpolating the LEDs in between
+      paintSpectrumInterpolated(&leds_[spectr_width*repetition], &octave_colors[start_octave], NUM_OCTAVES-start_octave);
     }
 
+    //shift the whole pattern, O(1) by moving the origin
     if (beat > 0)
     {
-      led_shift+=((beat+4)/2-2);
-      led_shift%=NUM_LEDS;
+      RotatingStrip::scroll((beat+4)/2-2);
     }
 
     if (beat>3 && beat<7)
@@ -575,8 +1033,11 @@ public:
   }
 };
 
-#ifdef USE_PJRC_AUDIO
+#ifdef USE_AUDIO
 class AnimationFullFFT : public BaseAnimation {
+private:
+  AudioFeatureReader audio_;
+
 public:
   virtual void init()
   {
@@ -586,13 +1047,13 @@ public:
 
   virtual millis_t run()
   {
-    if (!audioFFT.available())
+    if (!audio_.newFFT())
       return 2;
     for (ledctr_t l=0; l<min(FFT_SIZE,NUM_LEDS);l++)
     {
-      uint8_t v = static_cast<uint8_t>(audioFFT.read(l)*255.0);
-      CHSV x(l*4,255,v);
-      hsv2rgb_rainbow(x,leds_[l]);
+      //same as AudioAnalyzeFFT256::read(l)*255, but clamped instead of wrapping around. 0 past the last bin
+      uint8_t v = (l < FFT_BINS) ? min(static_cast<uint32_t>(audio_features_.fft[l])*255 >> 14, 255) : 0;
+      leds_[l] = applyColorScale(rainbow_lut_.hue(l*4), colorScale(255, v));
     }
     return 10; //1ms max delay
   }
@@ -620,13 +1081,13 @@ public:
     CHSV dothsv;
     dothsv.v=128;
     dothsv.s=0xFF;
-    dothsv.h=random8();
+    dothsv.h=random_stream_.next8();
     for (ledctr_t d=0; d<num_dots;d++)
     {
       hsv2rgb_rainbow(dothsv,dot_color[d]);
       dothsv.h+=0xFF/num_dots;
-      dot_speed[d]=dot_max_speed-(int8_t)random8(0,dot_max_speed*2);
-      dot_pos[d]=random16(0,blend_size_*(NUM_LEDS-1));
+      dot_speed[d]=dot_max_speed-(int8_t)random_stream_.next8(0,dot_max_speed*2);
+      dot_pos[d]=random_stream_.next32(0,blend_size_*(NUM_LEDS-1));
     }
     zero_move_ticks_=0;
   }
@@ -640,9 +1101,9 @@ public:
       {
         int32_t dot_distance = dot_pos[d1] - dot_pos[d2];
         //accel/decel
-        if (abs8(dot_distance) < dot_gravity_limit)
+        if (dot_distance < dot_gravity_limit && dot_distance > -dot_gravity_limit)
         {
-          int8_t gravity = dot_gravity_limit-(static_cast<int8_t>(dot_distance)*static_cast<int8_t>(dot_distance)/dot_gravity_limit) + (dot_distance==0)?+1-random8(0,2):0;
+          int8_t gravity = dot_gravity_limit-(static_cast<int8_t>(dot_distance)*static_cast<int8_t>(dot_distance)/dot_gravity_limit) + (dot_distance==0)?+1-random_stream_.next8(0,2):0;
           if (dot_distance < 0)
           {
             dot_speed[d1] += gravity;
@@ -656,7 +1117,7 @@ public:
     }
 
 
-    FastLED.clear();
+    fill_solid(leds_, NUM_LEDS, CRGB::Black); //not FastLED.clear(), leds_ is not always the buffer FastLED shows
     ledctr_t zerospeed=0;
 
     for (ledctr_t d=0; d<num_dots; d++)
@@ -700,35 +1161,28 @@ class AnimationFireworks : public BaseAnimation {
 public:
   virtual millis_t run()
   {
-    uint8_t color = random8();
-    uint32_t prevLed, thisLed, nextLed;
-    bool triggered = random(30) == 3;
+    uint8_t color = random_stream_.next8();
+    bool triggered = random_stream_.next8(30) == 3;
 
-    fadeToBlackBy(leds_,NUM_LEDS,127); // reduce each LEDs brightness by half
+    fadePixels(leds_,NUM_LEDS,127); // reduce each LEDs brightness by half
 
-    // set brightness(i) = ((brightness(i-1)/4 + brightness(i+1)) / 4) + brightness(i)
-    for (ledctr_t i=0 + 1; i <NUM_LEDS; i++)
-    {
-      prevLed = (ledGetColorCode(leds_[i-1]) >> 2) & 0x3F3F3F3F;
-      thisLed = ledGetColorCode(leds_[i]);
-      nextLed = (ledGetColorCode(leds_[i+1]) >> 2) & 0x3F3F3F3F;
-      leds_[i] = CRGB(prevLed + thisLed + nextLed);
-    }
+    // set brightness(i) = brightness(i-1)/4 + brightness(i) + brightness(i+1)/4
+    diffusePixels(leds_,NUM_LEDS);
 
     if(!triggered)
     {
       for(ledctr_t i=0; i<max(1, NUM_LEDS/20); i++)
       {
-        if(random(10) == 0)
+        if(random_stream_.next8(10) == 0)
         {
-          hsv2rgb_rainbow(CHSV(color,0xff,0xff),leds_[0 + random(NUM_LEDS)]);
+          hsv2rgb_rainbow(CHSV(color,0xff,0xff),leds_[random_stream_.next16(NUM_LEDS)]);
         }
       }
     } else
     {
       for(ledctr_t i=0; i<max(1, NUM_LEDS/10); i++)
       {
-        hsv2rgb_rainbow(CHSV(color,200,0xff),leds_[0 + random(NUM_LEDS)]);
+        hsv2rgb_rainbow(CHSV(color,200,0xff),leds_[random_stream_.next16(NUM_LEDS)]);
       }
     }
     return 1000/20;
@@ -777,36 +1231,41 @@ public:
 // Default 120, suggested range 50-200.
 #define SPARKING 50
 
+private:
+  // Array of temperature readings at each simulation cell
+  byte heat[NUM_LEDS];
 
+public:
   virtual void init()
   {
     BaseAnimation::init();
     FastLED.setBrightness(32);
+    memset(heat, 0, sizeof(heat));
   }
 
   virtual millis_t run()
   {
-  // Array of temperature readings at each simulation cell
-    static byte heat[NUM_LEDS];
-
     // Step 1.  Cool down every cell a little
-      for( int i = 0; i < NUM_LEDS; i++) {
-        heat[i] = qsub8( heat[i],  random8(0, ((COOLING * 10) / NUM_LEDS) + 2));
+      const uint8_t cool_lim = ((COOLING * 10) / NUM_LEDS) + 2;
+      for( ledctr_t i = 0; i < NUM_LEDS; ) {
+        ledctr_t chunk = min(static_cast<ledctr_t>(NUM_LEDS) - i, static_cast<ledctr_t>(RANDOM_STREAM_BLOCK));
+        const uint8_t *rnd = random_stream_.take(chunk);
+        for (ledctr_t c = 0; c < chunk; c++, i++) {
+          heat[i] = qsub8( heat[i],  RandomStream::range8(rnd[c], cool_lim));
+        }
       }
 
       // Step 2.  Heat from each cell drifts 'up' and diffuses a little
-      for( int k= NUM_LEDS - 1; k >= 2; k--) {
-        heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 2] ) / 3;
-      }
+      diffuseHeat(heat, NUM_LEDS);
 
       // Step 3.  Randomly ignite new 'sparks' of heat near the bottom
-      if( random8() < SPARKING ) {
-        int y = random8(7);
-        heat[y] = qadd8( heat[y], random8(160,255) );
+      if( random_stream_.next8() < SPARKING ) {
+        int y = random_stream_.next8(7);
+        heat[y] = qadd8( heat[y], random_stream_.next8(160,255) );
       }
 
       // Step 4.  Map from heat cells to LED colors
-      for( int j = 0; j < NUM_LEDS; j++) {
+      for( ledctr_t j = 0; j < NUM_LEDS; j++) {
         CRGB color = HeatColor( heat[j]);
         int pixelnumber;
         pixelnumber = j;
@@ -822,48 +1281,65 @@ class AnimationConfetti : public BaseAnimation
 private:
   uint8_t cur_hue_ = 0;
   uint8_t ctr_ = 0;
+  TrackedFrame frame_;
 
 public:
+  virtual void init()
+  {
+    BaseAnimation::init();
+    cur_hue_ = 0;
+    ctr_ = 0;
+  }
 
   virtual millis_t run()
   {
-    fadeToBlackBy( leds_, NUM_LEDS, 10);
-    int pos = random16(NUM_LEDS);
-    leds_[pos] += CHSV( cur_hue_ + random8(64), 200, 255);
+    frame_.fade(10);
+    int pos = random_stream_.next16(NUM_LEDS);
+    frame_.add(pos, CHSV( cur_hue_ + random_stream_.next8(64), 200, 255));
     if (ctr_++ % 8 == 0)
       cur_hue_++;
     return 1000/60;
   }
 };
 
-#ifdef USE_PJRC_AUDIO
+#ifdef USE_AUDIO
 //(c) FastLED
 class AnimationRMSConfetti : public BaseAnimation
 {
 private:
   uint8_t cur_hue_ = 0;
   uint8_t ctr_ = 0;
-  float threshold_;
+  uint16_t threshold_;
+  TrackedFrame frame_;
+  AudioFeatureReader audio_;
 
 public:
-  AnimationRMSConfetti(float threshold=0.05) : threshold_(threshold) {}
+  AnimationRMSConfetti(float threshold=0.05) : threshold_(threshold*AUDIO_FULL_SCALE) {}
+
+  virtual void init()
+  {
+    BaseAnimation::init();
+    cur_hue_ = 0;
+    ctr_ = 0;
+  }
 
   virtual millis_t run()
   {
-    fadeToBlackBy( leds_, NUM_LEDS, 10);
-    if (audioPeak.available())
+    frame_.fade(10);
+    if (audio_.newLevels())
     {
-      float peak = audioPeak.read();
+      uint32_t peak = audio_.peak();
       if (peak > threshold_)
       {
+        uint8_t hue = cur_hue_ + peak*128/AUDIO_FULL_SCALE;
         //one for sure
-        int pos = random16(NUM_LEDS);
-        leds_[pos] += CHSV( cur_hue_ + static_cast<uint8_t>(peak*128), 200, 255);
+        int pos = random_stream_.next16(NUM_LEDS);
+        frame_.add(pos, CHSV( hue, 200, 255));
         //maybe more
-        for (uint8_t p=0; p<static_cast<uint8_t>(peak*4); p++)
+        for (uint8_t p=0; p<peak*4/AUDIO_FULL_SCALE; p++)
         {
-          pos = random16(NUM_LEDS);
-          leds_[pos] += CHSV( cur_hue_ + static_cast<uint8_t>(peak*128), 200, 255);
+          pos = random_stream_.next16(NUM_LEDS);
+          frame_.add(pos, CHSV( hue, 200, 255));
         }
       }
     }
@@ -887,9 +1363,9 @@ private:
 
   void addGlitter( uint8_t chanceOfGlitter)
   {
-    if (random8() < chanceOfGlitter)
+    if (random_stream_.next8() < chanceOfGlitter)
     {
-      leds_[ random16(NUM_LEDS) ] = CRGB::White;
+      leds_[ random_stream_.next16(NUM_LEDS) ] = CRGB::White;
     }
   }
 
@@ -899,6 +1375,7 @@ public:
   virtual void init()
   {
     BaseAnimation::init();
+    cur_hue_ = 0;
     if (with_glitter_)
       FastLED.setBrightness(32);
     else
@@ -920,11 +1397,17 @@ public:
 
 void paintFireRing(ledctr_t led_start, ledctr_t led_end, uint8_t fire_intensity, CRGB fire_color=CRGB(80,35,0))
 {
-  for( ledctr_t i = led_start; i < led_end; i++)
+  const uint8_t *rnd = nullptr;
+  for( ledctr_t i = led_start, c = RANDOM_STREAM_BLOCK; i < led_end; i++, c++)
   {
+    if (c == RANDOM_STREAM_BLOCK)
+    {
+      rnd = random_stream_.take(min(led_end - i, static_cast<ledctr_t>(RANDOM_STREAM_BLOCK)));
+      c = 0;
+    }
     //blend into fire color
     leds_[i] = blend(leds_[i], fire_color, 128);
-    uint8_t r = random8(fire_intensity);
+    uint8_t r = RandomStream::range8(rnd[c], fire_intensity);
     //substract random color CRGB(r,r/2,r/2)
     // leds_[i] -= CRGB(r,r/2,r/2);
     leds_[i].r = qsub8(leds_[i].r,r);
@@ -935,6 +1418,8 @@ void paintFireRing(ledctr_t led_start, ledctr_t led_end, uint8_t fire_intensity,
 
 class AnimationFireRing : public BaseAnimation {
 private:
+  //strip split into three equal parts
+  typedef RingGeometry<NUM_LEDS/3, NUM_LEDS/3, NUM_LEDS-2*(NUM_LEDS/3)> Thirds;
   const uint8_t max_random_ = 160;
   uint8_t ctr = 0;
 public:
@@ -942,35 +1427,37 @@ public:
   virtual void init()
   {
     fill_solid(leds_, NUM_LEDS, CRGB::Black);
+    leds_origin_ = 0;
     FastLED.setBrightness(64);
     ctr=0;
   }
 
   virtual millis_t run()
   {
-    uint8_t fire_intensity = 64;
-    paintFireRing(0, NUM_LEDS/3*1, 180);
+    paintFireRing(Thirds::first(0), Thirds::first(1), 180);
     if (0 == ctr % 2)
-      paintFireRing(NUM_LEDS/3*1, NUM_LEDS/3*2, 128);
+      paintFireRing(Thirds::first(1), Thirds::first(2), 128);
     if (0 == ctr % 3)
-      paintFireRing(NUM_LEDS/3*2, NUM_LEDS, 64);
+      paintFireRing(Thirds::first(2), Thirds::first(3), 64);
     ctr++;
     return 1000/20;
   }
 };
 
+/// LED rings of the TOC fixture, center first
+typedef RingGeometry<1,8,12,16,24,32,27> TOCRingGeometry;
 
 class AnimationTOCFairyDustLandingRing : public BaseAnimation {
 private:
-  uint8_t led_ring_rings_ = 7;
-  const ledctr_t led_ring_sizes[7] = {1,8,12,16,24,32,27};
-  CRGB ring_colour_list_[7+1];
+  typedef TOCRingGeometry Rings;
+  uint8_t led_ring_rings_ = Rings::num_rings;
+  CRGB ring_colour_list_[Rings::num_rings+1];
   uint8_t step_ = 0;
   const uint8_t chance_of_color = 40;
   const uint8_t blend_steps = 4;
 
 public:
-  AnimationTOCFairyDustLandingRing(uint8_t num_rings=7) : led_ring_rings_(num_rings)
+  AnimationTOCFairyDustLandingRing(uint8_t num_rings=Rings::num_rings) : led_ring_rings_(min(num_rings, static_cast<uint8_t>(Rings::num_rings)))
   {
     for (uint8_t c=0; c<led_ring_rings_+1; c++)
     {
@@ -982,6 +1469,11 @@ public:
   {
     BaseAnimation::init();
     FastLED.setBrightness(80);
+    for (uint8_t c=0; c<led_ring_rings_+1; c++)
+    {
+      ring_colour_list_[c]=CRGB::Black;
+    }
+    step_ = 0;
   }
 
   virtual millis_t run()
@@ -995,21 +1487,19 @@ public:
       }
 
       //new outer color
-      if (random8() < chance_of_color)
+      if (random_stream_.next8() < chance_of_color)
       {
-        hsv2rgb_rainbow(CHSV(random8(),0xff,127+random8(128)),ring_colour_list_[led_ring_rings_]);
+        hsv2rgb_rainbow(CHSV(random_stream_.next8(),0xff,127+random_stream_.next8(128)),ring_colour_list_[led_ring_rings_]);
       } else {
         ring_colour_list_[led_ring_rings_] = CRGB::Black;
       }
     }
 
     //Draw and Blend
-    ledctr_t first_led_in_rings=0;
     for (uint8_t c=0; c<led_ring_rings_; c++)
     {
       CRGB blended = blend(ring_colour_list_[c],ring_colour_list_[c+1],0xFF/blend_steps * (step_%blend_steps));
-      CPixelView<CRGB>(leds_,first_led_in_rings, first_led_in_rings+led_ring_sizes[c]).fill_solid(blended);
-      first_led_in_rings += led_ring_sizes[c];
+      fill_solid(leds_ + Rings::first(c), Rings::size(c), blended);
     }
     step_++;
     return 1000/20;
@@ -1021,27 +1511,27 @@ public:
 
 class AnimationTOCFairyDustFire : public BaseAnimation {
 private:
-  uint8_t led_ring_rings_ = 7;
-  const ledctr_t led_ring_sizes[7] = {1,8,12,16,24,32,27};
-  // const ledctr_t led_ring_sizes[8] = {1,8,12,16,24,32,48,60};
+  typedef TOCRingGeometry Rings;
+  // typedef RingGeometry<1,8,12,16,24,32,48,60> Rings;
+  uint8_t led_ring_rings_ = Rings::num_rings;
   uint8_t fairydust_sparking = 60;
   uint8_t centric_heatwave_phase = 0;
   uint16_t step_ = 0;
 
 public:
-  AnimationTOCFairyDustFire(uint8_t num_rings=7):led_ring_rings_(num_rings)
+  AnimationTOCFairyDustFire(uint8_t num_rings=Rings::num_rings):led_ring_rings_(min(num_rings, static_cast<uint8_t>(Rings::num_rings)))
   {}
   
   virtual void init()
   {
     BaseAnimation::init();
     FastLED.setBrightness(80);
+    step_ = 0;
   }
 
   virtual millis_t run()
   {
     // fill_solid(leds_, NUM_LEDS, CRGB::Black);  
-    ledctr_t first_led_in_rings=0;
     for (uint8_t ring=0; ring<led_ring_rings_; ring++)
     {
       //uint8_t heat = 0xFF/(led_ring_rings_)*(led_ring_rings_-ring);
@@ -1049,9 +1539,8 @@ public:
       // uint8_t heat = quadwave8((step_/8)+led_ring_rings_-ring);
       uint8_t heat = static_cast<uint16_t>(cubicwave8(2*(led_ring_rings_-1-ring)+static_cast<uint8_t>(step_/7)))*8/10;
       CRGB colour = HeatColor(max(heat,8));
-      //CPixelView<CRGB>(leds_,first_led_in_rings, first_led_in_rings+led_ring_sizes[ring]).fill_solid(colour);
-      paintFireRing(first_led_in_rings, first_led_in_rings+led_ring_sizes[ring], 5+160/(led_ring_rings_)*(led_ring_rings_-ring), colour);
-      first_led_in_rings += led_ring_sizes[ring];
+      //fill_solid(leds_ + Rings::first(ring), Rings::size(ring), colour);
+      paintFireRing(Rings::first(ring), Rings::first(ring+1), 5+160/(led_ring_rings_)*(led_ring_rings_-ring), colour);
     }
     step_++;
     // uint8_t st = static_cast<uint16_t>(triwave8(static_cast<uint8_t>(step_/8)))*NUM_LEDS/255;
@@ -0,0 +1,118 @@
+#ifndef AUDIO_CAPTURE_INCLUDE__H
+#define AUDIO_CAPTURE_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Samples the microphone without PJRC Audio, for use with fixed_fft.h.
+/// An IntervalTimer interrupt reads the ADC at AUDIO_CAPTURE_RATE into one of two
+/// blocks of AUDIO_CAPTURE_BLOCK samples (ping-pong). Once a block is full, the
+/// interrupt continues in the other one and the full block can be analyzed from
+/// a task, until release(). If the task is too slow, the newest block is dropped
+/// and overruns() counts it.
+///
+/// Samples are signed 16bit (12bit ADC shifted up), with the microphone's DC bias
+/// removed by a slow running average (~0.1s).
+///
+/// At 44.1kHz the interrupt takes about 15% CPU on a Teensy 3.2 at 96MHz,
+/// mostly waiting for analogRead(). Lower AUDIO_CAPTURE_RATE if that is too much,
+/// but remember the FFT bins get narrower (rate/FFT_SIZE per bin).
+///
+/// Blocks have to be picked up before the next one is full, so with the mic task
+/// running every 1ms, FIXED_FFT_HOP should be at least 64 samples at 44.1kHz.
+///
+/// Needs IntervalTimer (Teensy) and fixed_fft.h. Uses the global audio_capture_.
+///
+
+#ifndef AUDIO_CAPTURE_RATE
+#define AUDIO_CAPTURE_RATE 44100
+#endif
+#define AUDIO_CAPTURE_BLOCK FIXED_FFT_HOP //one FFT hop, so a spectrum is due every block
+#define AUDIO_CAPTURE_DC_SHIFT 12 //running average over 2^12 samples
+
+class AudioCapture
+{
+private:
+  int16_t blocks_[2][AUDIO_CAPTURE_BLOCK];
+  volatile uint16_t pos_=0;
+  volatile uint8_t filling_=0; //block the interrupt writes
+  volatile bool ready_=false;  //block filling_^1 is full and not released
+  volatile uint32_t overruns_=0;
+  volatile uint32_t ready_us_=0; //micros() when the ready block was full
+  int32_t dc_=2048L << 8; //Q8 of the 12bit ADC value
+  uint8_t pin_=0;
+#if defined(TEENSYDUINO)
+  IntervalTimer timer_;
+#endif
+
+public:
+  /// starts sampling pin, false if there is no timer
+  bool begin(uint8_t pin, uint32_t rate=AUDIO_CAPTURE_RATE);
+
+  void end()
+  {
+#if defined(TEENSYDUINO)
+    timer_.end();
+#endif
+  }
+
+  /// called from the timer interrupt
+  void sample()
+  {
+    int32_t v = static_cast<int32_t>(analogRead(pin_)) << 8;
+    dc_ += (v - dc_) >> AUDIO_CAPTURE_DC_SHIFT;
+    int32_t s = (v - dc_) >> 4;
+    blocks_[filling_][pos_] = constrain(s, -32768, 32767);
+    if (++pos_ < AUDIO_CAPTURE_BLOCK)
+      return;
+    pos_ = 0;
+    if (ready_)
+    {
+      //other block not done yet, drop this one and fill it again
+      overruns_++;
+      return;
+    }
+    filling_ ^= 1;
+    ready_us_ = micros();
+    ready_ = true;
+  }
+
+  /// full block of AUDIO_CAPTURE_BLOCK samples, or nullptr. Valid until release()
+  const int16_t *readyBlock() const
+  {
+    if (!ready_)
+      return nullptr;
+    return blocks_[filling_ ^ 1];
+  }
+
+  /// capture time of the last sample in readyBlock()
+  uint32_t readyTimeUs() const { return ready_us_; }
+
+  void release()
+  {
+    ready_ = false;
+  }
+
+  uint32_t overruns() const { return overruns_; }
+};
+
+AudioCapture audio_capture_;
+
+void audioCaptureISR()
+{
+  audio_capture_.sample();
+}
+
+bool AudioCapture::begin(uint8_t pin, uint32_t rate)
+{
+  pin_ = pin;
+  analogReadResolution(12);
+  analogReadAveraging(1);
+#if defined(TEENSYDUINO)
+  return timer_.begin(audioCaptureISR, 1000000.0f / rate);
+#else
+  return false;
+#endif
+}
+
+#endif //AUDIO_CAPTURE_INCLUDE__H
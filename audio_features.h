@@ -0,0 +1,144 @@
+#ifndef AUDIO_FEATURES_INCLUDE__H
+#define AUDIO_FEATURES_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Audio analysis results, as the audio animations see them.
+/// Whatever produces audio (PJRC Audio analyzers, file replay, ...) writes
+/// audio_features_, animations only read it. So animations do not care where
+/// the sound comes from.
+///
+/// Every producer bumps a sequence number with new values. Each animation keeps
+/// its own AudioFeatureReader, so both animations of a crossfade see every update.
+/// Producers pass the micros() their newest sample was captured at, readers
+/// report what they read to audio_latency_ (see latency.h).
+///
+/// // example use in an animation:
+/// AudioFeatureReader audio_;
+/// ...
+/// if (!audio_.newFFT())
+///   return 2;
+/// uint16_t bin3 = audio_features_.fft[3];
+///
+
+#ifndef FFT_SIZE
+#define FFT_SIZE 256
+#endif
+#define FFT_BINS (FFT_SIZE/2)
+
+#define AUDIO_FULL_SCALE 32767 //rms and peak of a full scale signal
+#define AUDIO_PEAK_HISTORY 8 //power of 2, level updates a reader can miss without missing a peak
+
+#include "latency.h"
+
+struct AudioFeatures
+{
+  uint16_t rms=0;  //0..AUDIO_FULL_SCALE
+  uint16_t peak=0; //0..AUDIO_FULL_SCALE, max absolute sample
+  uint16_t fft[FFT_BINS] = {0}; //magnitude |X|/N per bin, same scale as AudioAnalyzeFFT256::output
+  uint32_t level_seq=0; //incremented on new rms and peak
+  uint32_t fft_seq=0;   //incremented on new fft
+  uint16_t peak_history[AUDIO_PEAK_HISTORY] = {0}; //by level_seq
+  uint32_t level_capture_us=0; //micros() of the newest sample in rms and peak
+  uint32_t level_publish_us=0;
+  uint32_t fft_capture_us=0;   //micros() of the newest sample in fft
+  uint32_t fft_publish_us=0;
+
+  void setLevels(uint16_t new_rms, uint16_t new_peak, uint32_t capture_us)
+  {
+    rms = new_rms;
+    peak = new_peak;
+    level_capture_us = capture_us;
+    level_publish_us = micros();
+    level_seq++;
+    peak_history[level_seq % AUDIO_PEAK_HISTORY] = new_peak;
+    audio_latency_.published(capture_us, level_publish_us);
+  }
+
+  void setFFT(const uint16_t *bins, uint32_t capture_us)
+  {
+    memcpy(fft, bins, sizeof(fft));
+    fft_capture_us = capture_us;
+    fft_publish_us = micros();
+    fft_seq++;
+    audio_latency_.published(capture_us, fft_publish_us);
+  }
+};
+
+AudioFeatures audio_features_;
+
+class AudioFeatureReader
+{
+private:
+  uint32_t level_seen_=0;
+  uint32_t fft_seen_=0;
+  uint16_t peak_=0;
+
+public:
+  /// true if rms/peak changed since the last call
+  bool newLevels()
+  {
+    uint32_t seq = audio_features_.level_seq;
+    if (seq == level_seen_)
+      return false;
+    uint32_t missed = min(seq - level_seen_, static_cast<uint32_t>(AUDIO_PEAK_HISTORY));
+    peak_ = 0;
+    for (uint32_t s=seq-missed+1; s!=seq+1; s++)
+      peak_ = max(peak_, audio_features_.peak_history[s % AUDIO_PEAK_HISTORY]);
+    level_seen_ = seq;
+    audio_latency_.consumed(audio_features_.level_capture_us, audio_features_.level_publish_us, micros());
+    return true;
+  }
+
+  /// highest peak of all updates up to the last newLevels(),
+  /// like AudioAnalyzePeak::read() gives the peak since the last read()
+  uint16_t peak() const { return peak_; }
+
+  /// true once for every new spectrum
+  bool newFFT()
+  {
+    if (audio_features_.fft_seq == fft_seen_)
+      return false;
+    fft_seen_ = audio_features_.fft_seq;
+    audio_latency_.consumed(audio_features_.fft_capture_us, audio_features_.fft_publish_us, micros());
+    return true;
+  }
+};
+
+/// floor(sqrt(x)), bit by bit
+inline uint16_t audioSqrt32(uint32_t x)
+{
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > x)
+    bit >>= 2;
+  while (bit != 0)
+  {
+    if (x >= root + bit)
+    {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+/// rms and peak of a block of samples captured until capture_us, into audio_features_
+inline void audioAnalyzeLevels(const int16_t *block, uint16_t num_samples, uint32_t capture_us)
+{
+  uint64_t sum_sq = 0;
+  uint16_t peak = 0;
+  for (uint16_t s=0; s<num_samples; s++)
+  {
+    int32_t v = block[s];
+    sum_sq += v*v;
+    peak = max(peak, static_cast<uint16_t>(min((v < 0) ? -v : v, AUDIO_FULL_SCALE)));
+  }
+  audio_features_.setLevels(audioSqrt32(sum_sq / num_samples), peak, capture_us);
+}
+
+#endif //AUDIO_FEATURES_INCLUDE__H
@@ -0,0 +1,296 @@
+#ifndef AUDIO_REPLAY_INCLUDE__H
+#define AUDIO_REPLAY_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Replays a WAV (16bit PCM, mono or stereo, left channel is used) or raw
+/// (16bit mono, little endian) file from SD card through the same analysis the
+/// PJRC Audio analyzers do, into audio_features_:
+///  * rms and peak per block of AUDIO_BLOCK_SAMPLES
+///  * 256 point FFT over the last two blocks, Hann window, arm_cfft_radix4_q15,
+///    magnitude averaged over REPLAY_FFT_AVERAGE FFTs, like AudioAnalyzeFFT256
+///
+/// In real time, a block is read whenever the clock has passed it,
+/// so the animations react to the file instead of the microphone.
+/// replayFast() reads the file as fast as the card delivers, rendering an
+/// animation in simulated time, to check beat response and throughput.
+/// Needs PJRC Audio (for CMSIS arm_math) and animations.h.
+///
+/// // example use:
+/// AudioReplay audio_replay_;
+/// audio_replay_.begin("REPLAY.WAV");
+/// while (audio_replay_.behind(micros()) && audio_replay_.nextBlock());
+///
+
+#define REPLAY_FFT_AVERAGE 8 //AudioAnalyzeFFT256 default
+#define REPLAY_MIN_FRAME_US 1000
+
+class AudioReplay
+{
+private:
+  File file_;
+  bool active_=false;
+  uint8_t channels_=1;
+  uint32_t sample_rate_=44100;
+  uint32_t data_left_=0; //bytes
+  uint32_t blocks_=0;
+  micros_t start_us_=0;
+
+  int16_t prev_block_[AUDIO_BLOCK_SAMPLES];
+  bool have_prev_=false;
+  int16_t fft_buffer_[FFT_SIZE*2] __attribute__ ((aligned (4))); //interleaved re, im
+  uint32_t fft_sum_[FFT_BINS];
+  uint16_t fft_out_[FFT_BINS];
+  uint8_t fft_count_=0;
+  arm_cfft_radix4_instance_q15 fft_inst_;
+
+  uint32_t readLE(uint8_t bytes)
+  {
+    uint8_t b[4] = {0};
+    file_.read(b, bytes);
+    return static_cast<uint32_t>(b[0]) | static_cast<uint32_t>(b[1]) << 8 | static_cast<uint32_t>(b[2]) << 16 | static_cast<uint32_t>(b[3]) << 24;
+  }
+
+  /// skips to the data chunk, false if not a 16bit PCM WAV
+  bool parseWavHeader()
+  {
+    char id[4];
+    file_.read(id, 4); //"WAVE"
+    if (0 != memcmp(id, "WAVE", 4))
+      return false;
+    bool have_format = false;
+    while (file_.available() >= 8)
+    {
+      file_.read(id, 4);
+      uint32_t chunk_size = readLE(4);
+      uint32_t chunk_start = file_.position();
+      if (0 == memcmp(id, "fmt ", 4))
+      {
+        uint16_t format = readLE(2);
+        channels_ = readLE(2);
+        sample_rate_ = readLE(4);
+        readLE(4); //byte rate
+        readLE(2); //block align
+        uint16_t bits = readLE(2);
+        if (1 != format || 16 != bits || channels_ < 1 || channels_ > 2)
+          return false;
+        have_format = true;
+      } else if (0 == memcmp(id, "data", 4))
+      {
+        data_left_ = chunk_size;
+        return have_format;
+      }
+      file_.seek(chunk_start + chunk_size + (chunk_size & 1));
+    }
+    return false;
+  }
+
+  /// next block of samples, left channel only. false at end of file
+  bool readBlock(int16_t *block)
+  {
+    const uint16_t frame_bytes = 2*channels_;
+    if (data_left_ < AUDIO_BLOCK_SAMPLES*frame_bytes)
+      return false;
+    int16_t frames[AUDIO_BLOCK_SAMPLES*2];
+    if (file_.read(frames, AUDIO_BLOCK_SAMPLES*frame_bytes) != AUDIO_BLOCK_SAMPLES*frame_bytes)
+      return false;
+    data_left_ -= AUDIO_BLOCK_SAMPLES*frame_bytes;
+    for (uint16_t s=0; s<AUDIO_BLOCK_SAMPLES; s++)
+    {
+      block[s] = frames[s*channels_];
+    }
+    return true;
+  }
+
+  void analyzeFFT(const int16_t *block, micros_t capture_us)
+  {
+    if (!have_prev_)
+    {
+      memcpy(prev_block_, block, sizeof(prev_block_));
+      have_prev_ = true;
+      return;
+    }
+    for (uint16_t s=0; s<AUDIO_BLOCK_SAMPLES; s++)
+    {
+      fft_buffer_[2*s] = (static_cast<int32_t>(prev_block_[s]) * AudioWindowHanning256[s]) >> 15;
+      fft_buffer_[2*s+1] = 0;
+      fft_buffer_[2*(s+AUDIO_BLOCK_SAMPLES)] = (static_cast<int32_t>(block[s]) * AudioWindowHanning256[s+AUDIO_BLOCK_SAMPLES]) >> 15;
+      fft_buffer_[2*(s+AUDIO_BLOCK_SAMPLES)+1] = 0;
+    }
+    memcpy(prev_block_, block, sizeof(prev_block_));
+    arm_cfft_radix4_q15(&fft_inst_, fft_buffer_);
+
+    for (uint16_t b=0; b<FFT_BINS; b++)
+    {
+      int32_t re = fft_buffer_[2*b];
+      int32_t im = fft_buffer_[2*b+1];
+      uint32_t magsq = static_cast<uint32_t>(re*re) + static_cast<uint32_t>(im*im);
+      if (0 == fft_count_)
+        fft_sum_[b] = magsq / REPLAY_FFT_AVERAGE;
+      else
+        fft_sum_[b] += magsq / REPLAY_FFT_AVERAGE;
+    }
+    if (++fft_count_ == REPLAY_FFT_AVERAGE)
+    {
+      fft_count_ = 0;
+      for (uint16_t b=0; b<FFT_BINS; b++)
+      {
+        fft_out_[b] = audioSqrt32(fft_sum_[b]);
+      }
+      audio_features_.setFFT(fft_out_, capture_us);
+    }
+  }
+
+public:
+  /// opens filename, WAV if it starts with RIFF, raw 16bit mono otherwise
+  bool begin(const char *filename)
+  {
+    end();
+    file_ = SD.open(filename);
+    if (!file_)
+      return false;
+    char riff[4];
+    channels_ = 1;
+    sample_rate_ = AUDIO_SAMPLE_RATE_EXACT;
+    if (file_.read(riff, 4) == 4 && 0 == memcmp(riff, "RIFF", 4))
+    {
+      readLE(4); //RIFF size
+      if (!parseWavHeader())
+      {
+        file_.close();
+        return false;
+      }
+    } else {
+      file_.seek(0);
+      data_left_ = file_.size();
+    }
+    arm_cfft_radix4_init_q15(&fft_inst_, FFT_SIZE, 0, 1);
+    have_prev_ = false;
+    fft_count_ = 0;
+    blocks_ = 0;
+    start_us_ = micros();
+    active_ = true;
+    return true;
+  }
+
+  void end()
+  {
+    if (active_)
+      file_.close();
+    active_ = false;
+  }
+
+  bool active() const { return active_; }
+  uint32_t blocks() const { return blocks_; }
+  uint32_t sampleRate() const { return sample_rate_; }
+
+  /// position in the file as time, in us
+  uint64_t audioTimeUs() const
+  {
+    return static_cast<uint64_t>(blocks_) * AUDIO_BLOCK_SAMPLES * 1000000 / sample_rate_;
+  }
+
+  /// true if the clock has passed the next block (real time replay)
+  bool behind(micros_t now) const
+  {
+    //modulo 2^32 on both sides, so this works for files longer than micros() takes to wrap
+    return active_ && timeReached(now, captureTimeUs());
+  }
+
+  /// when the last block read would have been captured, had the file been played from begin()
+  micros_t captureTimeUs() const
+  {
+    return start_us_ + static_cast<micros_t>(audioTimeUs());
+  }
+
+  /// reads and analyzes the next block. At the end of the file, ends and returns false.
+  bool nextBlock()
+  {
+    if (!active_)
+      return false;
+    int16_t block[AUDIO_BLOCK_SAMPLES];
+    if (!readBlock(block))
+    {
+      end();
+      return false;
+    }
+    blocks_++;
+    micros_t capture_us = captureTimeUs();
+    audioAnalyzeLevels(block, AUDIO_BLOCK_SAMPLES, capture_us);
+    analyzeFFT(block, capture_us);
+    return true;
+  }
+};
+
+struct ReplayResult
+{
+  uint32_t frames;
+  uint32_t onsets;
+  uint32_t audio_ms;
+  uint32_t wall_ms;
+};
+
+/// renders animation idx over the whole file in simulated time, as fast as possible.
+/// Prints every onset the octave onset detector finds (audio time) and the throughput.
+/// animation_clock_ is simulated as well, advanced by the delay every frame asks for.
+template <class Registry>
+ReplayResult replayFast(Print &out, AudioReplay &replay, Registry &animations, uint8_t idx)
+{
+  OctaveOnsetDetector onsets;
+  uint32_t fft_seen = audio_features_.fft_seq;
+  uint64_t next_frame_us = 0;
+  uint32_t frames = 0;
+  uint32_t num_onsets = 0;
+  uint32_t start_ms = millis();
+
+  animation_clock_.simulate(0);
+  animations.init(idx);
+  out.println("# onset_ms\tstrength");
+  while (replay.nextBlock())
+  {
+    uint64_t audio_us = replay.audioTimeUs();
+    if (audio_features_.fft_seq != fft_seen)
+    {
+      fft_seen = audio_features_.fft_seq;
+      uint8_t octaves[NUM_OCTAVES];
+      fft_calc_octaves255_from_bins(audio_features_.fft, octaves);
+      onsets.update(octaves);
+      if (onsets.onset())
+      {
+        num_onsets++;
+        out.print(static_cast<uint32_t>(audio_us / 1000));
+        out.print('\t');
+        out.println(onsets.strength());
+      }
+    }
+    while (audio_us >= next_frame_us)
+    {
+      millis_t delay_ms = max(animations.run(idx), static_cast<millis_t>(REPLAY_MIN_FRAME_US/1000));
+      next_frame_us += static_cast<uint64_t>(delay_ms)*1000;
+      animation_clock_.advance(delay_ms);
+      frames++;
+    }
+  }
+  animation_clock_.realTime();
+  uint32_t wall_ms = millis() - start_ms;
+  if (0 == wall_ms)
+    wall_ms = 1;
+  uint32_t audio_ms = replay.audioTimeUs() / 1000;
+
+  out.print("# audio ms ");
+  out.print(audio_ms);
+  out.print(" wall ms ");
+  out.print(wall_ms);
+  out.print(" x realtime ");
+  out.print(audio_ms / wall_ms);
+  out.print(" blocks/s ");
+  out.print(static_cast<uint32_t>(1000ULL * replay.blocks() / wall_ms));
+  out.print(" frames ");
+  out.print(frames);
+  out.print(" onsets ");
+  out.println(num_onsets);
+  return ReplayResult{frames, num_onsets, audio_ms, wall_ms};
+}
+
+#endif //AUDIO_REPLAY_INCLUDE__H
@@ -0,0 +1,567 @@
+#ifndef BENCHMARK_INCLUDE__H
+#define BENCHMARK_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+#include <malloc.h>
+
+/// Frame-time benchmark for animations.
+/// Runs on the target itself, so numbers are real Cortex-M4 numbers
+/// and not those of some desktop CPU. The host build (CMakeLists.txt) runs the same
+/// code for several NUM_LEDS at once, see host/benchmark.cpp.
+///
+/// // example use (needs animations.h):
+/// benchmarkAnimations(Serial, animations_, 200);
+///
+/// Prints one line per animation:
+///   index, ns/frame (mean), ns/frame (max), frames/s, ns/LED, heap bytes allocated,
+///   heap allocations (host only, newlib does not count them),
+///   estimated us/frame at 300, 1000 and 4000 LEDs, max LEDs at 60 frames/s
+///
+/// Only run() is timed, in CPU cycles. FastLED.show() is timed once separately since it does not
+/// depend on the animation. The estimates scale run() plus show() linearly per LED,
+/// which holds since every animation does a fixed amount of work per LED and frame.
+/// WS2812Serial sends by DMA while the next frame is computed, so the wire time of
+/// 30us per LED is a separate limit per data pin, printed once.
+/// Every frame gets a new synthetic spectrum (benchmarkAudio()), so audio animations
+/// do their real work instead of returning early for lack of new audio.
+
+#include "cycle_counter.h"
+
+#define BENCHMARK_DEFAULT_FRAMES 200
+#define BENCHMARK_FRAME_US_60FPS (1000000/60)
+#define BENCHMARK_KICK_PERIOD 25 //frames
+
+inline int32_t benchmarkHeapInUse()
+{
+#ifdef HOST_BUILD
+  struct mallinfo2 mi = mallinfo2(); //glibc deprecates mallinfo()
+#else
+  struct mallinfo mi = mallinfo();
+#endif
+  return mi.uordblks;
+}
+
+inline void benchmarkPrintAllocations(Print &out, uint32_t before)
+{
+#ifdef HOST_BUILD
+  out.print(host_allocations_ - before);
+#else
+  (void) before;
+  out.print('-');
+#endif
+}
+
+inline uint32_t benchmarkAllocations()
+{
+#ifdef HOST_BUILD
+  return host_allocations_;
+#else
+  return 0;
+#endif
+}
+
+inline void benchmarkPrintHeader(Print &out)
+{
+  out.print("# NUM_LEDS ");
+  out.println(NUM_LEDS);
+  out.println("# anim\tns_mean\tns_max\tfps\tns_led\theap\tallocs\tus_300\tus_1000\tus_4000\tmax_leds_60fps");
+}
+
+/// estimated frame time in us for num_leds, from run() and show() cost per LED
+inline uint32_t benchmarkScaledFrameUs(uint32_t ns_led, uint32_t show_ns_led, uint32_t num_leds)
+{
+  return static_cast<uint64_t>(ns_led + show_ns_led) * num_leds / 1000;
+}
+
+/// publishes levels and a spectrum for frame: a kick every BENCHMARK_KICK_PERIOD frames over noise
+inline void benchmarkAudio(uint16_t frame)
+{
+#ifdef USE_AUDIO
+  uint16_t level = (frame % BENCHMARK_KICK_PERIOD < 3) ? 12000 : 500 + random_stream_.next8();
+  uint16_t bins[FFT_BINS];
+  for (uint16_t b=0; b<FFT_BINS; b++)
+    bins[b] = (level >> min(b/8, 12)) + random_stream_.next8(64);
+  uint32_t now = micros();
+  audio_features_.setLevels(level, min(level*2, AUDIO_FULL_SCALE), now);
+  audio_features_.setFFT(bins, now);
+#else
+  (void) frame;
+#endif
+}
+
+template <class Registry>
+void benchmarkAnimation(Print &out, Registry &animations, uint8_t idx, uint16_t frames, uint32_t show_ns_led=0)
+{
+  const uint32_t cycles_per_us = F_CPU / 1000000;
+  int32_t heap_before = benchmarkHeapInUse();
+  uint32_t allocs_before = benchmarkAllocations();
+  uint64_t sum_cycles = 0;
+  uint32_t max_cycles = 0;
+
+  animations.init(idx);
+  for (uint16_t f=0; f<frames; f++)
+  {
+    benchmarkAudio(f);
+    uint32_t start = cycleCount();
+    animations.run(idx);
+    uint32_t took = cycleCount() - start;
+    sum_cycles += took;
+    max_cycles = max(max_cycles, took);
+  }
+  int32_t heap_after = benchmarkHeapInUse();
+
+  uint64_t sum_ns = sum_cycles * 1000 / cycles_per_us;
+  uint32_t ns_led = sum_ns / frames / NUM_LEDS;
+  out.print(idx);
+  out.print('\t');
+  out.print(static_cast<uint32_t>(sum_ns / frames));
+  out.print('\t');
+  out.print(static_cast<uint32_t>(static_cast<uint64_t>(max_cycles) * 1000 / cycles_per_us));
+  out.print('\t');
+  out.print((sum_ns > 0) ? static_cast<uint32_t>(1000000000ULL*frames/sum_ns) : 0);
+  out.print('\t');
+  out.print(ns_led);
+  out.print('\t');
+  out.print(heap_after - heap_before);
+  out.print('\t');
+  benchmarkPrintAllocations(out, allocs_before);
+  out.print('\t');
+  out.print(benchmarkScaledFrameUs(ns_led, show_ns_led, 300));
+  out.print('\t');
+  out.print(benchmarkScaledFrameUs(ns_led, show_ns_led, 1000));
+  out.print('\t');
+  out.print(benchmarkScaledFrameUs(ns_led, show_ns_led, 4000));
+  out.print('\t');
+  out.println((ns_led + show_ns_led > 0) ? static_cast<uint32_t>(1000ULL*BENCHMARK_FRAME_US_60FPS/(ns_led + show_ns_led)) : 0);
+}
+
+/// times FastLED.show(), returns ns per LED
+uint32_t benchmarkShow(Print &out, uint16_t frames)
+{
+  uint32_t start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    FastLED.show();
+  }
+  uint32_t took = micros() - start;
+  out.print("# FastLED.show() us/frame ");
+  out.println(took / frames);
+  out.print("# wire limit LEDs per data pin at 60fps ");
+  out.println(static_cast<uint32_t>(1000ULL*(BENCHMARK_FRAME_US_60FPS - STRIP_WIRE_RESET_US) / STRIP_WIRE_NS_PER_LED));
+  return static_cast<uint32_t>(1000ULL*took/frames/NUM_LEDS);
+}
+
+/// times run() of the animation at index I three ways: through animations.run() with the index
+/// only known at run time, like task_animate_leds() calls it, as a direct call, and as a virtual call.
+/// registry minus direct is what the compare chain of the registry costs at that index.
+template <size_t I, class Registry>
+void benchmarkDispatchAt(Print &out, Registry &animations, uint32_t calls)
+{
+  typedef typename std::remove_reference<decltype(animations.template at<I>())>::type Anim;
+  Anim &anim = animations.template at<I>();
+  BaseAnimation * volatile base = &anim; //volatile, so the compiler can not devirtualize
+  volatile uint8_t idx = I; //volatile, so the compiler can not resolve the compare chain
+  volatile millis_t sink = 0;
+  animations.init(I);
+
+  uint32_t start = micros();
+  for (uint32_t c=0; c<calls; c++)
+  {
+    sink = animations.run(idx);
+  }
+  uint32_t registry_us = micros() - start;
+
+  start = micros();
+  for (uint32_t c=0; c<calls; c++)
+  {
+    sink = anim.Anim::run();
+  }
+  uint32_t direct_us = micros() - start;
+
+  start = micros();
+  for (uint32_t c=0; c<calls; c++)
+  {
+    sink = base->run();
+  }
+  uint32_t virtual_us = micros() - start;
+  (void) sink;
+
+  out.print("# dispatch ns/call anim ");
+  out.print(I);
+  out.print(" registry ");
+  out.print(static_cast<uint32_t>(1000ULL*registry_us/calls));
+  out.print(" direct ");
+  out.print(static_cast<uint32_t>(1000ULL*direct_us/calls));
+  out.print(" virtual ");
+  out.println(static_cast<uint32_t>(1000ULL*virtual_us/calls));
+}
+
+/// dispatch cost of the registry at its first and its last index, where the compare chain is longest
+template <class Registry>
+void benchmarkDispatch(Print &out, Registry &animations, uint32_t calls=10000)
+{
+  benchmarkDispatchAt<0>(out, animations, calls);
+  benchmarkDispatchAt<Registry::size()-1>(out, animations, calls);
+}
+
+/// pixel_kernels.h against the per-pixel loops they replaced in AnimationFireworks and AnimationFire2012
+void benchmarkPixelKernels(Print &out, uint16_t frames=200)
+{
+  static uint8_t heat[NUM_LEDS]; //static, a long strip would not fit on the stack
+  for (ledctr_t l=0; l<NUM_LEDS; l++)
+  {
+    heat[l] = random8();
+    leds_[l] = CRGB(random8(), random8(), random8());
+  }
+
+  uint32_t start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    fadeToBlackBy(leds_,NUM_LEDS,127);
+    for (ledctr_t i=1; i<NUM_LEDS-1; i++) //old loop, minus its read past the end
+    {
+      uint32_t prevLed = (ledGetColorCode(leds_[i-1]) >> 2) & 0x3F3F3F3F;
+      uint32_t thisLed = ledGetColorCode(leds_[i]);
+      uint32_t nextLed = (ledGetColorCode(leds_[i+1]) >> 2) & 0x3F3F3F3F;
+      leds_[i] = CRGB(prevLed + thisLed + nextLed);
+    }
+  }
+  uint32_t blur_loop_us = micros() - start;
+
+  start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    fadePixels(leds_,NUM_LEDS,127);
+    diffusePixels(leds_,NUM_LEDS);
+  }
+  uint32_t blur_kernel_us = micros() - start;
+
+  start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    for (int k=NUM_LEDS-1; k>=2; k--)
+    {
+      heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 2] ) / 3;
+    }
+  }
+  uint32_t heat_loop_us = micros() - start;
+
+  start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    diffuseHeat(heat, NUM_LEDS);
+  }
+  uint32_t heat_kernel_us = micros() - start;
+
+  out.print("# fade+blur us/frame loop ");
+  out.print(blur_loop_us / frames);
+  out.print(" kernel ");
+  out.println(blur_kernel_us / frames);
+  out.print("# heat diffusion us/frame loop ");
+  out.print(heat_loop_us / frames);
+  out.print(" kernel ");
+  out.println(heat_kernel_us / frames);
+}
+
+/// random bytes for a per-LED loop like Fire2012 cooling:
+/// FastLED random8(), Arduino random() and RandomStream, per call and per block
+void benchmarkRandom(Print &out, uint16_t frames=100)
+{
+  volatile uint8_t sink = 0;
+  const uint8_t lim = 42;
+
+  uint32_t start = micros();
+  for (uint16_t f=0; f<frames; f++)
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+      sink = random8(lim);
+  uint32_t fastled_us = micros() - start;
+
+  start = micros();
+  for (uint16_t f=0; f<frames; f++)
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+      sink = random(lim);
+  uint32_t arduino_us = micros() - start;
+
+  start = micros();
+  for (uint16_t f=0; f<frames; f++)
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+      sink = random_stream_.next8(lim);
+  uint32_t stream_us = micros() - start;
+
+  start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    for (ledctr_t l=0; l<NUM_LEDS; )
+    {
+      ledctr_t chunk = min(static_cast<ledctr_t>(NUM_LEDS) - l, static_cast<ledctr_t>(RANDOM_STREAM_BLOCK));
+      const uint8_t *rnd = random_stream_.take(chunk);
+      for (ledctr_t c=0; c<chunk; c++, l++)
+        sink = RandomStream::range8(rnd[c], lim);
+    }
+  }
+  uint32_t block_us = micros() - start;
+  (void) sink;
+
+  uint32_t calls = static_cast<uint32_t>(frames) * NUM_LEDS;
+  out.print("# random ns/byte random8 ");
+  out.print(static_cast<uint32_t>(1000ULL*fastled_us/calls));
+  out.print(" random() ");
+  out.print(static_cast<uint32_t>(1000ULL*arduino_us/calls));
+  out.print(" stream ");
+  out.print(static_cast<uint32_t>(1000ULL*stream_us/calls));
+  out.print(" stream block ");
+  out.println(static_cast<uint32_t>(1000ULL*block_us/calls));
+}
+
+/// AnimationFFTOctaves painting: hsv2rgb_rainbow() per octave plus interpolation loop,
+/// against the rainbow_lut_ color stage with paintSpectrumInterpolated()
+void benchmarkSpectrumColors(Print &out, uint16_t frames=200)
+{
+  const ledctr_t width = NUM_OCTAVES*2-1;
+  uint8_t mag[NUM_OCTAVES];
+
+  uint32_t start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    memcpy(mag, random_stream_.take(NUM_OCTAVES), NUM_OCTAVES);
+    for (ledctr_t rep=0; rep<NUM_LEDS/width; rep++)
+    {
+      ledctr_t start_pos = width*rep;
+      for (ledctr_t o=0; o<NUM_OCTAVES; o++)
+        hsv2rgb_rainbow(CHSV(mag[o] + rep*30, blend8(150,0xff,mag[o]), mag[o]), leds_[start_pos+o*2]);
+      for (ledctr_t o=0; o<NUM_OCTAVES-1; o++)
+      {
+        ledctr_t pos = start_pos+o*2;
+        leds_[pos+1].r = (static_cast<uint16_t>(leds_[pos].r)+static_cast<uint16_t>(leds_[pos+2].r)) / 2;
+        leds_[pos+1].g = (static_cast<uint16_t>(leds_[pos].g)+static_cast<uint16_t>(leds_[pos+2].g)) / 2;
+        leds_[pos+1].b = (static_cast<uint16_t>(leds_[pos].b)+static_cast<uint16_t>(leds_[pos+2].b)) / 2;
+      }
+    }
+  }
+  uint32_t hsv_us = micros() - start;
+
+  start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    memcpy(mag, random_stream_.take(NUM_OCTAVES), NUM_OCTAVES);
+    ColorScale scale[NUM_OCTAVES];
+    CRGB colors[NUM_OCTAVES];
+    for (ledctr_t o=0; o<NUM_OCTAVES; o++)
+      scale[o] = colorScale(blend8(150,0xff,mag[o]), mag[o]);
+    for (ledctr_t rep=0; rep<NUM_LEDS/width; rep++)
+    {
+      for (ledctr_t o=0; o<NUM_OCTAVES; o++)
+        colors[o] = applyColorScale(rainbow_lut_.hue(mag[o] + rep*30), scale[o]);
+      paintSpectrumInterpolated(&leds_[width*rep], colors, NUM_OCTAVES);
+    }
+  }
+  uint32_t lut_us = micros() - start;
+
+  out.print("# spectrum colors us/frame hsv2rgb ");
+  out.print(hsv_us / frames);
+  out.print(" lut ");
+  out.println(lut_us / frames);
+}
+
+#ifdef FIXED_FFT_INCLUDE__H
+#define BENCHMARK_AUDIO_RATE 44100
+
+/// cycles of one FixedFFT<FFT_SIZE>, and what that means for CPU load and latency
+/// at 44.1kHz with different hops (overlap) and averaging
+void benchmarkSpectrumAnalysis(Print &out, uint16_t runs=20)
+{
+  FixedFFT<FFT_SIZE> fft;
+  int16_t samples[FFT_SIZE];
+  uint16_t mag[FFT_SIZE/2];
+  for (uint16_t n=0; n<FFT_SIZE; n++)
+    samples[n] = random_stream_.next16();
+
+  cycleCounterBegin();
+  uint32_t start = cycleCount();
+  for (uint16_t r=0; r<runs; r++)
+    fft.magnitudes(samples, mag);
+  uint32_t fft_cycles = (cycleCount() - start) / runs;
+
+  out.print("# fixed fft N ");
+  out.print(FFT_SIZE);
+  out.print(" cycles ");
+  out.print(fft_cycles);
+  out.print(" us ");
+  out.println(fft_cycles / (F_CPU / 1000000));
+  out.println("# hop\taverage\tspectra_per_s\tcpu_permille\tlatency_us");
+  const uint8_t averages[] = {1, FIXED_FFT_AVERAGE};
+  for (uint16_t hop=FFT_SIZE/2; hop>=FFT_SIZE/8; hop/=2)
+  {
+    for (uint8_t average : averages)
+    {
+      uint32_t ffts_per_s = BENCHMARK_AUDIO_RATE / hop;
+      out.print(hop);
+      out.print('\t');
+      out.print(average);
+      out.print('\t');
+      out.print(ffts_per_s / average);
+      out.print('\t');
+      out.print(static_cast<uint32_t>(static_cast<uint64_t>(fft_cycles) * ffts_per_s / (F_CPU / 1000)));
+      out.print('\t');
+      out.println(fftLatencyUs(FFT_SIZE, hop, average, BENCHMARK_AUDIO_RATE));
+    }
+  }
+}
+
+#define BENCHMARK_IMPULSE_AT_US 1000000 //silence before, so the animation settles
+#define BENCHMARK_IMPULSE_WAIT_US 500000
+#define BENCHMARK_MIN_FRAME_US 1000
+
+/// a decaying 80Hz kick drum, t_us after it started
+inline int16_t benchmarkKick(uint32_t t_us)
+{
+  if (t_us > 100000)
+    return 0;
+  return 24000.0 * exp(-(t_us / 30000.0)) * sin(2.0 * M_PI * 80.0 * t_us / 1000000.0);
+}
+
+struct ImpulseLatency
+{
+  bool reacted;
+  uint32_t render_us; //impulse to the frame that shows it, as scheduled
+  uint32_t wire_end_us; //plus sending that frame through strip_layout_
+  uint32_t frames; //frames since the impulse, including that one
+};
+
+/// feeds silence, then a kick drum through the fixed_fft.h analysis into animation idx,
+/// in simulated time (animation_clock_ too) like replayFast(). Prints and returns after how long (and how many frames)
+/// the LEDs first get clearly brighter than during the silence.
+template <class Registry>
+ImpulseLatency benchmarkImpulseLatency(Print &out, Registry &animations, uint8_t idx)
+{
+  FixedFFTAnalyzer<FFT_SIZE, FIXED_FFT_HOP, FIXED_FFT_AVERAGE> analyzer(FIXED_FFT_WINDOW);
+  int16_t block[FIXED_FFT_HOP];
+  uint64_t samples = 0;
+  uint64_t next_frame_us = 0;
+  uint32_t baseline = 0;
+  uint32_t frames_after = 0;
+  const uint32_t wire_us = strip_layout_.frameWireUs();
+
+  animation_clock_.simulate(0);
+  animations.init(idx);
+  while (true)
+  {
+    for (uint16_t s=0; s<FIXED_FFT_HOP; s++)
+    {
+      uint32_t t_us = (samples + s) * 1000000 / BENCHMARK_AUDIO_RATE;
+      block[s] = (t_us >= BENCHMARK_IMPULSE_AT_US) ? benchmarkKick(t_us - BENCHMARK_IMPULSE_AT_US) : 0;
+    }
+    samples += FIXED_FFT_HOP;
+    uint64_t now_us = samples * 1000000 / BENCHMARK_AUDIO_RATE;
+    if (now_us > BENCHMARK_IMPULSE_AT_US + BENCHMARK_IMPULSE_WAIT_US)
+      break;
+    analyzer.analyze(block, FIXED_FFT_HOP, now_us);
+
+    while (now_us >= next_frame_us)
+    {
+      uint64_t frame_us = next_frame_us;
+      millis_t delay_ms = max(animations.run(idx), static_cast<millis_t>(BENCHMARK_MIN_FRAME_US/1000));
+      next_frame_us += static_cast<uint64_t>(delay_ms)*1000;
+      animation_clock_.advance(delay_ms);
+      uint32_t brightness = 0;
+      for (ledctr_t l=0; l<NUM_LEDS; l++)
+        brightness += leds_[l].r + leds_[l].g + leds_[l].b;
+      if (frame_us < BENCHMARK_IMPULSE_AT_US)
+      {
+        if (frame_us + BENCHMARK_IMPULSE_WAIT_US >= BENCHMARK_IMPULSE_AT_US)
+          baseline = max(baseline, brightness);
+        continue;
+      }
+      frames_after++;
+      if (brightness > baseline + baseline/8 + NUM_LEDS)
+      {
+        uint32_t render_us = frame_us - BENCHMARK_IMPULSE_AT_US;
+        out.print("# impulse to frame us ");
+        out.print(render_us);
+        out.print(" to wire end us ");
+        out.print(render_us + wire_us);
+        out.print(" frames ");
+        out.println(frames_after);
+        animation_clock_.realTime();
+        return ImpulseLatency{true, render_us, render_us + wire_us, frames_after};
+      }
+    }
+  }
+  animation_clock_.realTime();
+  out.print("# no reaction to impulse within us ");
+  out.println(BENCHMARK_IMPULSE_WAIT_US);
+  return ImpulseLatency{false, 0, 0, frames_after};
+}
+#endif
+
+#ifdef CROSSFADE_INCLUDE__H
+/// added cost per frame while crossfading between two animations,
+/// both framebuffers into leds_out_ like Crossfade::run()
+void benchmarkCrossfadeBlend(Print &out, uint16_t frames=1000)
+{
+  uint32_t start = micros();
+  for (uint16_t f=0; f<frames; f++)
+  {
+    uint8_t t = f & 0xFF;
+    crossfadeBlend(framebuffers_[0], 0, 255 - t, framebuffers_[1], f % NUM_LEDS, t, leds_out_, NUM_LEDS);
+  }
+  out.print("# crossfade blend us/frame ");
+  out.println((micros() - start) / frames);
+}
+#endif
+
+#if defined(TEENSYDUINO) && defined(__arm__)
+extern unsigned long _etext;
+extern unsigned long _sdata;
+extern unsigned long _edata;
+extern unsigned long _ebss;
+#endif
+
+/// static RAM and flash use, from the linker symbols
+template <class Registry>
+void benchmarkPrintMemory(Print &out, Registry &animations)
+{
+  out.print("# registry bytes ");
+  out.println(sizeof(animations));
+#if defined(TEENSYDUINO) && defined(__arm__)
+  uint32_t data = reinterpret_cast<uint32_t>(&_edata) - reinterpret_cast<uint32_t>(&_sdata);
+  out.print("# flash bytes ");
+  out.println(reinterpret_cast<uint32_t>(&_etext) + data);
+  out.print("# static ram bytes (.data+.bss) ");
+  out.println(reinterpret_cast<uint32_t>(&_ebss) - reinterpret_cast<uint32_t>(&_sdata));
+#endif
+  out.print("# heap bytes in use ");
+  out.println(benchmarkHeapInUse());
+}
+
+/// benchmarks every animation in the registry with is_dark_ forced on,
+/// so RunOnlyInDarknessT decorators benchmark the animation and not the sleep animation.
+template <class Registry>
+void benchmarkAnimations(Print &out, Registry &animations, uint16_t frames=BENCHMARK_DEFAULT_FRAMES)
+{
+  bool was_dark = is_dark_;
+  cycleCounterBegin();
+  is_dark_ = true;
+  uint32_t show_ns_led = benchmarkShow(out, 20);
+  benchmarkPrintHeader(out);
+  for (uint8_t a=0; a<animations.size(); a++)
+  {
+    benchmarkAnimation(out, animations, a, frames, show_ns_led);
+  }
+  benchmarkDispatch(out, animations);
+  benchmarkPixelKernels(out);
+  benchmarkRandom(out);
+  benchmarkSpectrumColors(out);
+#ifdef FIXED_FFT_INCLUDE__H
+  benchmarkSpectrumAnalysis(out);
+#endif
+#ifdef CROSSFADE_INCLUDE__H
+  benchmarkCrossfadeBlend(out);
+#endif
+  benchmarkPrintMemory(out, animations);
+  is_dark_ = was_dark;
+}
+
+#endif //BENCHMARK_INCLUDE__H
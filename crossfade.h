@@ -0,0 +1,183 @@
+#ifndef CROSSFADE_INCLUDE__H
+#define CROSSFADE_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Crossfade between two animations, instead of cutting to black on init().
+/// Include before animations.h, so the decorators there fade as well.
+///
+/// Needs two framebuffers plus an output buffer. leds_ has to be a pointer,
+/// which is pointed at the framebuffer of whichever animation currently renders.
+/// leds_origin_ is saved and restored per animation along with leds_.
+/// Each animation keeps its own brightness. While fading, the brightness of
+/// both sides is folded into the blend and FastLED brightness is set to 255.
+///
+/// // example use:
+/// CRGB framebuffers_[2][NUM_LEDS];
+/// CRGB leds_out_[NUM_LEDS];
+/// CRGB *leds_ = framebuffers_[0];
+/// Crossfade crossfade_(framebuffers_[0], framebuffers_[1], leds_out_);
+///
+/// if (crossfade_.begin(owner))
+/// {
+///   new_anim.init();
+///   crossfade_.incomingInitialized();
+/// }
+/// ...
+/// if (crossfade_.keepFading(owner, old_anim.current(), new_anim.current()))
+///   delay = crossfade_.run([]{return old_anim.run();}, []{return new_anim.run();});
+/// FastLED[0].setLeds(crossfade_.outputBuffer(), NUM_LEDS);
+///
+
+#include "animation_clock.h"
+
+#define CROSSFADE_DEFAULT_DURATION_MS 1500
+#define CROSSFADE_FRAME_MS (1000/60)
+
+/// out = a*wa/256 + b*wb/256 per channel, saturating.
+/// a and b are rotated by their origin (see RotatingStrip), out is in physical order.
+inline void crossfadeBlend(const CRGB *a, uint32_t a_origin, uint8_t wa, const CRGB *b, uint32_t b_origin, uint8_t wb, CRGB *out, uint32_t num_leds)
+{
+  uint32_t ia = (num_leds - a_origin) % num_leds;
+  uint32_t ib = (num_leds - b_origin) % num_leds;
+  for (uint32_t l=0; l<num_leds; l++)
+  {
+    out[l].r = qadd8(scale8(a[ia].r, wa), scale8(b[ib].r, wb));
+    out[l].g = qadd8(scale8(a[ia].g, wa), scale8(b[ib].g, wb));
+    out[l].b = qadd8(scale8(a[ia].b, wa), scale8(b[ib].b, wb));
+    if (++ia == num_leds)
+      ia = 0;
+    if (++ib == num_leds)
+      ib = 0;
+  }
+}
+
+class Crossfade {
+private:
+  CRGB *buffers_[2];
+  CRGB *output_;
+  uint8_t out_=0; //index of buffer of outgoing animation
+  const void *owner_=nullptr;
+  unsigned long duration_ms_=CROSSFADE_DEFAULT_DURATION_MS;
+  unsigned long start_=0;
+  unsigned long out_next_=0;
+  unsigned long in_next_=0;
+  uint8_t out_brightness_=0;
+  uint8_t in_brightness_=0;
+  uint32_t out_origin_=0;
+  uint32_t in_origin_=0;
+
+  CRGB *incoming() { return buffers_[out_ ^ 1]; }
+  CRGB *outgoing() { return buffers_[out_]; }
+
+public:
+  Crossfade(CRGB *buffer_a, CRGB *buffer_b, CRGB *output) : buffers_{buffer_a, buffer_b}, output_(output) {}
+
+  void setDuration(unsigned long duration_ms) { duration_ms_ = duration_ms; }
+
+  bool active() const { return nullptr != owner_; }
+  bool isOwner(const void *owner) const { return active() && owner_ == owner; }
+
+  /// start fading from the animation rendering into leds_ now.
+  /// Afterwards leds_ points to the second buffer, init() the new animation next.
+  /// Returns false if a different crossfade is still running.
+  bool begin(const void *owner)
+  {
+    if (active() || 0 == duration_ms_)
+      return false;
+    out_ = (leds_ == buffers_[0]) ? 0 : 1;
+    owner_ = owner;
+    out_brightness_ = FastLED.getBrightness();
+    out_origin_ = leds_origin_;
+    in_origin_ = 0;
+    leds_origin_ = 0;
+    start_ = animation_clock_.now();
+    out_next_ = start_;
+    in_next_ = start_;
+    leds_ = incoming();
+    return true;
+  }
+
+  /// call after init() of the new animation, to pick up its brightness
+  void incomingInitialized()
+  {
+    in_brightness_ = FastLED.getBrightness();
+    in_origin_ = leds_origin_;
+  }
+
+  /// finish immediately, leaving leds_ and brightness to the incoming animation
+  void cancel()
+  {
+    if (!active())
+      return;
+    owner_ = nullptr;
+    leds_ = incoming();
+    leds_origin_ = in_origin_;
+    FastLED.setBrightness(in_brightness_);
+  }
+
+  /// true while owner's fade goes on. Both sides drawn by the same animation object (one animation
+  /// with and without decorator, or the sleep animation behind two RunOnlyInDarknessT in daylight)
+  /// would run it twice per frame: double speed, and one side takes the audio updates of the other.
+  /// That is cut to the incoming side instead. Checked every frame, decorators can change sides mid-fade.
+  bool keepFading(const void *owner, const void *outgoing_anim, const void *incoming_anim)
+  {
+    if (!isOwner(owner))
+      return false;
+    if (outgoing_anim != incoming_anim)
+      return true;
+    cancel();
+    return false;
+  }
+
+  /// runs whichever of both animations is due, blends them into the output buffer.
+  /// Returns delay until the next frame.
+  template <class RunOut, class RunIn>
+  unsigned long run(RunOut run_outgoing, RunIn run_incoming)
+  {
+    unsigned long now = animation_clock_.now();
+    if (static_cast<int32_t>(now - out_next_) >= 0)
+    {
+      leds_ = outgoing();
+      leds_origin_ = out_origin_;
+      FastLED.setBrightness(out_brightness_);
+      out_next_ = now + run_outgoing();
+      out_brightness_ = FastLED.getBrightness();
+      out_origin_ = leds_origin_;
+    }
+    if (static_cast<int32_t>(now - in_next_) >= 0)
+    {
+      leds_ = incoming();
+      leds_origin_ = in_origin_;
+      FastLED.setBrightness(in_brightness_);
+      in_next_ = now + run_incoming();
+      in_brightness_ = FastLED.getBrightness();
+      in_origin_ = leds_origin_;
+    }
+    leds_ = incoming();
+    leds_origin_ = in_origin_;
+
+    unsigned long elapsed = now - start_;
+    if (elapsed >= duration_ms_)
+    {
+      cancel();
+      return 0;
+    }
+
+    uint8_t t = elapsed * 255 / duration_ms_;
+    crossfadeBlend(outgoing(), out_origin_, scale8(out_brightness_, 255-t), incoming(), in_origin_, scale8(in_brightness_, t), output_, NUM_LEDS);
+    FastLED.setBrightness(255);
+
+    unsigned long next = (out_next_ - now < in_next_ - now) ? out_next_ - now : in_next_ - now;
+    return (next < CROSSFADE_FRAME_MS) ? next : CROSSFADE_FRAME_MS;
+  }
+
+  /// buffer to hand to FastLED, leds_ is only in physical order if leds_origin_ is 0
+  CRGB *outputBuffer()
+  {
+    return (active()) ? output_ : leds_;
+  }
+};
+
+#endif //CROSSFADE_INCLUDE__H
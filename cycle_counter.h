@@ -0,0 +1,38 @@
+#ifndef CYCLE_COUNTER_INCLUDE__H
+#define CYCLE_COUNTER_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// CPU cycles, for timing things that take less than a microsecond or two.
+/// Uses the DWT cycle counter on Cortex-M3/M4 (Teensy 3.x), wraps every ~45s at 96MHz.
+/// Elsewhere derived from micros(), so only good to a microsecond.
+///
+/// // example use:
+/// cycleCounterBegin();
+/// uint32_t start = cycleCount();
+/// ...
+/// uint32_t took = cycleCount() - start;
+///
+
+#if defined(TEENSYDUINO) && defined(ARM_DWT_CYCCNT)
+inline void cycleCounterBegin()
+{
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+}
+
+inline uint32_t cycleCount()
+{
+  return ARM_DWT_CYCCNT;
+}
+#else
+inline void cycleCounterBegin() {}
+
+inline uint32_t cycleCount()
+{
+  return micros() * (F_CPU / 1000000);
+}
+#endif
+
+#endif //CYCLE_COUNTER_INCLUDE__H
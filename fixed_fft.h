@@ -0,0 +1,347 @@
+#ifndef FIXED_FFT_INCLUDE__H
+#define FIXED_FFT_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+#include "cycle_counter.h"
+
+/// Our own 16bit fixed-point FFT front end, for builds without PJRC Audio.
+///
+/// FixedFFT<N> turns N real samples into N/2 magnitudes |X|/N, the same scale
+/// AudioAnalyzeFFT256::output uses, so octave and full spectrum animations
+/// work unchanged. N is 128, 256 or 512.
+///  * Hann (default), Hamming, Blackman or no window
+///  * real FFT as a N/2 point complex radix-2 FFT of even/odd samples,
+///    followed by the split into the real spectrum
+///  * input is halved and every butterfly stage halves, so nothing can overflow
+///
+/// FixedFFTAnalyzer<N,HOP,AVERAGE> is the analysis chain: blocks of any length come in,
+/// an FFT runs over the last N samples every HOP samples (N/2: 50% overlap, N/4: 75%)
+/// and magnitudes are averaged over AVERAGE FFTs into audio_features_.
+/// analyze() also computes rms and peak per block. Every spectrum gets the capture
+/// time of the block that completed it. Needs audio_features.h.
+///
+/// Latency vs. CPU: a sound shows up in the spectrum after roughly
+/// N/2 + HOP*(AVERAGE+1)/2 samples (see latencyUs()), and there is a new spectrum every
+/// HOP*AVERAGE samples. Every hop costs one FFT, so CPU grows with 1/HOP.
+/// PJRC's FFT256 equals N=256, HOP=128, AVERAGE=8: ~16ms latency, a spectrum every 23ms.
+/// N=256, HOP=64, AVERAGE=1 gives ~4.4ms and a spectrum every 1.5ms for 4x the FFTs.
+/// Spectra arriving faster than frames are rendered do not help, but a shorter
+/// hop still means the frame sees a fresher one. Send 'b' for the numbers on the device.
+///
+/// // example use:
+/// FixedFFTAnalyzer<FFT_SIZE, FIXED_FFT_HOP, FIXED_FFT_AVERAGE> fft_analyzer_(FIXED_FFT_WINDOW);
+/// if (const int16_t *block = audio_capture_.readyBlock()) {
+///   fft_analyzer_.analyze(block, AUDIO_CAPTURE_BLOCK, audio_capture_.readyTimeUs());
+///   audio_capture_.release();
+/// }
+///
+
+#ifndef FIXED_FFT_HOP
+#define FIXED_FFT_HOP (FFT_SIZE/2)
+#endif
+#ifndef FIXED_FFT_AVERAGE
+#define FIXED_FFT_AVERAGE 8 //like AudioAnalyzeFFT256, a spectrum every 8 hops
+#endif
+#ifndef FIXED_FFT_WINDOW
+#define FIXED_FFT_WINDOW FFT_WINDOW_HANN
+#endif
+
+enum FFTWindow : uint8_t
+{
+  FFT_WINDOW_RECTANGULAR,
+  FFT_WINDOW_HANN,
+  FFT_WINDOW_HAMMING,
+  FFT_WINDOW_BLACKMAN,
+};
+
+/// window function at sample n of N
+inline double fftWindowValue(FFTWindow window, uint16_t n, uint16_t N)
+{
+  double phase = 2.0 * M_PI * n / N;
+  switch (window)
+  {
+    case FFT_WINDOW_HANN:
+      return 0.5 - 0.5 * cos(phase);
+    case FFT_WINDOW_HAMMING:
+      return 0.54 - 0.46 * cos(phase);
+    case FFT_WINDOW_BLACKMAN:
+      return 0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase);
+    default:
+      return 1.0;
+  }
+}
+
+template <uint16_t N>
+class FixedFFT
+{
+private:
+  static_assert(N == 128 || N == 256 || N == 512, "FixedFFT size has to be 128, 256 or 512");
+  static const uint16_t M = N/2; //complex points
+
+  int16_t window_[N];
+  int16_t cos_[M]; //cos(2 pi k/N), Q15
+  int16_t sin_[M];
+  int16_t z_[2*M]; //interleaved re, im
+
+  static int16_t q15(double v)
+  {
+    int32_t q = lround(v * 32768.0);
+    return (q > 32767) ? 32767 : ((q < -32768) ? -32768 : q);
+  }
+
+  static int32_t mulQ15(int32_t a, int32_t b)
+  {
+    return (a * b + 0x4000) >> 15;
+  }
+
+  static uint16_t bitReverse(uint16_t i, uint16_t bits)
+  {
+    uint16_t r = 0;
+    for (uint16_t b=0; b<bits; b++)
+    {
+      r = (r << 1) | (i & 1);
+      i >>= 1;
+    }
+    return r;
+  }
+
+  /// in-place M point complex FFT, every stage divides by 2
+  void complexFFT()
+  {
+    uint16_t bits = 0;
+    while ((1U << bits) < M)
+      bits++;
+    for (uint16_t i=0; i<M; i++)
+    {
+      uint16_t j = bitReverse(i, bits);
+      if (j > i)
+      {
+        std::swap(z_[2*i], z_[2*j]);
+        std::swap(z_[2*i+1], z_[2*j+1]);
+      }
+    }
+    for (uint16_t len=2; len<=M; len<<=1)
+    {
+      const uint16_t half = len/2;
+      const uint16_t step = N/len;
+      for (uint16_t i=0; i<M; i+=len)
+      {
+        for (uint16_t j=0; j<half; j++)
+        {
+          int32_t c = cos_[j*step];
+          int32_t s = sin_[j*step];
+          int16_t *u = &z_[2*(i+j)];
+          int16_t *v = &z_[2*(i+j+half)];
+          //t = v * e^(-j 2 pi j/len)
+          int32_t tr = mulQ15(v[0], c) + mulQ15(v[1], s);
+          int32_t ti = mulQ15(v[1], c) - mulQ15(v[0], s);
+          int32_t ur = u[0];
+          int32_t ui = u[1];
+          u[0] = (ur + tr) >> 1;
+          u[1] = (ui + ti) >> 1;
+          v[0] = (ur - tr) >> 1;
+          v[1] = (ui - ti) >> 1;
+        }
+      }
+    }
+  }
+
+public:
+  FixedFFT(FFTWindow window=FFT_WINDOW_HANN)
+  {
+    for (uint16_t n=0; n<N; n++)
+    {
+      window_[n] = q15(fftWindowValue(window, n, N));
+    }
+    for (uint16_t k=0; k<M; k++)
+    {
+      cos_[k] = q15(cos(2.0 * M_PI * k / N));
+      sin_[k] = q15(sin(2.0 * M_PI * k / N));
+    }
+  }
+
+  /// N samples in, N/2 magnitudes |X|/N out
+  void magnitudes(const int16_t *samples, uint16_t *out)
+  {
+    //even samples to re, odd to im, windowed and halved
+    for (uint16_t n=0; n<M; n++)
+    {
+      z_[2*n] = (static_cast<int32_t>(samples[2*n]) * window_[2*n]) >> 16;
+      z_[2*n+1] = (static_cast<int32_t>(samples[2*n+1]) * window_[2*n+1]) >> 16;
+    }
+    complexFFT();
+
+    //split: X[k] = (Z[k] + Z*[M-k])/2 - j W^k (Z[k] - Z*[M-k])/2
+    for (uint16_t k=0; k<M; k++)
+    {
+      uint16_t mk = (M - k) % M;
+      int32_t zr = z_[2*k];
+      int32_t zi = z_[2*k+1];
+      int32_t cr = z_[2*mk];
+      int32_t ci = -z_[2*mk+1];
+      int32_t er = (zr + cr) >> 1;
+      int32_t ei = (zi + ci) >> 1;
+      int32_t or_ = (zr - cr) >> 1;
+      int32_t oi = (zi - ci) >> 1;
+      int32_t c = cos_[k];
+      int32_t s = sin_[k];
+      int32_t xr = er + mulQ15(oi, c) - mulQ15(or_, s);
+      int32_t xi = ei - mulQ15(or_, c) - mulQ15(oi, s);
+      out[k] = audioSqrt32(static_cast<uint32_t>(xr*xr) + static_cast<uint32_t>(xi*xi));
+    }
+  }
+};
+
+/// time between spectra
+inline uint32_t fftIntervalUs(uint16_t hop, uint8_t average, uint32_t sample_rate)
+{
+  return static_cast<uint64_t>(hop) * average * 1000000 / sample_rate;
+}
+
+/// rough delay from sound to spectrum: half a window, plus on average half a hop
+/// of waiting and half the averaged hops
+inline uint32_t fftLatencyUs(uint16_t fft_size, uint16_t hop, uint8_t average, uint32_t sample_rate)
+{
+  return (static_cast<uint64_t>(fft_size) + static_cast<uint64_t>(hop) * (average+1)) * 500000 / sample_rate;
+}
+
+template <uint16_t N, uint16_t HOP=N/2, uint8_t AVERAGE=FIXED_FFT_AVERAGE>
+class FixedFFTAnalyzer
+{
+private:
+  static_assert(HOP > 0 && HOP <= N && 0 == N % HOP, "FixedFFTAnalyzer hop has to divide the FFT size");
+  static_assert(AVERAGE > 0, "FixedFFTAnalyzer needs to average at least one FFT");
+  FixedFFT<N> fft_;
+  int16_t samples_[N]; //oldest first
+  uint16_t fill_=0;
+  uint16_t mag_[N/2];
+  uint32_t sum_sq_[N/2];
+  uint8_t count_=0;
+  uint32_t last_cycles_=0;
+  uint32_t max_cycles_=0;
+
+  void spectrum(uint32_t capture_us)
+  {
+    fft_.magnitudes(samples_, mag_);
+    if (1 == AVERAGE)
+    {
+      audio_features_.setFFT(mag_, capture_us);
+      return;
+    }
+    for (uint16_t b=0; b<N/2; b++)
+    {
+      uint32_t magsq = static_cast<uint32_t>(mag_[b]) * mag_[b] / AVERAGE;
+      sum_sq_[b] = (0 == count_) ? magsq : sum_sq_[b] + magsq;
+    }
+    if (++count_ == AVERAGE)
+    {
+      count_ = 0;
+      for (uint16_t b=0; b<N/2; b++)
+      {
+        mag_[b] = audioSqrt32(sum_sq_[b]);
+      }
+      audio_features_.setFFT(mag_, capture_us);
+    }
+  }
+
+public:
+  FixedFFTAnalyzer(FFTWindow window=FFT_WINDOW_HANN) : fft_(window) {}
+
+  /// samples in, an FFT every HOP of them. capture_us: micros() of the last sample
+  void feed(const int16_t *block, uint16_t num_samples, uint32_t capture_us)
+  {
+    uint32_t start = cycleCount();
+    while (num_samples > 0)
+    {
+      uint16_t n = min(num_samples, static_cast<uint16_t>(N - fill_));
+      memcpy(samples_ + fill_, block, n*sizeof(int16_t));
+      fill_ += n;
+      block += n;
+      num_samples -= n;
+      if (fill_ == N)
+      {
+        spectrum(capture_us);
+        memmove(samples_, samples_ + HOP, (N-HOP)*sizeof(int16_t));
+        fill_ = N - HOP;
+      }
+    }
+    last_cycles_ = cycleCount() - start;
+    max_cycles_ = max(max_cycles_, last_cycles_);
+  }
+
+  /// rms and peak of the block, then feed()
+  void analyze(const int16_t *block, uint16_t num_samples, uint32_t capture_us)
+  {
+    audioAnalyzeLevels(block, num_samples, capture_us);
+    feed(block, num_samples, capture_us);
+  }
+
+  /// CPU cycles of the last feed() and the most since resetCycles()
+  uint32_t lastCycles() const { return last_cycles_; }
+  uint32_t maxCycles() const { return max_cycles_; }
+  void resetCycles() { max_cycles_ = 0; }
+
+  static uint32_t intervalUs(uint32_t sample_rate) { return fftIntervalUs(HOP, AVERAGE, sample_rate); }
+  static uint32_t latencyUs(uint32_t sample_rate) { return fftLatencyUs(N, HOP, AVERAGE, sample_rate); }
+};
+
+struct FixedFFTAccuracy
+{
+  uint32_t cycles;
+  double max_err_lsb;
+  double snr_db;
+};
+
+/// compares FixedFFT<N> with a double precision DFT of the same windowed signal
+/// (two sines plus noise), prints and returns the worst bin error and the error energy
+/// relative to the spectrum, plus cycles per FFT.
+template <uint16_t N>
+FixedFFTAccuracy fixedFFTSelfTest(Print &out)
+{
+  FixedFFT<N> fft;
+  int16_t samples[N];
+  uint16_t mag[N/2];
+  for (uint16_t n=0; n<N; n++)
+  {
+    double v = 12000.0 * sin(2.0 * M_PI * 5.3 * n / N) + 6000.0 * sin(2.0 * M_PI * 41.0 * n / N);
+    samples[n] = static_cast<int16_t>(v) + static_cast<int8_t>(random_stream_.next8()) * 8;
+  }
+  cycleCounterBegin();
+  uint32_t start = cycleCount();
+  fft.magnitudes(samples, mag);
+  uint32_t cycles = cycleCount() - start;
+
+  double max_err = 0.0;
+  double err_energy = 0.0;
+  double energy = 0.0;
+  for (uint16_t k=0; k<N/2; k++)
+  {
+    double re = 0.0;
+    double im = 0.0;
+    for (uint16_t n=0; n<N; n++)
+    {
+      double w = fftWindowValue(FFT_WINDOW_HANN, n, N);
+      re += samples[n] * w * cos(2.0 * M_PI * k * n / N);
+      im -= samples[n] * w * sin(2.0 * M_PI * k * n / N);
+    }
+    double ref = sqrt(re*re + im*im) / N;
+    double err = fabs(ref - mag[k]);
+    max_err = max(max_err, err);
+    err_energy += err*err;
+    energy += ref*ref;
+  }
+  double snr_db = (err_energy > 0.0) ? 10.0 * log10(energy / err_energy) : 999.0;
+  out.print("# fixed fft N ");
+  out.print(N);
+  out.print(" cycles ");
+  out.print(cycles);
+  out.print(" max_err_lsb ");
+  out.print(max_err, 2);
+  out.print(" snr_db ");
+  out.println(snr_db, 1);
+  return FixedFFTAccuracy{cycles, max_err, snr_db};
+}
+
+#endif //FIXED_FFT_INCLUDE__H
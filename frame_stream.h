@@ -0,0 +1,275 @@
+#ifndef FRAME_STREAM_INCLUDE__H
+#define FRAME_STREAM_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Streams every shown frame (and optionally the audio features) to a host for remote preview,
+/// see tools/frame_stream_decode.py.
+///
+/// Packets, little endian:
+///   0xA5 0x5A, type, seq (u16), payload length (u16), payload, Fletcher-16 of type..payload (u8 sum1, u8 sum2)
+/// Frame payload (FRAME_STREAM_KEYFRAME, FRAME_STREAM_DELTA):
+///   number of LEDs (u16), brightness (u8), then ops until all LEDs are covered.
+///   op byte: top 2 bits kind, low 6 bits count-1 (1..64 LEDs)
+///     FRAME_STREAM_OP_SKIP     LEDs unchanged since the previous frame (delta frames only)
+///     FRAME_STREAM_OP_LITERAL  followed by count RGB triplets
+///     FRAME_STREAM_OP_RUN      followed by one RGB triplet for all count LEDs
+/// Audio payload (FRAME_STREAM_AUDIO): rms (u16), peak (u16), number of bins (u8), bins (u16 each).
+/// seq counts frames, a gap tells the host how many were dropped.
+///
+/// Encodes straight from the frame that was shown, the packet is never staged in a buffer.
+/// A first pass only counts the bytes, so the header can carry the length. Once a frame is
+/// sent completely, it is copied into reference_ for the next delta (3*NUM_LEDS bytes per frame).
+/// Never blocks the render loop: bytes are only written as far as availableForWrite() allows.
+/// A frame is dropped if there is no room at all when it starts, if the USB buffers run full in
+/// the middle it is cut short (checksum fails on the host) and the next frame is a keyframe.
+///
+/// // example use:
+/// FrameStream frame_stream_;
+/// frame_stream_.begin(Serial, true); //with audio features
+/// ...
+/// frame_stream_.send(shown_frame, brightness); //after FastLED.show()
+///
+
+#define FRAME_STREAM_SYNC0 0xA5
+#define FRAME_STREAM_SYNC1 0x5A
+#define FRAME_STREAM_KEYFRAME 1
+#define FRAME_STREAM_DELTA 2
+#define FRAME_STREAM_AUDIO 3
+#define FRAME_STREAM_OP_SKIP 0x00
+#define FRAME_STREAM_OP_LITERAL 0x40
+#define FRAME_STREAM_OP_RUN 0x80
+#define FRAME_STREAM_OP_MAX 64
+#define FRAME_STREAM_KEYFRAME_INTERVAL 100 //frames, so a host can join at any time
+#define FRAME_STREAM_AUDIO_BINS 32 //lowest FFT bins sent along
+#define FRAME_STREAM_CHUNK 64 //one USB packet
+
+class FrameStream
+{
+private:
+  /// first pass sink
+  struct ByteCounter
+  {
+    uint16_t bytes=0;
+    void put(uint8_t) { bytes++; }
+  };
+
+  Stream *out_=nullptr;
+  bool with_audio_=false;
+  CRGB reference_[NUM_LEDS];
+  bool need_keyframe_=true;
+  uint16_t since_keyframe_=0;
+  uint16_t seq_=0;
+  uint32_t audio_seen_=0;
+  uint8_t chunk_[FRAME_STREAM_CHUNK];
+  uint8_t chunk_len_=0;
+  bool stalled_=false;
+  uint8_t sum1_=0;
+  uint8_t sum2_=0;
+
+  uint32_t frames_sent_=0;
+  uint32_t frames_dropped_=0;
+  uint32_t frames_cut_=0;
+  uint32_t bytes_sent_=0;
+  millis_t stats_start_ms_=0;
+
+  /// ops of frame, against reference_ unless keyframe
+  template <class Sink>
+  void encodeFrame(const CRGB *frame, bool keyframe, Sink &sink)
+  {
+    ledctr_t l=0;
+    while (l < NUM_LEDS)
+    {
+      ledctr_t end = min(static_cast<ledctr_t>(NUM_LEDS), l + FRAME_STREAM_OP_MAX);
+      ledctr_t n = 1;
+      if (!keyframe && frame[l] == reference_[l])
+      {
+        while (l+n < end && frame[l+n] == reference_[l+n])
+          n++;
+        sink.put(FRAME_STREAM_OP_SKIP | (n-1));
+      } else if (l+1 < end && frame[l+1] == frame[l]) {
+        while (l+n < end && frame[l+n] == frame[l])
+          n++;
+        sink.put(FRAME_STREAM_OP_RUN | (n-1));
+        putRGB(sink, frame[l]);
+      } else {
+        //literal until an unchanged LED or a run of at least two starts
+        while (l+n < end
+          && (keyframe || frame[l+n] != reference_[l+n])
+          && !(l+n+1 < end && frame[l+n+1] == frame[l+n]))
+          n++;
+        sink.put(FRAME_STREAM_OP_LITERAL | (n-1));
+        for (ledctr_t i=l; i<l+n; i++)
+          putRGB(sink, frame[i]);
+      }
+      l += n;
+    }
+  }
+
+  template <class Sink>
+  static void putRGB(Sink &sink, const CRGB &c)
+  {
+    sink.put(c.r);
+    sink.put(c.g);
+    sink.put(c.b);
+  }
+
+  /// writes what fits, false if the host does not keep up
+  bool flushChunk()
+  {
+    uint8_t pos = 0;
+    while (pos < chunk_len_)
+    {
+      int room = out_->availableForWrite();
+      if (room <= 0)
+      {
+        bytes_sent_ += pos;
+        return false;
+      }
+      uint8_t n = min(static_cast<int>(chunk_len_ - pos), room);
+      out_->write(chunk_ + pos, n);
+      pos += n;
+    }
+    bytes_sent_ += chunk_len_;
+    chunk_len_ = 0;
+    return true;
+  }
+
+  void putRaw(uint8_t b)
+  {
+    if (stalled_)
+      return;
+    chunk_[chunk_len_++] = b;
+    if (chunk_len_ == FRAME_STREAM_CHUNK && !flushChunk())
+      stalled_ = true;
+  }
+
+  void putU16(uint16_t v)
+  {
+    put(v & 0xFF);
+    put(v >> 8);
+  }
+
+  void beginPacket(uint8_t type, uint16_t length)
+  {
+    stalled_ = false;
+    chunk_len_ = 0;
+    putRaw(FRAME_STREAM_SYNC0);
+    putRaw(FRAME_STREAM_SYNC1);
+    sum1_ = 0;
+    sum2_ = 0;
+    put(type);
+    putU16(seq_);
+    putU16(length);
+  }
+
+  /// false if the packet was cut short
+  bool endPacket()
+  {
+    uint8_t s1 = sum1_, s2 = sum2_;
+    putRaw(s1);
+    putRaw(s2);
+    if (!stalled_ && chunk_len_ > 0 && !flushChunk())
+      stalled_ = true;
+    return !stalled_;
+  }
+
+public:
+  /// second pass sink, Fletcher-16 on the way
+  void put(uint8_t b)
+  {
+    sum1_ = (sum1_ + b) % 255;
+    sum2_ = (sum2_ + sum1_) % 255;
+    putRaw(b);
+  }
+
+  void begin(Stream &out, bool with_audio)
+  {
+    out_ = &out;
+    with_audio_ = with_audio;
+    need_keyframe_ = true;
+    audio_seen_ = audio_features_.fft_seq;
+    resetStats();
+  }
+
+  void end()
+  {
+    out_ = nullptr;
+  }
+
+  bool active() const { return out_ != nullptr; }
+
+  /// frame as shown (physical order), brightness as it was applied to the strip
+  void send(const CRGB *frame, uint8_t brightness)
+  {
+    if (!out_)
+      return;
+    seq_++;
+    if (out_->availableForWrite() <= 0)
+    {
+      frames_dropped_++;
+      return;
+    }
+    bool keyframe = need_keyframe_ || since_keyframe_ >= FRAME_STREAM_KEYFRAME_INTERVAL;
+    ByteCounter counter;
+    encodeFrame(frame, keyframe, counter);
+    beginPacket(keyframe ? FRAME_STREAM_KEYFRAME : FRAME_STREAM_DELTA, 3 + counter.bytes);
+    putU16(NUM_LEDS);
+    put(brightness);
+    encodeFrame(frame, keyframe, *this);
+    if (!endPacket())
+    {
+      frames_cut_++;
+      need_keyframe_ = true;
+      return;
+    }
+    //reference for the next delta
+    memcpy(reference_, frame, sizeof(reference_));
+    need_keyframe_ = false;
+    since_keyframe_ = keyframe ? 0 : since_keyframe_ + 1;
+    frames_sent_++;
+    if (with_audio_ && audio_features_.fft_seq != audio_seen_)
+    {
+      audio_seen_ = audio_features_.fft_seq;
+      uint8_t bins = min(FRAME_STREAM_AUDIO_BINS, FFT_BINS);
+      beginPacket(FRAME_STREAM_AUDIO, 5 + 2*bins);
+      putU16(audio_features_.rms);
+      putU16(audio_features_.peak);
+      put(bins);
+      for (uint8_t b=0; b<bins; b++)
+        putU16(audio_features_.fft[b]);
+      endPacket();
+    }
+  }
+
+  void resetStats()
+  {
+    frames_sent_ = 0;
+    frames_dropped_ = 0;
+    frames_cut_ = 0;
+    bytes_sent_ = 0;
+    stats_start_ms_ = millis();
+  }
+
+  void printStats(Print &out)
+  {
+    millis_t ms = max(millis() - stats_start_ms_, static_cast<millis_t>(1));
+    out.print("# stream frames ");
+    out.print(frames_sent_);
+    out.print(" dropped ");
+    out.print(frames_dropped_);
+    out.print(" cut ");
+    out.print(frames_cut_);
+    out.print(" bytes ");
+    out.print(bytes_sent_);
+    out.print(" bytes/frame ");
+    out.print(bytes_sent_ / max(frames_sent_, static_cast<uint32_t>(1)));
+    out.print(" kB/s ");
+    out.print(bytes_sent_ / ms);
+    out.print(" fps ");
+    out.println(frames_sent_ * 1000 / ms);
+  }
+};
+
+#endif //FRAME_STREAM_INCLUDE__H
@@ -0,0 +1,145 @@
+#ifndef GEOMETRY_INCLUDE__H
+#define GEOMETRY_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Compile-time descriptions of LED fixtures that are not a straight strip.
+/// All tables (ring start, ring and angle of every pixel, matrix index maps)
+/// are generated by the compiler into flash, so rendering in geometric space
+/// costs one table lookup per pixel and no layout work per frame.
+///
+/// // example use:
+/// typedef RingGeometry<1,8,12,16,24,32,27> Rings; //sizes from center outwards
+/// fill_solid(leds_ + Rings::first(r), Rings::size(r), color);
+/// uint8_t angle = Rings::angle(l); //0..255 around the ring of pixel l
+///
+/// typedef MatrixGeometry<16,8,true> Matrix; //width, height, serpentine wiring
+/// leds_[Matrix::index(x,y)] = color;
+///
+/// // show a linear effect radially, line[0] in the center:
+/// paintFromLine(line, line_len, Rings::ringTable(), Rings::num_rings, leds_, Rings::num_leds);
+///
+
+//// Rings
+
+template <ledctr_t... SIZES>
+constexpr ledctr_t geometryRingFirst(uint8_t ring)
+{
+  const ledctr_t sizes[] = {SIZES...};
+  ledctr_t first = 0;
+  for (uint8_t r=0; r<ring; r++)
+    first += sizes[r];
+  return first;
+}
+
+template <ledctr_t... SIZES>
+constexpr uint8_t geometryRingOf(ledctr_t l)
+{
+  const ledctr_t sizes[] = {SIZES...};
+  uint8_t ring = 0;
+  while (ring < sizeof...(SIZES)-1 && l >= sizes[ring])
+  {
+    l -= sizes[ring];
+    ring++;
+  }
+  return ring;
+}
+
+template <ledctr_t... SIZES>
+constexpr uint8_t geometryRingAngle(ledctr_t l)
+{
+  const ledctr_t sizes[] = {SIZES...};
+  uint8_t ring = geometryRingOf<SIZES...>(l);
+  return (l - geometryRingFirst<SIZES...>(ring)) * 256 / sizes[ring];
+}
+
+template <class RingSeq, class PixelSeq, ledctr_t... SIZES> struct RingGeometryTables;
+template <size_t... R, size_t... L, ledctr_t... SIZES>
+struct RingGeometryTables<std::index_sequence<R...>, std::index_sequence<L...>, SIZES...>
+{
+  static constexpr ledctr_t first[sizeof...(R)] = { geometryRingFirst<SIZES...>(R)... };
+  static constexpr uint8_t ring[sizeof...(L)] = { geometryRingOf<SIZES...>(L)... };
+  static constexpr uint8_t angle[sizeof...(L)] = { geometryRingAngle<SIZES...>(L)... };
+};
+template <size_t... R, size_t... L, ledctr_t... SIZES>
+constexpr ledctr_t RingGeometryTables<std::index_sequence<R...>, std::index_sequence<L...>, SIZES...>::first[sizeof...(R)];
+template <size_t... R, size_t... L, ledctr_t... SIZES>
+constexpr uint8_t RingGeometryTables<std::index_sequence<R...>, std::index_sequence<L...>, SIZES...>::ring[sizeof...(L)];
+template <size_t... R, size_t... L, ledctr_t... SIZES>
+constexpr uint8_t RingGeometryTables<std::index_sequence<R...>, std::index_sequence<L...>, SIZES...>::angle[sizeof...(L)];
+
+/// concentric rings wired one after the other, sizes given from the first ring on the strip
+template <ledctr_t... SIZES>
+struct RingGeometry
+{
+  static constexpr uint8_t num_rings = sizeof...(SIZES);
+  static constexpr ledctr_t num_leds = geometryRingFirst<SIZES...>(num_rings);
+  typedef RingGeometryTables<std::make_index_sequence<num_rings+1>, std::make_index_sequence<num_leds>, SIZES...> Tables;
+
+  /// first pixel of ring r, first(num_rings) is num_leds
+  static ledctr_t first(uint8_t r) { return Tables::first[r]; }
+  static ledctr_t size(uint8_t r) { return Tables::first[r+1] - Tables::first[r]; }
+  /// ring of pixel l
+  static uint8_t ring(ledctr_t l) { return Tables::ring[l]; }
+  /// position of pixel l around its ring, 0..255
+  static uint8_t angle(ledctr_t l) { return Tables::angle[l]; }
+  static const uint8_t *ringTable() { return Tables::ring; }
+  static const uint8_t *angleTable() { return Tables::angle; }
+};
+
+//// Matrix
+
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE>
+constexpr ledctr_t geometryMatrixIndex(uint8_t x, uint8_t y)
+{
+  return static_cast<ledctr_t>(y) * WIDTH + ((SERPENTINE && (y & 1)) ? WIDTH-1-x : x);
+}
+
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE, class PixelSeq> struct MatrixGeometryTables;
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE, size_t... L>
+struct MatrixGeometryTables<WIDTH, HEIGHT, SERPENTINE, std::index_sequence<L...> >
+{
+  //index by position y*WIDTH+x, since the mapping is its own inverse, also x/y by pixel
+  static constexpr ledctr_t index[sizeof...(L)] = { geometryMatrixIndex<WIDTH,HEIGHT,SERPENTINE>(L % WIDTH, L / WIDTH)... };
+  static constexpr uint8_t x[sizeof...(L)] = { static_cast<uint8_t>(geometryMatrixIndex<WIDTH,HEIGHT,SERPENTINE>(L % WIDTH, L / WIDTH) % WIDTH)... };
+  static constexpr uint8_t y[sizeof...(L)] = { static_cast<uint8_t>(L / WIDTH)... };
+};
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE, size_t... L>
+constexpr ledctr_t MatrixGeometryTables<WIDTH, HEIGHT, SERPENTINE, std::index_sequence<L...> >::index[sizeof...(L)];
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE, size_t... L>
+constexpr uint8_t MatrixGeometryTables<WIDTH, HEIGHT, SERPENTINE, std::index_sequence<L...> >::x[sizeof...(L)];
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE, size_t... L>
+constexpr uint8_t MatrixGeometryTables<WIDTH, HEIGHT, SERPENTINE, std::index_sequence<L...> >::y[sizeof...(L)];
+
+/// rows of WIDTH pixels, wired row after row, every second row backwards if SERPENTINE
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE>
+struct MatrixGeometry
+{
+  static constexpr uint8_t width = WIDTH;
+  static constexpr uint8_t height = HEIGHT;
+  static constexpr ledctr_t num_leds = static_cast<ledctr_t>(WIDTH) * HEIGHT;
+  typedef MatrixGeometryTables<WIDTH, HEIGHT, SERPENTINE, std::make_index_sequence<num_leds> > Tables;
+
+  /// pixel at column x, row y
+  static ledctr_t index(uint8_t x, uint8_t y) { return Tables::index[static_cast<ledctr_t>(y) * WIDTH + x]; }
+  /// column and row of pixel l
+  static uint8_t x(ledctr_t l) { return Tables::x[l]; }
+  static uint8_t y(ledctr_t l) { return Tables::y[l]; }
+  static const uint8_t *xTable() { return Tables::x; }
+  static const uint8_t *yTable() { return Tables::y; }
+};
+
+//// linear effects on a fixture
+
+/// pixel l of dst gets line[coord[l] * line_len / coord_range],
+/// e.g. coord = ring of each pixel to show a linear effect from the center outwards
+inline void paintFromLine(const CRGB *line, ledctr_t line_len, const uint8_t *coord, uint16_t coord_range, CRGB *dst, ledctr_t num_leds)
+{
+  for (ledctr_t l=0; l<num_leds; l++)
+  {
+    dst[l] = line[static_cast<uint32_t>(coord[l]) * line_len / coord_range];
+  }
+}
+
+#endif //GEOMETRY_INCLUDE__H
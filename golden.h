@@ -0,0 +1,342 @@
+#ifndef GOLDEN_INCLUDE__H
+#define GOLDEN_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Golden frame regression check, runs on the target like the benchmark.
+/// Animations run GOLDEN_FRAMES frames each under fixed conditions:
+///  * simulated animation_clock_, advanced by the delay each frame asks for
+///  * random_stream_ seeded with GOLDEN_SEED
+///  * synthetic audio features every frame (a kick every 32 frames, a slowly moving tone)
+///  * a fixed light sensor level and is_dark_ per pass
+/// Three passes, one row each in golden_frames.h:
+///  * dark: every animation of the registry in darkness, so RunOnlyInDarknessT runs the real animation
+///  * daylight: the registry again, starting in daylight (the decorators' daylight animation)
+///    with dusk falling halfway, so the crossfade back to the real animation is covered too
+///  * extra: a second registry with what the registry does not reach, animations that are in no
+///    list and collections that switch within the run, in darkness
+/// FNV-1a over every frame as show_leds() would hand it out (buffer, origin, brightness)
+/// gives one hash per row, compared with golden_frames.h. A table recorded for another
+/// NUM_LEDS or animation lists, or a row without a recorded hash, fails as well.
+///
+/// Timing: after every run() a fixed pixel workload (goldenYardstick()) is timed as well.
+/// The median run() over the median yardstick, in 1/GOLDEN_REL_SCALE, is the animation's cost.
+/// Medians ignore the odd interrupt or preemption, and the ratio stays put when the whole
+/// machine is faster or slower (clock scaling, another host). It still depends on the
+/// optimizer, so costs are only compared when platform, build type and compiler are the ones
+/// golden_frames.h was recorded with (GOLDEN_BUILD), otherwise they are only printed.
+/// Costlier than the baseline by more than GOLDEN_SLOWER_PERCENT (plus GOLDEN_SLACK_REL) fails.
+/// Afterwards the table for golden_frames.h is printed, to record or update the goldens.
+///
+/// An optimization that must not change the look: hashes have to stay the same.
+/// A change that is meant to alter an animation: check it on the strip, then record again.
+///
+/// // example use (needs animations.h, crossfade.h, light_sensor.h):
+/// bool pass = goldenFrames(Serial, animations_, golden_extras_);
+///
+
+#include "cycle_counter.h"
+
+#define GOLDEN_FRAMES 300
+#define GOLDEN_SEED 0x5EED
+#ifdef HOST_BUILD
+#define GOLDEN_SLOWER_PERCENT 50 //shared machines and CI runners are noisy, only clear regressions count
+#else
+#define GOLDEN_SLOWER_PERCENT 10
+#endif
+#define GOLDEN_REL_SCALE 1000
+#define GOLDEN_SLACK_REL 50 //clock resolution on runs that take next to nothing
+#define GOLDEN_LIGHT_DARK_MV 450
+#define GOLDEN_LIGHT_BRIGHT_MV 550
+#define GOLDEN_LIGHT_MV 200 //dark
+#define GOLDEN_DAYLIGHT_MV 800
+#define GOLDEN_SWITCH_MS 2000 //for collections in the extra list, a few switches in GOLDEN_FRAMES
+#define GOLDEN_KICK_PERIOD 32 //frames
+#define GOLDEN_FNV_OFFSET 2166136261UL
+#define GOLDEN_FNV_PRIME 16777619UL
+
+//what the costs were measured with, GOLDEN_BUILD in golden_frames.h has to match to compare them
+#ifdef HOST_BUILD
+#ifndef HOST_BUILD_TYPE
+#define HOST_BUILD_TYPE "unknown" //set by CMakeLists.txt
+#endif
+#define GOLDEN_PLATFORM "host " HOST_BUILD_TYPE
+#else
+#define GOLDEN_PLATFORM "teensy"
+#endif
+#ifdef __clang__
+#define GOLDEN_COMPILER "clang " __clang_version__
+#else
+#define GOLDEN_COMPILER "gcc " __VERSION__
+#endif
+#define GOLDEN_THIS_BUILD GOLDEN_PLATFORM " " GOLDEN_COMPILER
+
+struct GoldenFrames
+{
+  uint32_t hash;
+  uint32_t cost_rel; //in 1/GOLDEN_REL_SCALE yardsticks, measured in GOLDEN_BUILD, 0: not recorded
+};
+
+#include "golden_frames.h"
+
+inline uint32_t goldenHash(uint32_t hash, const uint8_t *data, uint32_t len)
+{
+  for (uint32_t i=0; i<len; i++)
+    hash = (hash ^ data[i]) * GOLDEN_FNV_PRIME;
+  return hash;
+}
+
+/// inserts v into sorted[0..n), which stays sorted
+inline void goldenInsertSorted(uint32_t *sorted, uint16_t n, uint32_t v)
+{
+  for (; n > 0 && sorted[n-1] > v; n--)
+    sorted[n] = sorted[n-1];
+  sorted[n] = v;
+}
+
+inline uint32_t goldenCyclesToNs(uint32_t cycles)
+{
+  return static_cast<uint64_t>(cycles) * 1000 / (F_CPU / 1000000);
+}
+
+/// the fixed pixel workload the animations are timed against, cycles
+inline uint32_t goldenYardstick(CRGB *buffer, uint16_t frame)
+{
+  uint32_t start = cycleCount();
+  fill_rainbow(buffer, NUM_LEDS, frame, 7);
+  fadeToBlackBy(buffer, NUM_LEDS, 64);
+  return cycleCount() - start;
+}
+
+/// deterministic audio features for frame, published at capture_us
+inline void goldenAudio(uint32_t frame, micros_t capture_us)
+{
+  uint8_t phase = frame % GOLDEN_KICK_PERIOD;
+  uint16_t level = (phase < 4) ? 16000 >> phase : 400 + frame * 37 % 200;
+  uint16_t bins[FFT_BINS];
+  for (uint16_t b=0; b<FFT_BINS; b++)
+  {
+    bins[b] = level >> min(b/4, 15);
+    if (b == frame/8 % FFT_BINS)
+      bins[b] += 300;
+  }
+  audio_features_.setLevels(level, min(level*3/2, AUDIO_FULL_SCALE), capture_us);
+  audio_features_.setFFT(bins, capture_us);
+}
+
+enum GoldenPass : uint8_t { GOLDEN_DARK, GOLDEN_DAYLIGHT, GOLDEN_EXTRA };
+
+struct GoldenRun
+{
+  uint32_t hash;
+  uint32_t cost;
+  uint32_t median_cycles;
+  uint32_t max_cycles;
+};
+
+/// what goldenFrames() counts over all rows
+struct GoldenTally
+{
+  uint8_t changed;
+  uint8_t slower;
+  uint8_t missing;
+};
+
+/// runs animation idx under fixed conditions, daylight until dusk_frame
+template <class Registry>
+GoldenRun goldenRun(Registry &animations, uint8_t idx, uint16_t frames, uint16_t dusk_frame)
+{
+  uint32_t run_cycles[GOLDEN_FRAMES]; //sorted
+  uint32_t yardstick_cycles[GOLDEN_FRAMES]; //sorted
+  CRGB yardstick[NUM_LEDS];
+  static const uint16_t silence[FFT_BINS] = {0};
+
+  crossfade_.cancel();
+  is_dark_ = (0 == dusk_frame);
+  light_sensor_ = LightSensor(GOLDEN_LIGHT_DARK_MV, GOLDEN_LIGHT_BRIGHT_MV, 0, 1);
+  light_sensor_.update(is_dark_ ? GOLDEN_LIGHT_MV : GOLDEN_DAYLIGHT_MV);
+  animation_clock_.simulate(0);
+  random_stream_.seed(GOLDEN_SEED);
+  //silence first, so whatever the audio readers saw before does not matter
+  for (uint8_t s=0; s<AUDIO_PEAK_HISTORY; s++)
+  {
+    audio_features_.setLevels(0, 0, 0);
+    audio_features_.setFFT(silence, 0);
+  }
+  fill_solid(leds_, NUM_LEDS, CRGB::Black);
+  leds_origin_ = 0;
+  FastLED.setBrightness(255);
+  animations.init(idx);
+
+  uint32_t hash = GOLDEN_FNV_OFFSET;
+  uint32_t max_cycles = 0;
+  uint16_t timed = 0;
+  for (uint16_t f=0; f<frames; f++)
+  {
+    if (f == dusk_frame && !is_dark_)
+    {
+      is_dark_ = true;
+      light_sensor_.update(GOLDEN_LIGHT_MV);
+    }
+    goldenAudio(f, animation_clock_.now() * 1000);
+    uint32_t start = cycleCount();
+    millis_t delay_ms = animations.run(idx);
+    uint32_t cycles = cycleCount() - start;
+    max_cycles = max(max_cycles, cycles);
+    if (timed < GOLDEN_FRAMES)
+    {
+      goldenInsertSorted(run_cycles, timed, cycles);
+      goldenInsertSorted(yardstick_cycles, timed, goldenYardstick(yardstick, f));
+      timed++;
+    }
+
+    uint16_t origin = crossfade_.active() ? 0 : leds_origin_;
+    uint8_t brightness = FastLED.getBrightness();
+    hash = goldenHash(hash, reinterpret_cast<const uint8_t*>(crossfade_.outputBuffer()), 3*NUM_LEDS);
+    hash = goldenHash(hash, reinterpret_cast<const uint8_t*>(&origin), sizeof(origin));
+    hash = goldenHash(hash, &brightness, 1);
+    animation_clock_.advance(max(delay_ms, static_cast<millis_t>(1)));
+  }
+  uint32_t median = timed ? run_cycles[timed/2] : 0;
+  uint32_t cost = timed ? static_cast<uint64_t>(median) * GOLDEN_REL_SCALE / max(yardstick_cycles[timed/2], 1U) : 0;
+  return GoldenRun{hash, cost, median, max_cycles};
+}
+
+inline const char *goldenPassName(GoldenPass pass)
+{
+  switch (pass)
+  {
+    case GOLDEN_DARK: return "dark";
+    case GOLDEN_DAYLIGHT: return "daylight";
+    default: return "extra";
+  }
+}
+
+/// runs every animation of a pass, compares and prints one line each, from row on in the table
+template <class Registry>
+void goldenPass(Print &out, Registry &animations, GoldenPass pass, uint16_t frames, bool recorded, bool same_build,
+  uint8_t row, uint32_t *hashes, uint32_t *costs, GoldenTally &tally)
+{
+  uint16_t dusk_frame = (GOLDEN_DAYLIGHT == pass) ? frames/2 : 0;
+  for (uint8_t idx=0; idx<animations.size(); idx++, row++)
+  {
+    GoldenRun run = goldenRun(animations, idx, frames, dusk_frame);
+    hashes[row] = run.hash;
+    costs[row] = run.cost;
+
+    GoldenFrames golden = recorded ? golden_frames_[row] : GoldenFrames{0, 0};
+    uint32_t baseline = same_build ? golden.cost_rel : 0;
+    const char *result = "ok";
+    if (0 == golden.hash)
+    {
+      result = "MISSING";
+      tally.missing++;
+    } else if (golden.hash != run.hash) {
+      result = "CHANGED";
+      tally.changed++;
+    } else if (baseline > 0 && run.cost > baseline + baseline * GOLDEN_SLOWER_PERCENT / 100 + GOLDEN_SLACK_REL) {
+      result = "SLOWER";
+      tally.slower++;
+    }
+    out.print(goldenPassName(pass));
+    out.print('\t');
+    out.print(idx);
+    out.print("\t0x");
+    out.print(static_cast<unsigned long>(run.hash), HEX);
+    out.print("\t0x");
+    out.print(static_cast<unsigned long>(golden.hash), HEX);
+    out.print('\t');
+    out.print(goldenCyclesToNs(run.median_cycles));
+    out.print("\t\t");
+    out.print(goldenCyclesToNs(run.max_cycles));
+    out.print('\t');
+    out.print(run.cost);
+    out.print('\t');
+    out.print(golden.cost_rel);
+    out.print("\t\t");
+    out.println(result);
+  }
+}
+
+/// runs the registry in darkness and in daylight, and extras in darkness, prints hash and timing
+/// per row against golden_frames.h and the table to record. true if every hash is recorded and
+/// unchanged and, if golden_frames.h was timed in this build, nothing got slower.
+template <class Registry, class Extras>
+bool goldenFrames(Print &out, Registry &animations, Extras &extras, uint16_t frames=GOLDEN_FRAMES)
+{
+  const uint8_t num_rows = 2*Registry::size() + Extras::size();
+  const bool saved_dark = is_dark_;
+  const LightSensor saved_light = light_sensor_;
+  const RandomStream saved_random = random_stream_;
+  const bool recorded = GOLDEN_NUM_LEDS == NUM_LEDS && GOLDEN_NUM_ANIM == Registry::size()
+    && GOLDEN_NUM_EXTRA == Extras::size() && sizeof(golden_frames_)/sizeof(GoldenFrames) == num_rows;
+  const bool same_build = 0 == strcmp(GOLDEN_BUILD, GOLDEN_THIS_BUILD);
+  uint32_t hashes[num_rows];
+  uint32_t costs[num_rows];
+  GoldenTally tally = {0, 0, 0};
+
+  cycleCounterBegin();
+  out.println("# pass\tanim\thash\t\tgolden\t\tns_median\tns_max\tcost\tcost_golden\tresult");
+  goldenPass(out, animations, GOLDEN_DARK, frames, recorded, same_build, 0, hashes, costs, tally);
+  goldenPass(out, animations, GOLDEN_DAYLIGHT, frames, recorded, same_build, Registry::size(), hashes, costs, tally);
+  goldenPass(out, extras, GOLDEN_EXTRA, frames, recorded, same_build, 2*Registry::size(), hashes, costs, tally);
+  crossfade_.cancel();
+  animation_clock_.realTime();
+  is_dark_ = saved_dark;
+  light_sensor_ = saved_light;
+  random_stream_ = saved_random;
+
+  bool pass = recorded && 0 == tally.changed && 0 == tally.slower && 0 == tally.missing;
+  if (!recorded)
+  {
+    out.print("# golden_frames.h is recorded for ");
+    out.print(GOLDEN_NUM_LEDS);
+    out.print(" LEDs, ");
+    out.print(GOLDEN_NUM_ANIM);
+    out.print(" animations and ");
+    out.print(GOLDEN_NUM_EXTRA);
+    out.println(" extras, not for this build");
+  }
+  if (!same_build)
+  {
+    out.print("# costs not compared, golden_frames.h was timed in ");
+    out.print(GOLDEN_BUILD);
+    out.print(", this is ");
+    out.println(GOLDEN_THIS_BUILD);
+  }
+  out.print("# golden ");
+  out.print(pass ? "PASS" : "FAIL");
+  out.print(" changed ");
+  out.print(tally.changed);
+  out.print(" slower ");
+  out.print(tally.slower);
+  out.print(" missing ");
+  out.println(tally.missing);
+
+  out.println("# golden_frames.h for this build:");
+  out.print("#define GOLDEN_NUM_LEDS ");
+  out.println(NUM_LEDS);
+  out.print("#define GOLDEN_NUM_ANIM ");
+  out.println(Registry::size());
+  out.print("#define GOLDEN_NUM_EXTRA ");
+  out.println(Extras::size());
+  out.print("#define GOLDEN_BUILD \"");
+  out.print(GOLDEN_THIS_BUILD);
+  out.println('"');
+  for (uint8_t row=0; row<num_rows; row++)
+  {
+    GoldenPass row_pass = (row < Registry::size()) ? GOLDEN_DARK : (row < 2*Registry::size()) ? GOLDEN_DAYLIGHT : GOLDEN_EXTRA;
+    out.print("  {0x");
+    out.print(static_cast<unsigned long>(hashes[row]), HEX);
+    out.print(", ");
+    out.print(costs[row]);
+    out.print("}, //");
+    out.print(goldenPassName(row_pass));
+    out.print(' ');
+    out.println((GOLDEN_EXTRA == row_pass) ? row - 2*Registry::size() : row % Registry::size());
+  }
+  return pass;
+}
+
+#endif //GOLDEN_INCLUDE__H
@@ -0,0 +1,86 @@
+#ifndef GOLDEN_FRAMES_INCLUDE__H
+#define GOLDEN_FRAMES_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Expected output of Serial command g, see golden.h, and of the host test test_golden.
+/// Record: run either, replace the lines below with the table it prints, commit.
+/// The costs here are the median of 12 runs of test_golden, one run is noisier.
+/// Only valid for the NUM_LEDS and the animation lists (registry, golden_extras_) it was recorded
+/// with, otherwise g fails for every animation. Costs are only compared in GOLDEN_BUILD,
+/// there is no baseline recorded on the Teensy.
+
+#define GOLDEN_NUM_LEDS 150
+#define GOLDEN_NUM_ANIM 27
+#define GOLDEN_NUM_EXTRA 7
+#define GOLDEN_BUILD "host Release gcc 12.2.0"
+
+/// per row: {hash over all frames, cost in GOLDEN_BUILD}, 0: not recorded.
+/// Rows: the registry in darkness, the registry in daylight, golden_extras_, each by index.
+/// Cost: median run() in 1/GOLDEN_REL_SCALE of the yardstick workload, see golden.h
+const GoldenFrames golden_frames_[] = {
+  {0x431557F, 828}, //dark 0
+  {0x431557F, 828}, //dark 1
+  {0xF42CE1FD, 112}, //dark 2
+  {0xF42CE1FD, 117}, //dark 3
+  {0x8577F003, 827}, //dark 4
+  {0x8577F003, 826}, //dark 5
+  {0xB586D29A, 2018}, //dark 6
+  {0xB586D29A, 2073}, //dark 7
+  {0xFA208CF, 240}, //dark 8
+  {0xFA208CF, 247}, //dark 9
+  {0x15C82C1E, 676}, //dark 10
+  {0x15C82C1E, 676}, //dark 11
+  {0xD77FBC7, 924}, //dark 12
+  {0xD77FBC7, 935}, //dark 13
+  {0x239FB208, 741}, //dark 14
+  {0x239FB208, 756}, //dark 15
+  {0x3C3EE1CB, 776}, //dark 16
+  {0x3C3EE1CB, 817}, //dark 17
+  {0xC43976C1, 751}, //dark 18
+  {0xC43976C1, 695}, //dark 19
+  {0x2BC32B7E, 771}, //dark 20
+  {0xF3A552F5, 83}, //dark 21
+  {0xC538415, 65}, //dark 22
+  {0xB586D29A, 2137}, //dark 23
+  {0xEE47B86C, 84}, //dark 24
+  {0x8577F003, 872}, //dark 25
+  {0x117B6281, 59}, //dark 26
+  {0x431557F, 832}, //daylight 0
+  {0xAF81BA1C, 939}, //daylight 1
+  {0xF42CE1FD, 114}, //daylight 2
+  {0xC22238E9, 984}, //daylight 3
+  {0x8577F003, 830}, //daylight 4
+  {0xC094FC9D, 858}, //daylight 5
+  {0xB586D29A, 2106}, //daylight 6
+  {0xF38000DD, 1250}, //daylight 7
+  {0xFA208CF, 235}, //daylight 8
+  {0x463D0FFB, 832}, //daylight 9
+  {0x15C82C1E, 671}, //daylight 10
+  {0x2398E398, 823}, //daylight 11
+  {0xD77FBC7, 929}, //daylight 12
+  {0x86527742, 840}, //daylight 13
+  {0x239FB208, 741}, //daylight 14
+  {0xE82B55DE, 885}, //daylight 15
+  {0x3C3EE1CB, 823}, //daylight 16
+  {0x6B09D1C6, 838}, //daylight 17
+  {0xC43976C1, 740}, //daylight 18
+  {0x80945C07, 876}, //daylight 19
+  {0x2BC32B7E, 733}, //daylight 20
+  {0x2A0D2F55, 93}, //daylight 21
+  {0xC538415, 64}, //daylight 22
+  {0xF38000DD, 1273}, //daylight 23
+  {0xCAB43261, 832}, //daylight 24
+  {0xC094FC9D, 880}, //daylight 25
+  {0x39F4DEB, 811}, //daylight 26
+  {0x183B6DDF, 836}, //extra 0
+  {0x5046D281, 217}, //extra 1
+  {0x9BA3DFFE, 1188}, //extra 2
+  {0x173475D3, 55}, //extra 3
+  {0xD95E4F17, 112}, //extra 4
+  {0xBC3AF2E7, 2047}, //extra 5
+  {0x715F0A97, 1652}, //extra 6
+};
+
+#endif //GOLDEN_FRAMES_INCLUDE__H
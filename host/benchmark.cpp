@@ -0,0 +1,21 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Serial command b on the host: benchmarkAnimations() (benchmark.h) and the strip wire timing,
+/// built once per NUM_LEDS (host_benchmark_150, host_benchmark_300, ...), see CMakeLists.txt.
+///
+/// usage: host_benchmark_<NUM_LEDS> [frames]
+///
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+
+int main(int argc, char *argv[])
+{
+  uint16_t frames = (argc > 1) ? atoi(argv[1]) : BENCHMARK_DEFAULT_FRAMES;
+  setup();
+  crossfade_.cancel();
+  benchmarkAnimations(Serial, animations_, max(frames, static_cast<uint16_t>(1)));
+  strip_layout_.printTiming(Serial);
+  return 0;
+}
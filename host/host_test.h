@@ -0,0 +1,39 @@
+#ifndef HOST_TEST_INCLUDE__H
+#define HOST_TEST_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Checks for the host tests in host/, run by ctest (see CMakeLists.txt).
+///
+/// // example use:
+/// HOST_CHECK(!crossfade_.active());
+/// return hostTestResult("crossfade");
+///
+
+#include <Arduino.h>
+
+uint32_t host_checks_ = 0;
+uint32_t host_failures_ = 0;
+
+#define HOST_CHECK(cond) hostCheck((cond), #cond, __FILE__, __LINE__)
+
+inline bool hostCheck(bool ok, const char *cond, const char *file, int line)
+{
+  host_checks_++;
+  if (!ok)
+  {
+    host_failures_++;
+    printf("%s:%d: check failed: %s\n", file, line, cond);
+  }
+  return ok;
+}
+
+/// prints the summary, returns the exit code for main()
+inline int hostTestResult(const char *name)
+{
+  printf("# %s %s, %u checks, %u failed\n", name, host_failures_ ? "FAIL" : "PASS", host_checks_, host_failures_);
+  return host_failures_ ? 1 : 0;
+}
+
+#endif //HOST_TEST_INCLUDE__H
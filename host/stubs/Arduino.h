@@ -0,0 +1,198 @@
+#ifndef HOST_ARDUINO_INCLUDE__H
+#define HOST_ARDUINO_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for the Teensyduino core, so the sketch compiles and runs on a Linux host (see CMakeLists.txt).
+/// Only what the sketch uses:
+///  * Serial prints to stdout and never has input
+///  * micros()/millis() count from program start, delay() does not sleep but moves the clock forward
+///  * the DWT cycle counter runs at F_CPU off the same clock, so cycle_counter.h works unchanged
+///  * pins read HIGH (button released, daylight comparator dark), writes are ignored
+///  * every operator new is counted in host_allocations_
+///
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <new>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#define TEENSYDUINO 144
+#define F_CPU 96000000
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+#define A2 16
+#define A3 17
+#define DEC 10
+#define HEX 16
+#define digitalPinToInterrupt(p) (p)
+#ifndef constrain
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#endif
+
+typedef uint8_t byte;
+
+uint64_t host_delayed_ns_ = 0;
+uint32_t host_allocations_ = 0;
+
+void *operator new(size_t size)
+{
+  host_allocations_++;
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+/// ns since program start, plus everything delay() skipped
+inline uint64_t hostNanos()
+{
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() + host_delayed_ns_;
+}
+
+inline uint32_t micros() { return hostNanos() / 1000; }
+inline uint32_t millis() { return hostNanos() / 1000000; }
+inline void delay(uint32_t ms) { host_delayed_ns_ += static_cast<uint64_t>(ms) * 1000000; }
+inline void delayMicroseconds(uint32_t us) { host_delayed_ns_ += static_cast<uint64_t>(us) * 1000; }
+
+//DWT cycle counter, see cycle_counter.h
+uint32_t host_dwt_ctrl_ = 0;
+uint32_t host_demcr_ = 0;
+#define ARM_DEMCR host_demcr_
+#define ARM_DEMCR_TRCENA (1 << 24)
+#define ARM_DWT_CTRL host_dwt_ctrl_
+#define ARM_DWT_CTRL_CYCCNTENA (1 << 0)
+#define ARM_DWT_CYCCNT (static_cast<uint32_t>(hostNanos() * (F_CPU / 1000000) / 1000))
+
+inline int digitalRead(uint8_t) { return HIGH; }
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline void pinMode(uint8_t, uint8_t) {}
+inline int analogRead(uint8_t) { return 0; }
+inline void analogReadResolution(unsigned int) {}
+inline void analogReadAveraging(unsigned int) {}
+inline void attachInterrupt(uint8_t, void (*)(void), int) {}
+inline void detachInterrupt(uint8_t) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline void randomSeed(unsigned long seed) { srandom(seed); }
+inline long random(long howbig) { return (howbig <= 0) ? 0 : ::random() % howbig; }
+inline long random(long howsmall, long howbig) { return (howsmall >= howbig) ? howsmall : random(howbig - howsmall) + howsmall; }
+
+/// Arduino Print: everything ends up in write()
+class Print
+{
+private:
+  size_t printNumber(unsigned long n, uint8_t base)
+  {
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2)
+      base = 10;
+    do {
+      char c = n % base;
+      n /= base;
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return print(str);
+  }
+
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+      n += write(*buffer++);
+    return n;
+  }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const char *s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(unsigned char n, int base=DEC) { return printNumber(n, base); }
+  size_t print(int n, int base=DEC) { return print(static_cast<long>(n), base); }
+  size_t print(unsigned int n, int base=DEC) { return printNumber(n, base); }
+  size_t print(long n, int base=DEC)
+  {
+    if (base == DEC && n < 0)
+      return print('-') + printNumber(-static_cast<unsigned long>(n), DEC);
+    return printNumber(n, base);
+  }
+  size_t print(unsigned long n, int base=DEC) { return printNumber(n, base); }
+  size_t print(long long n, int base=DEC) { return print(static_cast<long>(n), base); }
+  size_t print(unsigned long long n, int base=DEC) { return printNumber(n, base); }
+  size_t print(double n, int digits=2)
+  {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return print(buf);
+  }
+
+  size_t println() { return print("\r\n"); }
+  template <class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <class T> size_t println(T v, int base) { size_t n = print(v, base); return n + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  size_t readBytes(uint8_t *buffer, size_t length)
+  {
+    size_t n = 0;
+    for (int c; n < length && (c = read()) >= 0; n++)
+      buffer[n] = c;
+    return n;
+  }
+};
+
+/// USB serial: stdout, no input
+class usb_serial_class : public Stream
+{
+public:
+  void begin(long) {}
+  operator bool() { return true; }
+  int dtr() { return 1; }
+  size_t write(uint8_t b) override { return fwrite(&b, 1, 1, stdout); }
+  size_t write(const uint8_t *buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+  int availableForWrite() override { return 4096; }
+  void flush() override { fflush(stdout); }
+};
+
+usb_serial_class Serial;
+
+class IntervalTimer
+{
+public:
+  bool begin(void (*)(), unsigned int) { return false; }
+  bool begin(void (*)(), float) { return false; }
+  void end() {}
+  void priority(uint8_t) {}
+};
+
+#endif //HOST_ARDUINO_INCLUDE__H
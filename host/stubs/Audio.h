@@ -0,0 +1,317 @@
+#ifndef HOST_AUDIO_INCLUDE__H
+#define HOST_AUDIO_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for PJRC Audio on the host (see host/stubs/Arduino.h).
+/// There is no audio interrupt: blocks go into the graph with AudioInputAnalog::hostFeed() and pass through
+/// the AudioConnections right away. The analyzers do what PJRC's do (RMS, peak, FFT256 over two blocks with
+/// Hann window and 8 averages), so the sketch's mic task sees the same numbers as on the Teensy.
+/// arm_cfft_radix4_q15() is a double precision FFT scaled by 1/N like CMSIS, close but not bit exact.
+///
+/// // example use:
+/// int16_t block[AUDIO_BLOCK_SAMPLES];
+/// ...
+/// adc_stereo.hostFeed(block);
+/// task_sample_mic();
+///
+
+#include <Arduino.h>
+#include <complex>
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+#define AudioMemory(num) (void)(num)
+
+typedef struct audio_block_struct {
+  uint8_t ref_count;
+  uint8_t reserved1;
+  uint16_t memory_pool_index;
+  int16_t data[AUDIO_BLOCK_SAMPLES];
+} audio_block_t;
+
+class AudioConnection;
+
+class AudioStream
+{
+private:
+  struct Destination
+  {
+    unsigned char source_output;
+    AudioStream *stream;
+    unsigned char input;
+  };
+  std::vector<Destination> destinations_;
+  friend class AudioConnection;
+
+protected:
+  /// sends block on to everything connected to output
+  void transmit(const int16_t *block, unsigned char output=0)
+  {
+    for (const Destination &d : destinations_)
+      if (d.source_output == output)
+        d.stream->receive(block, d.input);
+  }
+
+public:
+  AudioStream(unsigned char, audio_block_t **) {}
+  virtual ~AudioStream() {}
+  virtual void update() {}
+  virtual void receive(const int16_t *, unsigned char) {}
+};
+
+class AudioConnection
+{
+public:
+  AudioConnection(AudioStream &source, unsigned char sourceOutput, AudioStream &destination, unsigned char destinationInput)
+  {
+    source.destinations_.push_back({sourceOutput, &destination, destinationInput});
+  }
+};
+
+class AudioInputAnalog : public AudioStream
+{
+public:
+  AudioInputAnalog(uint8_t) : AudioStream(0, nullptr) {}
+  void hostFeed(const int16_t *block) { transmit(block); }
+};
+
+class AudioInputAnalogStereo : public AudioStream
+{
+public:
+  AudioInputAnalogStereo(uint8_t, uint8_t) : AudioStream(0, nullptr) {}
+  void hostFeed(const int16_t *left, const int16_t *right=nullptr)
+  {
+    transmit(left, 0);
+    if (right)
+      transmit(right, 1);
+  }
+};
+
+class AudioAnalyzeRMS : public AudioStream
+{
+private:
+  int64_t accum_=0;
+  uint32_t count_=0;
+
+public:
+  AudioAnalyzeRMS() : AudioStream(1, nullptr) {}
+  void receive(const int16_t *block, unsigned char) override
+  {
+    for (uint16_t s=0; s<AUDIO_BLOCK_SAMPLES; s++)
+      accum_ += static_cast<int32_t>(block[s]) * block[s];
+    count_ += AUDIO_BLOCK_SAMPLES;
+  }
+  bool available() { return count_ > 0; }
+  float read()
+  {
+    float meansq = static_cast<float>(accum_) / count_;
+    accum_ = 0;
+    count_ = 0;
+    return sqrtf(meansq) / 32767.0f;
+  }
+};
+
+class AudioAnalyzePeak : public AudioStream
+{
+private:
+  int16_t min_sample_=32767;
+  int16_t max_sample_=-32768;
+  bool new_output_=false;
+
+public:
+  AudioAnalyzePeak() : AudioStream(1, nullptr) {}
+  void receive(const int16_t *block, unsigned char) override
+  {
+    for (uint16_t s=0; s<AUDIO_BLOCK_SAMPLES; s++)
+    {
+      min_sample_ = std::min(min_sample_, block[s]);
+      max_sample_ = std::max(max_sample_, block[s]);
+    }
+    new_output_ = true;
+  }
+  bool available() { return new_output_; }
+  float read()
+  {
+    int32_t peak = std::max(-static_cast<int32_t>(min_sample_), static_cast<int32_t>(max_sample_));
+    min_sample_ = 32767;
+    max_sample_ = -32768;
+    new_output_ = false;
+    return peak / 32767.0f;
+  }
+};
+
+typedef int16_t q15_t;
+
+typedef struct {
+  uint16_t fftLen;
+  uint8_t ifftFlag;
+  uint8_t bitReverseFlag;
+} arm_cfft_radix4_instance_q15;
+
+typedef enum { ARM_MATH_SUCCESS = 0, ARM_MATH_ARGUMENT_ERROR = -1 } arm_status;
+
+inline arm_status arm_cfft_radix4_init_q15(arm_cfft_radix4_instance_q15 *S, uint16_t fftLen, uint8_t ifftFlag, uint8_t bitReverseFlag)
+{
+  S->fftLen = fftLen;
+  S->ifftFlag = ifftFlag;
+  S->bitReverseFlag = bitReverseFlag;
+  return (fftLen & (fftLen - 1)) ? ARM_MATH_ARGUMENT_ERROR : ARM_MATH_SUCCESS;
+}
+
+/// in place on fftLen interleaved re/im pairs, output scaled by 1/fftLen, natural order
+inline void arm_cfft_radix4_q15(const arm_cfft_radix4_instance_q15 *S, q15_t *pSrc)
+{
+  const uint16_t n = S->fftLen;
+  std::vector<std::complex<double> > x(n);
+  for (uint16_t i=0; i<n; i++)
+    x[i] = std::complex<double>(pSrc[2*i], pSrc[2*i+1]);
+  for (uint16_t i=1, j=0; i<n; i++)
+  {
+    uint16_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j)
+      std::swap(x[i], x[j]);
+  }
+  for (uint16_t len=2; len<=n; len<<=1)
+  {
+    double angle = 2 * M_PI / len * (S->ifftFlag ? 1 : -1);
+    std::complex<double> wlen(cos(angle), sin(angle));
+    for (uint16_t i=0; i<n; i+=len)
+    {
+      std::complex<double> w(1);
+      for (uint16_t k=0; k<len/2; k++, w*=wlen)
+      {
+        std::complex<double> u = x[i+k];
+        std::complex<double> v = x[i+k+len/2] * w;
+        x[i+k] = u + v;
+        x[i+k+len/2] = u - v;
+      }
+    }
+  }
+  for (uint16_t i=0; i<n; i++)
+  {
+    pSrc[2*i] = static_cast<q15_t>(constrain(floor(x[i].real() / n), -32768.0, 32767.0));
+    pSrc[2*i+1] = static_cast<q15_t>(constrain(floor(x[i].imag() / n), -32768.0, 32767.0));
+  }
+}
+
+/// PJRC's Hann window, 0..32767
+struct HostWindowHanning256
+{
+  int16_t w[256];
+  HostWindowHanning256()
+  {
+    for (uint16_t i=0; i<256; i++)
+      w[i] = std::min(32767L, lround(16384.0 * (1.0 - cos(2 * M_PI * i / 256))));
+  }
+  int16_t operator[](uint16_t i) const { return w[i]; }
+};
+
+const HostWindowHanning256 AudioWindowHanning256;
+
+class AudioAnalyzeFFT256 : public AudioStream
+{
+private:
+  int16_t prev_block_[AUDIO_BLOCK_SAMPLES];
+  bool have_prev_=false;
+  int16_t buffer_[512];
+  uint32_t sum_[128];
+  uint8_t count_=0;
+  uint8_t naverage_=8;
+  bool outputflag_=false;
+  arm_cfft_radix4_instance_q15 fft_inst_;
+
+public:
+  uint16_t output[128] = {0};
+
+  AudioAnalyzeFFT256() : AudioStream(1, nullptr) { arm_cfft_radix4_init_q15(&fft_inst_, 256, 0, 1); }
+
+  void averageTogether(uint8_t n) { naverage_ = (n == 0) ? 1 : n; }
+
+  void receive(const int16_t *block, unsigned char) override
+  {
+    if (!have_prev_)
+    {
+      memcpy(prev_block_, block, sizeof(prev_block_));
+      have_prev_ = true;
+      return;
+    }
+    for (uint16_t s=0; s<AUDIO_BLOCK_SAMPLES; s++)
+    {
+      buffer_[2*s] = (static_cast<int32_t>(prev_block_[s]) * AudioWindowHanning256[s]) >> 15;
+      buffer_[2*s+1] = 0;
+      buffer_[2*(s+AUDIO_BLOCK_SAMPLES)] = (static_cast<int32_t>(block[s]) * AudioWindowHanning256[s+AUDIO_BLOCK_SAMPLES]) >> 15;
+      buffer_[2*(s+AUDIO_BLOCK_SAMPLES)+1] = 0;
+    }
+    arm_cfft_radix4_q15(&fft_inst_, buffer_);
+    for (uint16_t i=0; i<128; i++)
+    {
+      uint32_t magsq = static_cast<int32_t>(buffer_[2*i]) * buffer_[2*i] + static_cast<int32_t>(buffer_[2*i+1]) * buffer_[2*i+1];
+      sum_[i] = ((0 == count_) ? 0 : sum_[i]) + magsq / naverage_;
+    }
+    if (++count_ == naverage_)
+    {
+      count_ = 0;
+      for (uint16_t i=0; i<128; i++)
+        output[i] = sqrt(sum_[i]);
+      outputflag_ = true;
+    }
+    memcpy(prev_block_, block, sizeof(prev_block_));
+  }
+
+  bool available()
+  {
+    if (!outputflag_)
+      return false;
+    outputflag_ = false;
+    return true;
+  }
+
+  float read(unsigned int binNumber) { return (binNumber > 127) ? 0.0f : output[binNumber] / 16384.0f; }
+
+  float read(unsigned int binFirst, unsigned int binLast)
+  {
+    if (binFirst > binLast)
+      std::swap(binFirst, binLast);
+    if (binFirst > 127)
+      return 0.0f;
+    if (binLast > 127)
+      binLast = 127;
+    uint32_t sum = 0;
+    for (unsigned int b=binFirst; b<=binLast; b++)
+      sum += output[b];
+    return sum / 16384.0f;
+  }
+};
+
+/// collects blocks until the sketch reads them, like PJRC's queue (which holds at most 53)
+class AudioRecordQueue : public AudioStream
+{
+private:
+  std::vector<std::vector<int16_t> > queue_;
+  bool enabled_=false;
+
+public:
+  AudioRecordQueue() : AudioStream(1, nullptr) {}
+  void receive(const int16_t *block, unsigned char) override
+  {
+    if (enabled_ && queue_.size() < 53)
+      queue_.emplace_back(block, block + AUDIO_BLOCK_SAMPLES);
+  }
+  void begin() { enabled_ = true; }
+  void end() { enabled_ = false; }
+  void clear() { queue_.clear(); }
+  int available() { return queue_.size(); }
+  int16_t *readBuffer() { return queue_.empty() ? nullptr : queue_.front().data(); }
+  void freeBuffer()
+  {
+    if (!queue_.empty())
+      queue_.erase(queue_.begin());
+  }
+};
+
+#endif //HOST_AUDIO_INCLUDE__H
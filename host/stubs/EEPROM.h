@@ -0,0 +1,41 @@
+#ifndef HOST_EEPROM_INCLUDE__H
+#define HOST_EEPROM_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for the Teensy 3.2 EEPROM on the host: 2048 bytes of RAM, erased (0xFF) at start,
+/// counting the writes that update() did not skip.
+
+#include <Arduino.h>
+
+#define EEPROM_h
+#define E2END 0x7FF
+
+class EEPROMClass
+{
+private:
+  uint8_t mem_[E2END + 1];
+  uint32_t writes_=0;
+
+public:
+  EEPROMClass() { memset(mem_, 0xFF, sizeof(mem_)); }
+
+  uint8_t read(int idx) { return mem_[idx]; }
+  void write(int idx, uint8_t val)
+  {
+    mem_[idx] = val;
+    writes_++;
+  }
+  void update(int idx, uint8_t val)
+  {
+    if (mem_[idx] != val)
+      write(idx, val);
+  }
+  uint16_t length() { return E2END + 1; }
+  uint32_t writes() const { return writes_; }
+};
+
+EEPROMClass EEPROM;
+
+#endif //HOST_EEPROM_INCLUDE__H
@@ -0,0 +1,507 @@
+#ifndef HOST_FASTLED_INCLUDE__H
+#define HOST_FASTLED_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for FastLED on the host (see host/stubs/Arduino.h).
+/// The math is FastLED 3.4's portable C code as built for the Teensy (FASTLED_SCALE8_FIXED, FASTLED_BLEND_FIXED,
+/// sin8_C, hsv2rgb_rainbow), so frames rendered on the host are the frames the strip shows
+/// and golden.h hashes recorded here hold on the target.
+///
+/// Instead of WS2812Serial, every controller is a mock output sink: it records the frame as it would go out
+/// on its data pin (color order and brightness applied) and when the DMA would send it.
+/// A frame starts once the previous one is out, then takes 30us per LED plus the 300us reset.
+/// Pins on different serial ports send at the same time, just like on the Teensy.
+///
+/// // example use, 150 LEDs split over two pins:
+/// strip_layout_.show(leds_, 0, leds_out_);
+/// CLEDController &pin = *strip_segments_[1].controller;
+/// pin.frames(); pin.lastStartUs(); pin.lastEndUs(); pin.wire()[0]; //first byte sent after the last show()
+///
+
+#include <Arduino.h>
+
+typedef uint8_t fract8;
+typedef int16_t saccum87;
+typedef uint16_t accum88;
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) { unsigned int t = i + j; return (t > 255) ? 255 : t; }
+inline uint8_t qsub8(uint8_t i, uint8_t j) { int t = i - j; return (t < 0) ? 0 : t; }
+inline uint8_t add8(uint8_t i, uint8_t j) { return i + j; }
+inline uint8_t mul8(uint8_t i, uint8_t j) { return i * j; }
+inline int8_t abs8(int8_t i) { return (i < 0) ? -i : i; }
+inline uint8_t addmod8(uint8_t a, uint8_t b, uint8_t m)
+{
+  a += b;
+  while (a >= m)
+    a -= m;
+  return a;
+}
+
+inline uint8_t scale8(uint8_t i, fract8 scale)
+{
+  return (static_cast<uint16_t>(i) * (1 + static_cast<uint16_t>(scale))) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale)
+{
+  return ((static_cast<int>(i) * static_cast<int>(scale)) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB)
+{
+  uint16_t partial = (a << 8) | b;
+  partial += b * amountOfB;
+  partial -= a * amountOfB;
+  return partial >> 8;
+}
+
+inline uint8_t sin8(uint8_t theta)
+{
+  static const uint8_t b_m16_interleave[] = {0, 49, 49, 41, 90, 27, 117, 10};
+  uint8_t offset = theta;
+  if (theta & 0x40)
+    offset = 255 - offset;
+  offset &= 0x3F;
+  uint8_t secoffset = offset & 0x0F;
+  if (theta & 0x40)
+    secoffset++;
+  uint8_t section = offset >> 4;
+  uint8_t b = b_m16_interleave[section * 2];
+  uint8_t m16 = b_m16_interleave[section * 2 + 1];
+  uint8_t mx = (m16 * secoffset) >> 4;
+  int8_t y = mx + b;
+  if (theta & 0x80)
+    y = -y;
+  y += 128;
+  return y;
+}
+
+inline uint8_t triwave8(uint8_t in)
+{
+  if (in & 0x80)
+    in = 255 - in;
+  return in << 1;
+}
+
+inline uint8_t ease8InOutQuad(uint8_t i)
+{
+  uint8_t j = (i & 0x80) ? 255 - i : i;
+  uint8_t jj2 = scale8(j, j) << 1;
+  return (i & 0x80) ? 255 - jj2 : jj2;
+}
+
+inline uint8_t ease8InOutCubic(uint8_t i)
+{
+  uint8_t ii = scale8(i, i);
+  uint8_t iii = scale8(ii, i);
+  uint16_t r1 = (3 * static_cast<uint16_t>(ii)) - (2 * static_cast<uint16_t>(iii));
+  return (r1 & 0x100) ? 255 : r1;
+}
+
+inline uint8_t quadwave8(uint8_t in) { return ease8InOutQuad(triwave8(in)); }
+inline uint8_t cubicwave8(uint8_t in) { return ease8InOutCubic(triwave8(in)); }
+
+uint16_t rand16seed = 1337;
+
+inline uint8_t random8()
+{
+  rand16seed = (rand16seed * static_cast<uint16_t>(2053)) + static_cast<uint16_t>(13849);
+  return static_cast<uint8_t>(rand16seed & 0xFF) + static_cast<uint8_t>(rand16seed >> 8);
+}
+inline uint8_t random8(uint8_t lim) { return (random8() * lim) >> 8; }
+inline uint8_t random8(uint8_t min, uint8_t lim) { return random8(lim - min) + min; }
+inline uint16_t random16()
+{
+  rand16seed = (rand16seed * static_cast<uint16_t>(2053)) + static_cast<uint16_t>(13849);
+  return rand16seed;
+}
+inline uint16_t random16(uint16_t lim) { return (static_cast<uint32_t>(lim) * random16()) >> 16; }
+inline uint16_t random16(uint16_t min, uint16_t lim) { return random16(lim - min) + min; }
+inline void random16_set_seed(uint16_t seed) { rand16seed = seed; }
+inline void random16_add_entropy(uint16_t entropy) { rand16seed += entropy; }
+
+struct CHSV
+{
+  union {
+    struct {
+      union { uint8_t hue; uint8_t h; };
+      union { uint8_t sat; uint8_t s; };
+      union { uint8_t val; uint8_t v; };
+    };
+    uint8_t raw[3];
+  };
+
+  CHSV() = default;
+  CHSV(uint8_t ih, uint8_t is, uint8_t iv) : hue(ih), sat(is), val(iv) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+
+struct CRGB
+{
+  union {
+    struct {
+      union { uint8_t r; uint8_t red; };
+      union { uint8_t g; uint8_t green; };
+      union { uint8_t b; uint8_t blue; };
+    };
+    uint8_t raw[3];
+  };
+
+  typedef enum {
+    Black=0x000000,
+    Blue=0x0000FF,
+    Gray=0x808080,
+    Green=0x008000,
+    Red=0xFF0000,
+    White=0xFFFFFF,
+  } HTMLColorCode;
+
+  CRGB() = default;
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+  CRGB(HTMLColorCode colorcode) : CRGB(static_cast<uint32_t>(colorcode)) {}
+  CRGB(const CHSV &rhs) { hsv2rgb_rainbow(rhs, *this); }
+
+  CRGB &operator=(uint32_t colorcode) { *this = CRGB(colorcode); return *this; }
+  uint8_t &operator[](uint8_t x) { return raw[x]; }
+  const uint8_t &operator[](uint8_t x) const { return raw[x]; }
+
+  CRGB &operator+=(const CRGB &rhs)
+  {
+    r = qadd8(r, rhs.r);
+    g = qadd8(g, rhs.g);
+    b = qadd8(b, rhs.b);
+    return *this;
+  }
+
+  CRGB &nscale8(uint8_t scale)
+  {
+    r = scale8(r, scale);
+    g = scale8(g, scale);
+    b = scale8(b, scale);
+    return *this;
+  }
+
+  CRGB &fadeToBlackBy(uint8_t fadefactor) { return nscale8(255 - fadefactor); }
+
+  bool operator==(const CRGB &rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+  bool operator!=(const CRGB &rhs) const { return !(*this == rhs); }
+};
+
+/// FastLED's "rainbow" hue mapping, Y1 yellow boost, no green scaling
+inline void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb)
+{
+  uint8_t hue = hsv.hue;
+  uint8_t sat = hsv.sat;
+  uint8_t val = hsv.val;
+  uint8_t offset8 = (hue & 0x1F) << 3;
+  uint8_t third = scale8(offset8, (256 / 3));
+  uint8_t r, g, b;
+
+  if (!(hue & 0x80))
+  {
+    if (!(hue & 0x40))
+    {
+      if (!(hue & 0x20)) {
+        r = 255 - third; g = third; b = 0;
+      } else {
+        r = 171; g = 85 + third; b = 0;
+      }
+    } else {
+      if (!(hue & 0x20)) {
+        uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+        r = 171 - twothirds; g = 170 + third; b = 0;
+      } else {
+        r = 0; g = 255 - third; b = third;
+      }
+    }
+  } else {
+    if (!(hue & 0x40))
+    {
+      if (!(hue & 0x20)) {
+        uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+        r = 0; g = 171 - twothirds; b = 85 + twothirds;
+      } else {
+        r = third; g = 0; b = 255 - third;
+      }
+    } else {
+      if (!(hue & 0x20)) {
+        r = 85 + third; g = 0; b = 171 - third;
+      } else {
+        r = 170 + third; g = 0; b = 85 - third;
+      }
+    }
+  }
+
+  if (sat != 255)
+  {
+    if (sat == 0) {
+      r = 255; b = 255; g = 255;
+    } else {
+      uint8_t desat = scale8_video(255 - sat, 255 - sat);
+      uint8_t satscale = 255 - desat;
+      r = scale8(r, satscale) + desat;
+      g = scale8(g, satscale) + desat;
+      b = scale8(b, satscale) + desat;
+    }
+  }
+
+  if (val != 255)
+  {
+    val = scale8_video(val, val);
+    if (val == 0) {
+      r = 0; g = 0; b = 0;
+    } else {
+      r = scale8(r, val);
+      g = scale8(g, val);
+      b = scale8(b, val);
+    }
+  }
+  rgb.r = r;
+  rgb.g = g;
+  rgb.b = b;
+}
+
+inline CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay)
+{
+  if (amountOfOverlay == 0)
+    return existing;
+  if (amountOfOverlay == 255)
+  {
+    existing = overlay;
+    return existing;
+  }
+  existing.r = blend8(existing.r, overlay.r, amountOfOverlay);
+  existing.g = blend8(existing.g, overlay.g, amountOfOverlay);
+  existing.b = blend8(existing.b, overlay.b, amountOfOverlay);
+  return existing;
+}
+
+inline CRGB blend(const CRGB &p1, const CRGB &p2, fract8 amountOfP2)
+{
+  CRGB nu(p1);
+  nblend(nu, p2, amountOfP2);
+  return nu;
+}
+
+inline CRGB HeatColor(uint8_t temperature)
+{
+  uint8_t t192 = scale8_video(temperature, 191);
+  uint8_t heatramp = (t192 & 0x3F) << 2;
+  if (t192 & 0x80)
+    return CRGB(255, 255, heatramp);
+  if (t192 & 0x40)
+    return CRGB(255, heatramp, 0);
+  return CRGB(heatramp, 0, 0);
+}
+
+inline void fill_solid(CRGB *leds, int numToFill, const CRGB &color)
+{
+  for (int i=0; i<numToFill; i++)
+    leds[i] = color;
+}
+
+inline void fill_rainbow(CRGB *pFirstLED, int numToFill, uint8_t initialhue, uint8_t deltahue=5)
+{
+  CHSV hsv(initialhue, 240, 255);
+  for (int i=0; i<numToFill; i++)
+  {
+    pFirstLED[i] = hsv;
+    hsv.hue += deltahue;
+  }
+}
+
+inline void fill_gradient_RGB(CRGB *leds, uint16_t startpos, CRGB startcolor, uint16_t endpos, CRGB endcolor)
+{
+  if (endpos < startpos)
+  {
+    std::swap(startpos, endpos);
+    std::swap(startcolor, endcolor);
+  }
+  saccum87 rdistance87 = (endcolor.r - startcolor.r) << 7;
+  saccum87 gdistance87 = (endcolor.g - startcolor.g) << 7;
+  saccum87 bdistance87 = (endcolor.b - startcolor.b) << 7;
+  uint16_t pixeldistance = endpos - startpos;
+  int16_t divisor = pixeldistance ? pixeldistance : 1;
+  saccum87 rdelta87 = (rdistance87 / divisor) * 2;
+  saccum87 gdelta87 = (gdistance87 / divisor) * 2;
+  saccum87 bdelta87 = (bdistance87 / divisor) * 2;
+  accum88 r88 = startcolor.r << 8;
+  accum88 g88 = startcolor.g << 8;
+  accum88 b88 = startcolor.b << 8;
+  for (uint16_t i=startpos; i<=endpos; i++)
+  {
+    leds[i] = CRGB(r88 >> 8, g88 >> 8, b88 >> 8);
+    r88 += rdelta87;
+    g88 += gdelta87;
+    b88 += bdelta87;
+  }
+}
+
+inline void fill_gradient_RGB(CRGB *leds, uint16_t numLeds, const CRGB &c1, const CRGB &c2)
+{
+  fill_gradient_RGB(leds, 0, c1, numLeds - 1, c2);
+}
+
+inline void nscale8(CRGB *leds, uint16_t num_leds, uint8_t scale)
+{
+  for (uint16_t i=0; i<num_leds; i++)
+    leds[i].nscale8(scale);
+}
+
+inline void fadeToBlackBy(CRGB *leds, uint16_t num_leds, uint8_t fadeBy)
+{
+  nscale8(leds, num_leds, 255 - fadeBy);
+}
+
+/// leds[start..end], end included, backwards if end < start
+template <class PIXEL_TYPE>
+class CPixelView
+{
+private:
+  int8_t dir_;
+  int len_;
+  PIXEL_TYPE *leds_;
+
+public:
+  CPixelView(PIXEL_TYPE *leds, int start, int end) : dir_((end - start < 0) ? -1 : 1), len_(end - start + dir_), leds_(leds + start) {}
+
+  CPixelView &fill_solid(const PIXEL_TYPE &color)
+  {
+    for (int i=0; i!=len_; i+=dir_)
+      leds_[i] = color;
+    return *this;
+  }
+
+  CPixelView &fadeToBlackBy(uint8_t fadeBy)
+  {
+    for (int i=0; i!=len_; i+=dir_)
+      leds_[i].nscale8(255 - fadeBy);
+    return *this;
+  }
+
+  CPixelView &fill_gradient_RGB(const PIXEL_TYPE &startcolor, const PIXEL_TYPE &endcolor)
+  {
+    if (dir_ >= 0)
+      ::fill_gradient_RGB(leds_, len_, startcolor, endcolor);
+    else
+      ::fill_gradient_RGB(leds_ + len_ + 1, -len_, endcolor, startcolor);
+    return *this;
+  }
+};
+
+enum EOrder { RGB=0012, RBG=0021, GRB=0102, GBR=0120, BRG=0201, BGR=0210 };
+
+/// mock output sink for one data pin, see top of file
+class CLEDController
+{
+private:
+  uint8_t pin_;
+  EOrder order_;
+  CRGB *leds_=nullptr;
+  int num_leds_=0;
+  std::vector<uint8_t> wire_;
+  uint32_t frames_=0;
+  uint64_t first_start_us_=0;
+  uint64_t last_start_us_=0;
+  uint64_t busy_until_us_=0;
+
+public:
+  CLEDController(uint8_t pin, EOrder order) : pin_(pin), order_(order) {}
+  virtual ~CLEDController() {}
+
+  CLEDController &setLeds(CRGB *data, int num_leds)
+  {
+    leds_ = data;
+    num_leds_ = num_leds;
+    return *this;
+  }
+
+  static uint64_t wireUs(int num_leds) { return static_cast<uint64_t>(num_leds) * 30 + 300; }
+
+  /// "DMA": waits for the previous frame, then sends this one
+  void showLeds(uint8_t brightness, uint64_t now_us)
+  {
+    uint64_t start = std::max(now_us, busy_until_us_);
+    wire_.resize(3 * num_leds_);
+    for (int l=0; l<num_leds_; l++)
+    {
+      wire_[3*l] = scale8(leds_[l].raw[(order_ >> 6) & 3], brightness);
+      wire_[3*l+1] = scale8(leds_[l].raw[(order_ >> 3) & 3], brightness);
+      wire_[3*l+2] = scale8(leds_[l].raw[order_ & 3], brightness);
+    }
+    if (0 == frames_)
+      first_start_us_ = start;
+    frames_++;
+    last_start_us_ = start;
+    busy_until_us_ = start + wireUs(num_leds_);
+  }
+
+  void clearLeds()
+  {
+    if (leds_)
+      fill_solid(leds_, num_leds_, CRGB::Black);
+  }
+
+  uint8_t pin() const { return pin_; }
+  int size() const { return num_leds_; }
+  const std::vector<uint8_t> &wire() const { return wire_; }
+  uint32_t frames() const { return frames_; }
+  uint64_t firstStartUs() const { return first_start_us_; }
+  uint64_t lastStartUs() const { return last_start_us_; }
+  uint64_t lastEndUs() const { return busy_until_us_; }
+};
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812SERIAL : public CLEDController
+{
+public:
+  WS2812SERIAL() : CLEDController(DATA_PIN, RGB_ORDER) {}
+};
+
+class CFastLED
+{
+private:
+  uint8_t brightness_=255;
+  std::vector<CLEDController*> controllers_;
+
+public:
+  template <template <uint8_t, EOrder> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+  CLEDController &addLeds(CRGB *data, int num_leds, int offset=0)
+  {
+    CLEDController *c = new CHIPSET<DATA_PIN, RGB_ORDER>();
+    c->setLeds(data + offset, num_leds);
+    controllers_.push_back(c);
+    return *c;
+  }
+
+  void setBrightness(uint8_t scale) { brightness_ = scale; }
+  uint8_t getBrightness() { return brightness_; }
+
+  void show() { show(brightness_); }
+  void show(uint8_t scale)
+  {
+    uint64_t now_us = micros();
+    for (CLEDController *c : controllers_)
+      c->showLeds(scale, now_us);
+  }
+
+  void clear(bool writeData=false)
+  {
+    for (CLEDController *c : controllers_)
+      c->clearLeds();
+    if (writeData)
+      show(0);
+  }
+
+  int count() { return controllers_.size(); }
+  CLEDController &operator[](int x) { return *controllers_[x]; }
+};
+
+CFastLED FastLED;
+
+#endif //HOST_FASTLED_INCLUDE__H
@@ -0,0 +1,106 @@
+#ifndef HOST_SD_INCLUDE__H
+#define HOST_SD_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for the SD library on the host (see host/stubs/Arduino.h):
+/// the card is the directory in environment variable HOST_SD_DIR, the current directory if unset.
+/// FILE_WRITE opens for reading and writing at the end of the file, like Teensyduino's SD.
+///
+/// // example use:
+/// setenv("HOST_SD_DIR", "/tmp/card", 1);
+/// File f = SD.open("REPLAY.WAV");
+///
+
+#include <Arduino.h>
+#include <memory>
+#include <sys/stat.h>
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+
+class File : public Stream
+{
+private:
+  std::shared_ptr<FILE> f_;
+
+public:
+  File() {}
+  explicit File(FILE *f) : f_(f, fclose) {}
+
+  operator bool() { return static_cast<bool>(f_); }
+  void close() { f_.reset(); }
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t *buf, size_t size) override { return f_ ? fwrite(buf, 1, size, f_.get()) : 0; }
+  void flush() override
+  {
+    if (f_)
+      fflush(f_.get());
+  }
+
+  int read(void *buf, uint16_t nbyte) { return f_ ? fread(buf, 1, nbyte, f_.get()) : -1; }
+  int read() override
+  {
+    uint8_t b;
+    return (1 == read(&b, 1)) ? b : -1;
+  }
+  int peek() override
+  {
+    int c = read();
+    if (c >= 0)
+      fseek(f_.get(), -1, SEEK_CUR);
+    return c;
+  }
+
+  bool seek(uint32_t pos) { return f_ && 0 == fseek(f_.get(), pos, SEEK_SET); }
+  uint32_t position() { return f_ ? ftell(f_.get()) : 0; }
+  uint32_t size()
+  {
+    if (!f_)
+      return 0;
+    struct stat st;
+    fflush(f_.get());
+    return (0 == fstat(fileno(f_.get()), &st)) ? st.st_size : 0;
+  }
+  int available() override { return size() - position(); }
+};
+
+class SDClass
+{
+private:
+  std::string path(const char *filename)
+  {
+    const char *dir = getenv("HOST_SD_DIR");
+    return std::string(dir ? dir : ".") + "/" + filename;
+  }
+
+public:
+  bool begin(uint8_t) { return true; }
+
+  File open(const char *filename, uint8_t mode=FILE_READ)
+  {
+    std::string p = path(filename);
+    if (FILE_READ == mode)
+      return File(fopen(p.c_str(), "rb"));
+    FILE *f = fopen(p.c_str(), "r+b");
+    if (!f)
+      f = fopen(p.c_str(), "w+b");
+    if (f)
+      fseek(f, 0, SEEK_END);
+    return File(f);
+  }
+
+  bool exists(const char *filename)
+  {
+    struct stat st;
+    return 0 == stat(path(filename).c_str(), &st);
+  }
+
+  bool remove(const char *filename) { return 0 == ::remove(path(filename).c_str()); }
+};
+
+SDClass SD;
+
+#endif //HOST_SD_INCLUDE__H
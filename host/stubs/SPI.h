@@ -0,0 +1,21 @@
+#ifndef HOST_SPI_INCLUDE__H
+#define HOST_SPI_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for SPI on the host, only pin assignment, see host/stubs/SD.h for the card.
+
+#include <Arduino.h>
+
+class SPIClass
+{
+public:
+  void setMOSI(uint8_t) {}
+  void setMISO(uint8_t) {}
+  void setSCK(uint8_t) {}
+};
+
+SPIClass SPI;
+
+#endif //HOST_SPI_INCLUDE__H
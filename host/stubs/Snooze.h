@@ -0,0 +1,41 @@
+#ifndef HOST_SNOOZE_INCLUDE__H
+#define HOST_SNOOZE_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for Snooze on the host: hibernate() returns at once, as if the wakeup timer fired.
+
+#include <Arduino.h>
+
+#define Snooze_h
+
+class SnoozeTimer
+{
+public:
+  void setTimer(uint32_t) {}
+};
+
+class SnoozeDigital
+{
+public:
+  void pinMode(int, int, int) {}
+};
+
+class SnoozeBlock
+{
+public:
+  SnoozeBlock(SnoozeTimer &, SnoozeDigital &) {}
+};
+
+class SnoozeClass
+{
+public:
+  int hibernate(SnoozeBlock &) { return 0; }
+  int sleep(SnoozeBlock &) { return 0; }
+  int deepSleep(SnoozeBlock &) { return 0; }
+};
+
+SnoozeClass Snooze;
+
+#endif //HOST_SNOOZE_INCLUDE__H
@@ -0,0 +1,11 @@
+#ifndef HOST_WS2812SERIAL_INCLUDE__H
+#define HOST_WS2812SERIAL_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for WS2812Serial on the host, the WS2812SERIAL controller is the mock output sink in host/stubs/FastLED.h.
+
+#include <Arduino.h>
+
+#endif //HOST_WS2812SERIAL_INCLUDE__H
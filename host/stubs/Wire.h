@@ -0,0 +1,11 @@
+#ifndef HOST_WIRE_INCLUDE__H
+#define HOST_WIRE_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Stand-in for Wire on the host, the sketch includes it but does not use I2C.
+
+#include <Arduino.h>
+
+#endif //HOST_WIRE_INCLUDE__H
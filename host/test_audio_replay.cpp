@@ -0,0 +1,114 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// AudioReplay and replayFast() on the host: a synthetic WAV with a kick every
+/// TEST_KICK_PERIOD_MS goes through the whole analysis chain into an audio animation.
+/// The onset detector has to find every kick, and rendering has to be faster than real time.
+/// With a file name as argument, that file (WAV or raw, see audio_replay.h) is replayed instead,
+/// e.g. to see how long an hour long DJ set takes:
+///
+///   test_audio_replay /path/to/set.wav
+///
+
+#include <Arduino.h>
+#include <unistd.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+#define TEST_FILENAME "HOSTTEST.WAV"
+#define TEST_SAMPLE_RATE 44100
+#define TEST_SECONDS 20
+#define TEST_KICK_PERIOD_MS 1000 //longer than ONSET_REFRACTORY_HOPS at the replay's FFT rate
+#define TEST_KICK_MS 150
+
+void writeLE(FILE *f, uint32_t v, uint8_t bytes)
+{
+  for (uint8_t b=0; b<bytes; b++)
+    fputc(v >> (8*b), f);
+}
+
+/// 16bit mono WAV: quiet noise, and a kick (falling sine plus a short click) every TEST_KICK_PERIOD_MS
+bool writeKickWav(const char *path)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  const uint32_t samples = TEST_SAMPLE_RATE * TEST_SECONDS;
+  fwrite("RIFF", 1, 4, f);
+  writeLE(f, 36 + 2*samples, 4);
+  fwrite("WAVEfmt ", 1, 8, f);
+  writeLE(f, 16, 4);
+  writeLE(f, 1, 2); //PCM
+  writeLE(f, 1, 2); //mono
+  writeLE(f, TEST_SAMPLE_RATE, 4);
+  writeLE(f, 2*TEST_SAMPLE_RATE, 4);
+  writeLE(f, 2, 2);
+  writeLE(f, 16, 2);
+  fwrite("data", 1, 4, f);
+  writeLE(f, 2*samples, 4);
+
+  const uint32_t period = TEST_SAMPLE_RATE * TEST_KICK_PERIOD_MS / 1000;
+  const uint32_t kick_len = TEST_SAMPLE_RATE * TEST_KICK_MS / 1000;
+  uint32_t noise = 1;
+  double phase = 0;
+  for (uint32_t s=0; s<samples; s++)
+  {
+    noise = noise * 1103515245 + 12345;
+    int32_t white = static_cast<int16_t>(noise >> 16);
+    double v = white / 64;
+    uint32_t in_kick = s % period;
+    if (in_kick < kick_len)
+    {
+      double t = static_cast<double>(in_kick) / kick_len;
+      phase += 2 * M_PI * (50 + 150 * (1 - t)) / TEST_SAMPLE_RATE;
+      v += 20000 * (1 - t) * sin(phase);
+      if (in_kick < TEST_SAMPLE_RATE / 500)
+        v += white / 3;
+    }
+    writeLE(f, static_cast<uint16_t>(static_cast<int16_t>(constrain(v, -32768.0, 32767.0))), 2);
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  setup();
+  crossfade_.cancel();
+  uint8_t idx = animation_current_;
+
+  if (argc > 1)
+  {
+    //replay a real file, the card is the directory it is in
+    std::string path(argv[1]);
+    size_t slash = path.rfind('/');
+    setenv("HOST_SD_DIR", (std::string::npos == slash) ? "." : path.substr(0, slash).c_str(), 1);
+    if (!audio_replay_.begin(path.substr(std::string::npos == slash ? 0 : slash + 1).c_str()))
+    {
+      printf("# can not open %s\n", argv[1]);
+      return 1;
+    }
+    ReplayResult result = replayFast(Serial, audio_replay_, animations_, idx);
+    return (result.frames > 0) ? 0 : 1;
+  }
+
+  char dir[] = "/tmp/test_audio_replay_XXXXXX";
+  HOST_CHECK(nullptr != mkdtemp(dir));
+  setenv("HOST_SD_DIR", dir, 1);
+  std::string path = std::string(dir) + "/" TEST_FILENAME;
+  HOST_CHECK(writeKickWav(path.c_str()));
+
+  HOST_CHECK(audio_replay_.begin(TEST_FILENAME));
+  HOST_CHECK(audio_replay_.sampleRate() == TEST_SAMPLE_RATE);
+  ReplayResult result = replayFast(Serial, audio_replay_, animations_, idx);
+  HOST_CHECK(!audio_replay_.active());
+  //the last partial block is not replayed
+  HOST_CHECK(result.audio_ms + 3 >= TEST_SECONDS * 1000 && result.audio_ms <= TEST_SECONDS * 1000);
+  HOST_CHECK(result.onsets == TEST_SECONDS * 1000 / TEST_KICK_PERIOD_MS);
+  HOST_CHECK(result.frames >= result.audio_ms / 1000 * 30);
+  HOST_CHECK(result.wall_ms < result.audio_ms);
+
+  unlink(path.c_str());
+  rmdir(dir);
+  return hostTestResult("audio replay");
+}
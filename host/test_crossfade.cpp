@@ -0,0 +1,118 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Crossfades never run one animation object on both sides (Crossfade::keepFading()):
+/// registry switch between an animation and its RunOnlyInDarknessT, a decorator whose
+/// sides are the same animation, a collection switching to the animation it already shows.
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+/// counts its frames, to see whether it runs once or twice per frame
+class AnimationCountFrames : public BaseAnimation
+{
+public:
+  uint32_t frames=0;
+  virtual millis_t run()
+  {
+    frames++;
+    return 10;
+  }
+};
+
+/// first idx whose animation draws with anim, in the current light
+uint8_t registryIndexOf(const BaseAnimation *anim)
+{
+  for (uint8_t idx=0; idx<animations_.size(); idx++)
+    if (animations_.current(idx) == anim)
+      return idx;
+  return animations_.size();
+}
+
+void testRegistrySwitch()
+{
+  is_dark_ = true;
+  animation_current_ = registryIndexOf(&anim_plasma);
+  animations_.init(animation_current_);
+  animation_switch_next();
+  HOST_CHECK(animations_.current(animation_current_) == &anim_plasma); //anim_plasma_when_dark
+  task_animate_leds();
+  HOST_CHECK(!crossfade_.active());
+
+  //different animations do fade
+  animation_switch_next();
+  task_animate_leds();
+  HOST_CHECK(crossfade_.isOwner(&animations_));
+  crossfade_.cancel();
+}
+
+void testDarknessSameSides()
+{
+  AnimationCountFrames counter;
+  auto both = runOnlyInDarkness(counter, counter);
+  is_dark_ = true;
+  both.init();
+  is_dark_ = false;
+  both.run();
+  HOST_CHECK(!crossfade_.active());
+  HOST_CHECK(1 == counter.frames);
+  both.run();
+  HOST_CHECK(2 == counter.frames);
+}
+
+void testSharedSleep()
+{
+  //daylight: both draw anim_fade_to_black
+  auto sleepers = autoSwitchAnimationCollection(100, anim_plasma_when_dark, anim_fire2012_when_dark);
+  is_dark_ = false;
+  animation_clock_.simulate(0);
+  sleepers.init();
+  sleepers.run();
+  animation_clock_.advance(200);
+  sleepers.run();
+  HOST_CHECK(sleepers.current() == &anim_fade_to_black);
+  HOST_CHECK(!crossfade_.active());
+  animation_clock_.realTime();
+}
+
+void testCollectionSame()
+{
+  AnimationCountFrames counter;
+  auto twice = autoSwitchAnimationCollection(100, counter, counter);
+  animation_clock_.simulate(0);
+  twice.init();
+  twice.run();
+  animation_clock_.advance(200);
+  twice.run();
+  HOST_CHECK(!crossfade_.active());
+  HOST_CHECK(2 == counter.frames);
+  animation_clock_.realTime();
+}
+
+void testCollectionDistinct()
+{
+  AnimationCountFrames a, b;
+  auto two = autoSwitchAnimationCollection(100, a, b);
+  animation_clock_.simulate(0);
+  two.init();
+  two.run();
+  animation_clock_.advance(200);
+  two.run();
+  HOST_CHECK(crossfade_.isOwner(&two));
+  HOST_CHECK(2 == a.frames && 1 == b.frames);
+  crossfade_.cancel();
+  animation_clock_.realTime();
+}
+
+int main()
+{
+  setup();
+  testRegistrySwitch();
+  for (void (*test)() : {testDarknessSameSides, testSharedSleep, testCollectionSame, testCollectionDistinct})
+  {
+    crossfade_.cancel();
+    test();
+  }
+  return hostTestResult("crossfade");
+}
@@ -0,0 +1,59 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// FixedFFT<N> against a double precision DFT (fixedFFTSelfTest(), Serial command f)
+/// for every supported size, with a few different noise seeds, and a pure sine has to
+/// land in its bin at the amplitude AudioAnalyzeFFT256 would report.
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+#define TEST_SEEDS 4
+#define TEST_MIN_SNR_DB 40.0
+#define TEST_MAX_ERR_LSB 8.0 //every stage halves, so the lowest bits are lost on the way
+#define TEST_AMPLITUDE 16000
+
+template <uint16_t N>
+void testAccuracy()
+{
+  for (uint16_t seed=1; seed<=TEST_SEEDS; seed++)
+  {
+    random_stream_.seed(seed);
+    FixedFFTAccuracy acc = fixedFFTSelfTest<N>(Serial);
+    HOST_CHECK(acc.snr_db >= TEST_MIN_SNR_DB);
+    HOST_CHECK(acc.max_err_lsb <= TEST_MAX_ERR_LSB);
+  }
+}
+
+/// sine exactly on bin, Hann window: |X|/N = amplitude/4 in that bin, amplitude/8 next to it
+template <uint16_t N>
+void testSineBin(uint16_t bin)
+{
+  FixedFFT<N> fft;
+  int16_t samples[N];
+  uint16_t mag[N/2];
+  for (uint16_t n=0; n<N; n++)
+    samples[n] = lround(TEST_AMPLITUDE * sin(2.0 * M_PI * bin * n / N));
+  fft.magnitudes(samples, mag);
+  uint16_t peak = 0;
+  for (uint16_t k=1; k<N/2; k++)
+    if (mag[k] > mag[peak])
+      peak = k;
+  HOST_CHECK(peak == bin);
+  HOST_CHECK(abs(mag[bin] - TEST_AMPLITUDE/4) <= 2);
+  HOST_CHECK(abs(mag[bin+1] - TEST_AMPLITUDE/8) <= 2);
+  HOST_CHECK(mag[bin+3] <= 2);
+}
+
+int main()
+{
+  setup();
+  testAccuracy<128>();
+  testAccuracy<256>();
+  testAccuracy<512>();
+  testSineBin<128>(9);
+  testSineBin<256>(30);
+  testSineBin<512>(100);
+  return hostTestResult("fixed fft");
+}
@@ -0,0 +1,280 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// frame_stream.h round trip: frames are encoded into a capture stream and decoded again the
+/// way tools/frame_stream_decode.py does. Every frame that went out completely has to come back
+/// bit for bit, with its brightness and the audio features sent along. Frames dropped for lack
+/// of room and frames cut short in the middle show up as seq gaps (cut ones also as bad checksums),
+/// and the frame after a cut is a keyframe, so decoding continues from there.
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+#define TEST_FRAMES 400
+#define TEST_ROOM_UNLIMITED 0x100000
+#define TEST_ROOM_CUT 40 //bytes, well below any frame the generator makes on a cut frame
+
+/// USB serial stand-in with as much room as the test allows
+class CaptureStream : public Stream
+{
+public:
+  std::vector<uint8_t> bytes;
+  int room = TEST_ROOM_UNLIMITED;
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    size_t n = min(size, static_cast<size_t>(max(room, 0)));
+    bytes.insert(bytes.end(), buffer, buffer + n);
+    room -= n;
+    return n;
+  }
+  int availableForWrite() override { return room; }
+};
+
+/// tools/frame_stream_decode.py in C++
+struct StreamDecoder
+{
+  /// a decoded packet, frame and audio as they were after it
+  struct Packet
+  {
+    uint8_t type;
+    uint16_t seq;
+    uint8_t brightness;
+    std::vector<CRGB> frame;
+    AudioFeatures audio;
+  };
+
+  std::vector<uint8_t> buf;
+  std::vector<CRGB> frame;
+  uint8_t brightness = 0;
+  bool have_keyframe = false;
+  bool have_seq = false;
+  uint16_t last_seq = 0;
+  uint32_t dropped = 0;
+  uint32_t bad = 0;
+  bool format_ok = true;
+  AudioFeatures audio;
+
+  static bool fletcherOk(const uint8_t *data, size_t len, const uint8_t *sum)
+  {
+    uint8_t s1 = 0, s2 = 0;
+    for (size_t i=0; i<len; i++)
+    {
+      s1 = (s1 + data[i]) % 255;
+      s2 = (s2 + s1) % 255;
+    }
+    return s1 == sum[0] && s2 == sum[1];
+  }
+
+  static uint16_t u16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+  /// decodes all complete packets, returns them in order
+  std::vector<Packet> feed(const std::vector<uint8_t> &data)
+  {
+    std::vector<Packet> packets;
+    buf.insert(buf.end(), data.begin(), data.end());
+    size_t pos = 0;
+    while (true)
+    {
+      while (pos+1 < buf.size() && !(buf[pos] == FRAME_STREAM_SYNC0 && buf[pos+1] == FRAME_STREAM_SYNC1))
+        pos++;
+      if (pos + 7 > buf.size())
+        break;
+      uint8_t type = buf[pos+2];
+      uint16_t seq = u16(&buf[pos+3]);
+      uint16_t length = u16(&buf[pos+5]);
+      if (type < FRAME_STREAM_KEYFRAME || type > FRAME_STREAM_AUDIO)
+      {
+        pos++;
+        continue;
+      }
+      if (pos + 7 + length + 2 > buf.size())
+        break;
+      if (!fletcherOk(&buf[pos+2], 5 + length, &buf[pos+7+length]))
+      {
+        bad++;
+        pos++;
+        continue;
+      }
+      const uint8_t *payload = &buf[pos+7];
+      if (type == FRAME_STREAM_AUDIO)
+        decodeAudio(payload);
+      else if (!decodeFrame(type, seq, payload, length))
+        type = 0;
+      if (type)
+        packets.push_back(Packet{type, seq, brightness, frame, audio});
+      pos += 7 + length + 2;
+    }
+    buf.erase(buf.begin(), buf.begin() + pos);
+    return packets;
+  }
+
+  void decodeAudio(const uint8_t *payload)
+  {
+    audio.rms = u16(payload);
+    audio.peak = u16(payload + 2);
+    for (uint8_t b=0; b<payload[4]; b++)
+      audio.fft[b] = u16(payload + 5 + 2*b);
+  }
+
+  bool decodeFrame(uint8_t type, uint16_t seq, const uint8_t *payload, uint16_t length)
+  {
+    if (have_seq)
+      dropped += static_cast<uint16_t>(seq - last_seq - 1);
+    have_seq = true;
+    last_seq = seq;
+    ledctr_t num_leds = u16(payload);
+    if (type == FRAME_STREAM_KEYFRAME)
+    {
+      have_keyframe = true;
+      frame.assign(num_leds, CRGB(CRGB::Black));
+    } else if (!have_keyframe || frame.size() != num_leds) {
+      return false;
+    }
+    uint16_t pos = 3;
+    ledctr_t led = 0;
+    while (led < num_leds && pos < length)
+    {
+      uint8_t op = payload[pos++];
+      ledctr_t count = (op & 0x3F) + 1;
+      format_ok &= led + count <= num_leds;
+      switch (op & 0xC0)
+      {
+      case FRAME_STREAM_OP_SKIP:
+        format_ok &= type == FRAME_STREAM_DELTA;
+        break;
+      case FRAME_STREAM_OP_LITERAL:
+        for (ledctr_t i=0; i<count && led+i < num_leds; i++, pos+=3)
+          frame[led+i] = CRGB(payload[pos], payload[pos+1], payload[pos+2]);
+        break;
+      case FRAME_STREAM_OP_RUN:
+        for (ledctr_t i=0; i<count && led+i < num_leds; i++)
+          frame[led+i] = CRGB(payload[pos], payload[pos+1], payload[pos+2]);
+        pos += 3;
+        break;
+      default:
+        format_ok = false;
+      }
+      led += count;
+    }
+    format_ok &= led == num_leds && pos == length;
+    brightness = payload[2];
+    return true;
+  }
+};
+
+/// what went into one send()
+struct Sent
+{
+  std::vector<CRGB> frame;
+  uint8_t brightness;
+  bool complete; //neither dropped nor cut
+  bool keyframe;
+  bool with_audio;
+  AudioFeatures audio;
+};
+
+CaptureStream capture_;
+FrameStream stream_;
+StreamDecoder decoder_;
+RandomStream rnd_(1);
+CRGB frame_[NUM_LEDS];
+
+/// next frame: mostly the previous one with a few spans changed to noise or a solid color,
+/// now and then all new
+void nextFrame(bool all_new)
+{
+  uint8_t spans = all_new ? 1 : rnd_.next8(4);
+  for (uint8_t s=0; s<spans; s++)
+  {
+    ledctr_t first = all_new ? 0 : rnd_.next32(NUM_LEDS);
+    ledctr_t count = all_new ? NUM_LEDS : rnd_.next32(1, NUM_LEDS - first + 1);
+    bool solid = !all_new && rnd_.next8(2);
+    CRGB color(rnd_.next8(), rnd_.next8(), rnd_.next8());
+    for (ledctr_t l=first; l<first+count; l++)
+      frame_[l] = solid ? color : CRGB(rnd_.next8(), rnd_.next8(), rnd_.next8());
+  }
+}
+
+int main()
+{
+  stream_.begin(capture_, true);
+  //by seq, send() counts from 1
+  std::vector<Sent> sent(1);
+  std::vector<StreamDecoder::Packet> packets;
+  uint32_t lost = 0, cuts = 0;
+  uint16_t since_keyframe = 0;
+  bool need_keyframe = true;
+  for (uint16_t f=0; f<TEST_FRAMES; f++)
+  {
+    bool drop = f % 37 == 20;
+    bool cut = f % 53 == 30 && !drop;
+    bool with_audio = f % 5 == 0 && !drop && !cut;
+    nextFrame(cut || f % 41 == 0);
+    Sent s;
+    s.brightness = rnd_.next8();
+    s.complete = !drop && !cut;
+    s.keyframe = need_keyframe || since_keyframe >= FRAME_STREAM_KEYFRAME_INTERVAL;
+    s.with_audio = with_audio;
+    if (with_audio)
+    {
+      audio_features_.rms = rnd_.next16();
+      audio_features_.peak = rnd_.next16();
+      for (uint8_t b=0; b<FFT_BINS; b++)
+        audio_features_.fft[b] = rnd_.next16();
+      audio_features_.fft_seq++;
+    }
+    s.frame.assign(frame_, frame_ + NUM_LEDS);
+    s.audio = audio_features_;
+    sent.push_back(s);
+    capture_.room = drop ? 0 : cut ? TEST_ROOM_CUT : TEST_ROOM_UNLIMITED;
+    stream_.send(frame_, s.brightness);
+    if (s.complete)
+    {
+      since_keyframe = s.keyframe ? 0 : since_keyframe + 1;
+      need_keyframe = false;
+    } else {
+      lost++;
+      cuts += cut;
+      need_keyframe |= cut;
+    }
+    //a cut packet holds the decoder until enough bytes for its length arrived, like in the python tool
+    std::vector<StreamDecoder::Packet> decoded = decoder_.feed(capture_.bytes);
+    capture_.bytes.clear();
+    packets.insert(packets.end(), decoded.begin(), decoded.end());
+  }
+
+  uint32_t frames = 0, audio = 0;
+  bool frames_ok = true, keyframes_ok = true, audio_ok = true;
+  for (const StreamDecoder::Packet &p : packets)
+  {
+    const Sent &s = sent[p.seq];
+    if (p.type == FRAME_STREAM_AUDIO)
+    {
+      audio++;
+      audio_ok &= s.with_audio && p.audio.rms == s.audio.rms && p.audio.peak == s.audio.peak;
+      for (uint8_t b=0; b<min(FRAME_STREAM_AUDIO_BINS, FFT_BINS); b++)
+        audio_ok &= p.audio.fft[b] == s.audio.fft[b];
+    } else {
+      frames++;
+      frames_ok &= s.complete && p.brightness == s.brightness && p.frame == s.frame;
+      keyframes_ok &= (p.type == FRAME_STREAM_KEYFRAME) == s.keyframe;
+    }
+  }
+  uint32_t with_audio = std::count_if(sent.begin(), sent.end(), [](const Sent &s) { return s.with_audio; });
+  printf("# frames %u decoded, %u dropped or cut (%u cut), decoder saw %u missing and %u bad\n",
+    frames, lost, cuts, decoder_.dropped, decoder_.bad);
+  HOST_CHECK(cuts > 0 && lost > cuts);
+  HOST_CHECK(frames_ok);
+  HOST_CHECK(frames + lost == TEST_FRAMES);
+  HOST_CHECK(decoder_.format_ok);
+  HOST_CHECK(keyframes_ok);
+  HOST_CHECK(audio_ok);
+  HOST_CHECK(audio == with_audio);
+  HOST_CHECK(decoder_.dropped == lost);
+  HOST_CHECK(decoder_.bad >= cuts);
+  HOST_CHECK(decoder_.buf.empty());
+  return hostTestResult("frame stream");
+}
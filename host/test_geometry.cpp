@@ -0,0 +1,107 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// geometry.h tables against a straightforward computation:
+///  * RingGeometry: ring starts are the prefix sums of the sizes, ring and angle of every pixel
+///  * MatrixGeometry: index() visits every pixel once, x()/y() invert it, the serpentine map is its own inverse
+///  * paintFromLine() by ring
+///  * AnimationTOCFairyDustLandingRing fills every ring evenly and nothing behind the last ring
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+template <ledctr_t... SIZES>
+void testRings()
+{
+  typedef RingGeometry<SIZES...> Rings;
+  const ledctr_t sizes[] = {SIZES...};
+  bool tables_ok = true;
+  ledctr_t l = 0;
+  for (uint8_t r=0; r<Rings::num_rings; r++)
+  {
+    tables_ok &= Rings::first(r) == l && Rings::size(r) == sizes[r];
+    for (ledctr_t i=0; i<sizes[r]; i++, l++)
+      tables_ok &= Rings::ring(l) == r && Rings::angle(l) == i * 256 / sizes[r];
+  }
+  HOST_CHECK(tables_ok);
+  HOST_CHECK(Rings::num_leds == l);
+  HOST_CHECK(Rings::first(Rings::num_rings) == l);
+}
+
+template <uint8_t WIDTH, uint8_t HEIGHT, bool SERPENTINE>
+void testMatrix()
+{
+  typedef MatrixGeometry<WIDTH, HEIGHT, SERPENTINE> Matrix;
+  std::vector<uint8_t> hits(Matrix::num_leds, 0);
+  bool tables_ok = true;
+  for (uint8_t y=0; y<HEIGHT; y++)
+  {
+    for (uint8_t x=0; x<WIDTH; x++)
+    {
+      ledctr_t l = Matrix::index(x, y);
+      bool reversed = SERPENTINE && (y & 1);
+      tables_ok &= l == ledctr_t(y * WIDTH + (reversed ? WIDTH-1-x : x));
+      tables_ok &= l < Matrix::num_leds && Matrix::x(l) == x && Matrix::y(l) == y;
+      if (l < Matrix::num_leds)
+        hits[l]++;
+      //position y*WIDTH+x read as a pixel index maps back to itself
+      tables_ok &= Matrix::index(l % WIDTH, l / WIDTH) == ledctr_t(y * WIDTH + x);
+    }
+  }
+  HOST_CHECK(tables_ok);
+  HOST_CHECK(std::count(hits.begin(), hits.end(), 1) == Matrix::num_leds);
+}
+
+void testPaintFromLine()
+{
+  typedef TOCRingGeometry Rings;
+  CRGB line[Rings::num_rings];
+  for (uint8_t r=0; r<Rings::num_rings; r++)
+    line[r] = CRGB(r, 255 - r, 7);
+  CRGB dst[Rings::num_leds];
+  paintFromLine(line, Rings::num_rings, Rings::ringTable(), Rings::num_rings, dst, Rings::num_leds);
+  bool painted_ok = true;
+  for (ledctr_t l=0; l<Rings::num_leds; l++)
+    painted_ok &= dst[l] == line[Rings::ring(l)];
+  HOST_CHECK(painted_ok);
+}
+
+void testLandingRingFill()
+{
+  typedef TOCRingGeometry Rings;
+  static_assert(Rings::num_leds < NUM_LEDS, "test needs LEDs behind the rings");
+  AnimationTOCFairyDustLandingRing anim;
+  anim.init();
+  const CRGB sentinel(1, 2, 3);
+  fill_solid(leds_ + Rings::num_leds, NUM_LEDS - Rings::num_leds, sentinel);
+  bool rings_even = true, behind_untouched = true, lit = false;
+  for (uint16_t f=0; f<400; f++)
+  {
+    anim.run();
+    for (uint8_t r=0; r<Rings::num_rings; r++)
+      for (ledctr_t l=Rings::first(r); l<Rings::first(r+1); l++)
+        rings_even &= leds_[l] == leds_[Rings::first(r)];
+    for (ledctr_t l=Rings::num_leds; l<NUM_LEDS; l++)
+      behind_untouched &= leds_[l] == sentinel;
+    lit |= leds_[Rings::first(Rings::num_rings-1)] != CRGB(CRGB::Black);
+  }
+  HOST_CHECK(rings_even);
+  HOST_CHECK(behind_untouched);
+  HOST_CHECK(lit);
+}
+
+int main()
+{
+  setup();
+  crossfade_.cancel();
+  testRings<1,8,12,16,24,32,27>();
+  testRings<NUM_LEDS/3, NUM_LEDS/3, NUM_LEDS-2*(NUM_LEDS/3)>();
+  testRings<7>();
+  testMatrix<16,8,true>();
+  testMatrix<16,8,false>();
+  testMatrix<5,3,true>();
+  testPaintFromLine();
+  testLandingRingFill();
+  return hostTestResult("geometry");
+}
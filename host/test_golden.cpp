@@ -0,0 +1,26 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// goldenFrames() (Serial command g) in the host build: every animation, in darkness, in daylight
+/// and from the extra list, has to produce the hashes in golden_frames.h and, in the build the
+/// table was timed in, must not get slower than its baseline.
+/// The table it prints at the end is what goes into golden_frames.h after an intended change.
+/// Afterwards random_stream_ continues where it was, the seeded runs leave no trace.
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+int main()
+{
+  setup();
+  crossfade_.cancel();
+  random_stream_.next32();
+  RandomStream expected = random_stream_;
+  HOST_CHECK(goldenFrames(Serial, animations_, golden_extras_));
+  bool same_stream = true;
+  for (uint16_t i=0; i<1000; i++)
+    same_stream &= expected.next32() == random_stream_.next32();
+  HOST_CHECK(same_stream);
+  return hostTestResult("golden");
+}
@@ -0,0 +1,113 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// A kick drum after a second of silence, into the octave animation, in simulated time:
+///  * through the fixed_fft.h analysis, benchmarkImpulseLatency() (Serial command L)
+///  * as a WAV through AudioReplay, the PJRC FFT256 equivalent
+/// The LEDs have to react, within the analysis latency plus a few frames.
+
+#include <Arduino.h>
+#include <unistd.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+#define TEST_FILENAME "IMPULSE.WAV"
+#define TEST_SAMPLE_RATE 44100
+#define TEST_FRAME_SLACK_US 20000 //polling and frame delays of the animation
+
+uint8_t octavesIndex()
+{
+  for (uint8_t idx=0; idx<animations_.size(); idx++)
+    if (animations_.current(idx) == &anim_fft_octaves)
+      return idx;
+  return 0;
+}
+
+/// silence until BENCHMARK_IMPULSE_AT_US, then benchmarkKick(), same length as benchmarkImpulseLatency() feeds
+bool writeImpulseWav(const char *path)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  const uint32_t samples = static_cast<uint64_t>(BENCHMARK_IMPULSE_AT_US + BENCHMARK_IMPULSE_WAIT_US) * TEST_SAMPLE_RATE / 1000000;
+  const uint32_t header[] = {0x46464952, 36 + 2*samples, 0x45564157, 0x20746d66, 16, 0x00010001, TEST_SAMPLE_RATE, 2*TEST_SAMPLE_RATE, 0x00100002, 0x61746164, 2*samples};
+  fwrite(header, sizeof(header), 1, f); //little endian host
+  for (uint32_t s=0; s<samples; s++)
+  {
+    uint32_t t_us = static_cast<uint64_t>(s) * 1000000 / TEST_SAMPLE_RATE;
+    int16_t v = (t_us >= BENCHMARK_IMPULSE_AT_US) ? benchmarkKick(t_us - BENCHMARK_IMPULSE_AT_US) : 0;
+    fwrite(&v, sizeof(v), 1, f);
+  }
+  fclose(f);
+  return true;
+}
+
+uint32_t ledsBrightness()
+{
+  uint32_t brightness = 0;
+  for (ledctr_t l=0; l<NUM_LEDS; l++)
+    brightness += leds_[l].r + leds_[l].g + leds_[l].b;
+  return brightness;
+}
+
+/// like benchmarkImpulseLatency(), but the audio comes from the replayed file
+ImpulseLatency replayImpulse(uint8_t idx)
+{
+  uint64_t next_frame_us = 0;
+  uint32_t baseline = 0;
+  uint32_t frames_after = 0;
+  animations_.init(idx);
+  while (audio_replay_.nextBlock())
+  {
+    uint64_t now_us = audio_replay_.audioTimeUs();
+    while (now_us >= next_frame_us)
+    {
+      uint64_t frame_us = next_frame_us;
+      next_frame_us += max(static_cast<uint64_t>(animations_.run(idx))*1000, static_cast<uint64_t>(BENCHMARK_MIN_FRAME_US));
+      uint32_t brightness = ledsBrightness();
+      if (frame_us < BENCHMARK_IMPULSE_AT_US)
+      {
+        if (frame_us + BENCHMARK_IMPULSE_WAIT_US >= BENCHMARK_IMPULSE_AT_US)
+          baseline = max(baseline, brightness);
+        continue;
+      }
+      frames_after++;
+      if (brightness > baseline + baseline/8 + NUM_LEDS)
+      {
+        audio_replay_.end();
+        uint32_t render_us = frame_us - BENCHMARK_IMPULSE_AT_US;
+        return ImpulseLatency{true, render_us, render_us, frames_after};
+      }
+    }
+  }
+  return ImpulseLatency{false, 0, 0, frames_after};
+}
+
+int main()
+{
+  setup();
+  crossfade_.cancel();
+  const uint8_t idx = octavesIndex();
+  HOST_CHECK(animations_.current(idx) == &anim_fft_octaves);
+
+  ImpulseLatency fixed = benchmarkImpulseLatency(Serial, animations_, idx);
+  HOST_CHECK(fixed.reacted);
+  HOST_CHECK(fixed.frames > 0);
+  HOST_CHECK(fixed.render_us <= fftLatencyUs(FFT_SIZE, FIXED_FFT_HOP, FIXED_FFT_AVERAGE, BENCHMARK_AUDIO_RATE) + TEST_FRAME_SLACK_US);
+  HOST_CHECK(fixed.wire_end_us > fixed.render_us);
+
+  char dir[] = "/tmp/test_impulse_latency_XXXXXX";
+  HOST_CHECK(nullptr != mkdtemp(dir));
+  setenv("HOST_SD_DIR", dir, 1);
+  std::string path = std::string(dir) + "/" TEST_FILENAME;
+  HOST_CHECK(writeImpulseWav(path.c_str()));
+  HOST_CHECK(audio_replay_.begin(TEST_FILENAME));
+  ImpulseLatency replayed = replayImpulse(idx);
+  printf("# replayed impulse to frame us %u frames %u\n", replayed.render_us, replayed.frames);
+  HOST_CHECK(replayed.reacted);
+  HOST_CHECK(replayed.render_us <= fftLatencyUs(2*AUDIO_BLOCK_SAMPLES, AUDIO_BLOCK_SAMPLES, REPLAY_FFT_AVERAGE, TEST_SAMPLE_RATE) + TEST_FRAME_SLACK_US);
+
+  unlink(path.c_str());
+  rmdir(dir);
+  return hostTestResult("impulse latency");
+}
@@ -0,0 +1,148 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// SDRecorder and SDPlayback on the host's SD card directory:
+///  * recorded frames play back unchanged, in wire order, with the brightness they were sent with
+///  * a record header that claims more blocks than the playback buffer holds (corrupt file)
+///    is skipped block by block, instead of waiting for it forever
+///  * show_leds() records the animation's brightness, so playback is dimmed by ambient and
+///    settings once, not twice
+/// Built with the default NUM_LEDS (a frame in one block) and with 1000 LEDs (a frame over several).
+
+#include <Arduino.h>
+#include <unistd.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+#define TEST_RECORDING "TEST.LED"
+#define TEST_CORRUPT "CORRUPT.LED"
+#define TEST_SHOWN "SHOWN.LED"
+#define TEST_ANIM_BRIGHTNESS 200
+#define TEST_SETTINGS_BRIGHTNESS 128
+#define TEST_FRAMES 5
+#define TEST_MAX_READS 100
+
+std::string dir_;
+
+CRGB testColor(uint8_t frame, ledctr_t l)
+{
+  return CRGB(frame, l, 255 - l);
+}
+
+void recordTestFrames()
+{
+  CRGB frame[NUM_LEDS];
+  HOST_CHECK(sd_recorder_.begin(TEST_RECORDING));
+  for (uint8_t f=0; f<TEST_FRAMES; f++)
+  {
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+      frame[l] = testColor(f, l);
+    sd_recorder_.recordFrame(frame, 100 + f);
+    for (uint16_t b=0; b<SD_FRAME_BLOCKS; b++)
+      sd_recorder_.service();
+  }
+  sd_recorder_.end();
+}
+
+/// reads max_frames frames, their first byte (the frame number) into numbers
+uint8_t playFrames(const char *filename, uint8_t *numbers, uint8_t max_frames, SDPlayback &playback)
+{
+  CRGB frame[NUM_LEDS];
+  uint8_t n = 0;
+  HOST_CHECK(playback.begin(filename));
+  for (uint16_t r=0; r<TEST_MAX_READS && n < max_frames; r++)
+  {
+    playback.readAhead(SD_PLAYBACK_READS_PER_FRAME);
+    ledctr_t origin;
+    uint8_t brightness, flags;
+    uint32_t time_us;
+    if (!playback.nextFrame(frame, origin, brightness, flags, time_us))
+      continue;
+    bool same = 0 == origin && SD_FRAME_WIRE_ORDER == flags && 100 + frame[0].r == brightness;
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+      same &= frame[l] == testColor(frame[0].r, l);
+    HOST_CHECK(same);
+    numbers[n++] = frame[0].r;
+  }
+  playback.end();
+  return n;
+}
+
+void testRoundTrip()
+{
+  SDPlayback playback;
+  uint8_t numbers[TEST_FRAMES];
+  HOST_CHECK(TEST_FRAMES == playFrames(TEST_RECORDING, numbers, TEST_FRAMES, playback));
+  for (uint8_t f=0; f<TEST_FRAMES; f++)
+    HOST_CHECK(f == numbers[f]);
+  HOST_CHECK(0 == playback.resyncs());
+}
+
+/// the recording, with a block claiming a huge record after the first frame
+void testCorruptRecord()
+{
+  std::vector<uint8_t> file((1 + TEST_FRAMES * SD_FRAME_BLOCKS) * SD_RECORDING_BLOCK);
+  FILE *in = fopen((dir_ + "/" TEST_RECORDING).c_str(), "rb");
+  HOST_CHECK(in && file.size() == fread(file.data(), 1, file.size(), in));
+  if (in)
+    fclose(in);
+  std::vector<uint8_t> bogus(SD_RECORDING_BLOCK, 0);
+  bogus[0] = SD_RECORD_FRAME;
+  sdPutU16(&bogus[2], 60000);
+  file.insert(file.begin() + (1 + SD_FRAME_BLOCKS) * SD_RECORDING_BLOCK, bogus.begin(), bogus.end());
+  FILE *out = fopen((dir_ + "/" TEST_CORRUPT).c_str(), "wb");
+  HOST_CHECK(out && file.size() == fwrite(file.data(), 1, file.size(), out));
+  if (out)
+    fclose(out);
+
+  SDPlayback playback;
+  uint8_t numbers[TEST_FRAMES];
+  HOST_CHECK(TEST_FRAMES == playFrames(TEST_CORRUPT, numbers, TEST_FRAMES, playback));
+  for (uint8_t f=0; f<TEST_FRAMES; f++)
+    HOST_CHECK(f == numbers[f]);
+  HOST_CHECK(1 == playback.resyncs());
+}
+
+/// a frame recorded through show_leds() with global brightness below 255, played back by the animation
+void testShownBrightness()
+{
+  crossfade_.cancel();
+  leds_origin_ = 0;
+  settings_.brightness = TEST_SETTINGS_BRIGHTNESS;
+  for (ledctr_t l=0; l<NUM_LEDS; l++)
+    leds_[l] = testColor(7, l);
+  FastLED.setBrightness(TEST_ANIM_BRIGHTNESS);
+  HOST_CHECK(sd_recorder_.begin(TEST_SHOWN));
+  show_leds();
+  sd_recorder_.end();
+  settings_.brightness = 255;
+
+  fill_solid(leds_, NUM_LEDS, CRGB::Black);
+  FastLED.setBrightness(255);
+  AnimationSDPlayback playback(TEST_SHOWN);
+  playback.init();
+  playback.run();
+  HOST_CHECK(TEST_ANIM_BRIGHTNESS == FastLED.getBrightness());
+  bool same = true;
+  for (ledctr_t l=0; l<NUM_LEDS; l++)
+    same &= leds_[l] == testColor(7, l);
+  HOST_CHECK(same);
+}
+
+int main()
+{
+  char dir[] = "/tmp/test_sd_recording_XXXXXX";
+  HOST_CHECK(nullptr != mkdtemp(dir));
+  dir_ = dir;
+  setenv("HOST_SD_DIR", dir, 1);
+  setup();
+  recordTestFrames();
+  testRoundTrip();
+  testCorruptRecord();
+  testShownBrightness();
+  unlink((dir_ + "/" TEST_RECORDING).c_str());
+  unlink((dir_ + "/" TEST_CORRUPT).c_str());
+  unlink((dir_ + "/" TEST_SHOWN).c_str());
+  rmdir(dir);
+  return hostTestResult("sd recording");
+}
@@ -0,0 +1,175 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// SettingsStore on RamSettingsBackend, with the sketch's Settings and EEPROM area:
+///  * a burst of changes is coalesced into one record
+///  * a record cut short (reset while writing) or corrupted is rejected by its CRC,
+///    load() falls back to the record before
+///  * the sequence number wraps around (more than 65536 commits) without losing the newest record
+///  * writes are spread evenly over all slots
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+typedef SettingsStore<Settings, RamSettingsBackend<SETTINGS_EEPROM_SIZE>, 0, SETTINGS_EEPROM_SIZE> TestStore;
+
+#define TEST_WRAP_COMMITS 70000UL
+
+uint32_t now_ms_ = 0;
+
+/// settings that tell commit n apart
+Settings testSettings(uint32_t n)
+{
+  return Settings{static_cast<uint8_t>(n >> 16), static_cast<uint8_t>(n >> 8), static_cast<uint16_t>(n), static_cast<uint16_t>(~n), {1, 2}};
+}
+
+bool sameSettings(const Settings &a, const Settings &b)
+{
+  return 0 == memcmp(&a, &b, sizeof(Settings));
+}
+
+/// services until the pending commit is written completely
+void serviceUntilDone(TestStore &store)
+{
+  now_ms_ += SETTINGS_COMMIT_DELAY_MS;
+  while (store.pending())
+    store.service(now_ms_++);
+}
+
+void commit(TestStore &store, Settings &settings, uint32_t n)
+{
+  settings = testSettings(n);
+  store.changed(now_ms_);
+  serviceUntilDone(store);
+}
+
+/// what a reboot would load from the backend of store
+bool loadCopy(TestStore &store, Settings &loaded)
+{
+  TestStore reboot(loaded, SETTINGS_VERSION);
+  reboot.backend() = store.backend();
+  return reboot.load();
+}
+
+void testCoalescing()
+{
+  Settings settings = testSettings(0);
+  TestStore store(settings, SETTINGS_VERSION);
+  HOST_CHECK(!store.load());
+  for (uint32_t n=1; n<=20; n++)
+  {
+    settings = testSettings(n);
+    store.changed(now_ms_);
+    now_ms_ += SETTINGS_COMMIT_DELAY_MS / 2;
+    store.service(now_ms_);
+  }
+  HOST_CHECK(store.pending());
+  HOST_CHECK(0 == store.backend().writes);
+  serviceUntilDone(store);
+  HOST_CHECK(1 == store.commits());
+  Settings loaded = testSettings(0);
+  HOST_CHECK(loadCopy(store, loaded));
+  HOST_CHECK(sameSettings(loaded, testSettings(20)));
+  //a change while writing goes into the next record
+  settings = testSettings(21);
+  store.changed(now_ms_);
+  now_ms_ += SETTINGS_COMMIT_DELAY_MS;
+  store.service(now_ms_);
+  settings = testSettings(22);
+  store.changed(now_ms_);
+  serviceUntilDone(store);
+  HOST_CHECK(3 == store.commits());
+  HOST_CHECK(loadCopy(store, loaded));
+  HOST_CHECK(sameSettings(loaded, testSettings(22)));
+}
+
+void testTornRecord()
+{
+  Settings settings = testSettings(0);
+  TestStore store(settings, SETTINGS_VERSION);
+  //go around once, so the slot to be torn holds an old record
+  uint32_t n = 1;
+  for (; n<=TestStore::slots() + 1U; n++)
+    commit(store, settings, n);
+  const uint32_t last_complete = n - 1;
+
+  settings = testSettings(n);
+  store.changed(now_ms_);
+  now_ms_ += SETTINGS_COMMIT_DELAY_MS;
+  for (uint16_t written=0; written < TestStore::recordBytes() - 1; written += SETTINGS_BYTES_PER_SERVICE)
+  {
+    Settings loaded = testSettings(0);
+    HOST_CHECK(loadCopy(store, loaded));
+    HOST_CHECK(sameSettings(loaded, testSettings(last_complete)));
+    store.service(now_ms_++);
+  }
+  serviceUntilDone(store);
+  Settings loaded = testSettings(0);
+  HOST_CHECK(loadCopy(store, loaded));
+  HOST_CHECK(sameSettings(loaded, testSettings(n)));
+
+  //a flipped bit in the newest record
+  TestStore corrupt(loaded, SETTINGS_VERSION);
+  corrupt.backend() = store.backend();
+  uint16_t addr = store.newestSlot() * TestStore::recordBytes() + 5;
+  corrupt.backend().mem[addr] ^= 0x10;
+  HOST_CHECK(corrupt.load());
+  HOST_CHECK(sameSettings(loaded, testSettings(last_complete)));
+}
+
+void testSeqWrapAndWear()
+{
+  Settings settings = testSettings(0);
+  TestStore store(settings, SETTINGS_VERSION);
+  bool all_loaded = true;
+  for (uint32_t n=1; n<=TEST_WRAP_COMMITS; n++)
+  {
+    commit(store, settings, n);
+    //around the wrap every commit, elsewhere now and then
+    if (n % 997 == 0 || (n > 65530 && n < 65545))
+    {
+      Settings loaded = testSettings(0);
+      all_loaded &= loadCopy(store, loaded) && sameSettings(loaded, testSettings(n));
+    }
+  }
+  HOST_CHECK(all_loaded);
+  HOST_CHECK(TEST_WRAP_COMMITS == store.commits());
+  HOST_CHECK(static_cast<uint16_t>(TEST_WRAP_COMMITS) == store.seq());
+
+  //after a reboot, commits continue after the newest record
+  Settings loaded = testSettings(0);
+  TestStore reboot(loaded, SETTINGS_VERSION);
+  reboot.backend() = store.backend();
+  HOST_CHECK(reboot.load());
+  HOST_CHECK(store.seq() == reboot.seq());
+  HOST_CHECK(store.newestSlot() == reboot.newestSlot());
+  commit(reboot, loaded, TEST_WRAP_COMMITS + 1);
+  HOST_CHECK(loadCopy(reboot, settings));
+  HOST_CHECK(sameSettings(settings, testSettings(TEST_WRAP_COMMITS + 1)));
+
+  //the low sequence byte changes with every record, so its wear counts the records per slot
+  uint32_t least = UINT32_MAX, most = 0;
+  for (uint16_t slot=0; slot<TestStore::slots(); slot++)
+  {
+    uint32_t records = store.backend().wear[slot * TestStore::recordBytes() + 2];
+    least = min(least, records);
+    most = max(most, records);
+  }
+  printf("# records per slot %u..%u, %u slots\n", least, most, TestStore::slots());
+  HOST_CHECK(most - least <= 1);
+  HOST_CHECK(most <= TEST_WRAP_COMMITS / TestStore::slots() + 1);
+  bool unused_untouched = true;
+  for (uint16_t addr=TestStore::slots() * TestStore::recordBytes(); addr<SETTINGS_EEPROM_SIZE; addr++)
+    unused_untouched &= 0 == store.backend().wear[addr];
+  HOST_CHECK(unused_untouched);
+}
+
+int main()
+{
+  setup();
+  testCoalescing();
+  testTornRecord();
+  testSeqWrapAndWear();
+  return hostTestResult("settings store");
+}
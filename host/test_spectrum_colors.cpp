@@ -0,0 +1,32 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// spectrum_colors.h against hsv2rgb_rainbow() of the FastLED stand-in (FastLED's own code):
+/// RainbowLUT hue plus ColorScale gives the same color, bit for bit, for all 2^24 (hue, sat, val).
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+int main()
+{
+  uint32_t mismatches = 0;
+  for (uint16_t sat=0; sat<256; sat++)
+  {
+    for (uint16_t val=0; val<256; val++)
+    {
+      ColorScale cs = colorScale(sat, val);
+      for (uint16_t hue=0; hue<256; hue++)
+      {
+        CRGB expected;
+        hsv2rgb_rainbow(CHSV(hue, sat, val), expected);
+        CRGB table = applyColorScale(rainbow_lut_.hue(hue), cs);
+        if (table != expected && mismatches++ < 10)
+          printf("# hsv %u %u %u: table %u %u %u, hsv2rgb_rainbow %u %u %u\n", hue, sat, val,
+            table.r, table.g, table.b, expected.r, expected.g, expected.b);
+      }
+    }
+  }
+  HOST_CHECK(0 == mismatches);
+  return hostTestResult("spectrum colors");
+}
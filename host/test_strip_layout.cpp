@@ -0,0 +1,118 @@
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// StripLayout against the mock output sinks of host/stubs/FastLED.h:
+/// every pin gets its part of the frame in its color order, reversed segments backwards,
+/// rotated frames in physical order, and pins send at the same time, so three pins
+/// reach about three times the frame rate of one.
+
+#include <Arduino.h>
+#include "../WS2812AudioFFT_music_ducks.ino"
+#include "host_test.h"
+
+#define TEST_FRAMES 100
+#define TEST_THIRD (NUM_LEDS/3)
+
+CRGB frame_[NUM_LEDS];
+CRGB scratch_[NUM_LEDS];
+
+StripSegment three_pins_[] = {
+  {0, TEST_THIRD, false},
+  {TEST_THIRD, TEST_THIRD, true},
+  {2*TEST_THIRD, NUM_LEDS - 2*TEST_THIRD, false},
+};
+StripLayout three_pins_layout_(three_pins_, 3);
+
+StripSegment one_pin_[] = {
+  {0, NUM_LEDS, false},
+};
+StripLayout one_pin_layout_(one_pin_, 1);
+
+CRGB testColor(ledctr_t l)
+{
+  return CRGB(l, l + 100, l + 200);
+}
+
+/// the pin sends its segment in order (backwards if reversed), each LED in the pin's color order
+void checkWire(const StripSegment &seg, const uint8_t order[3])
+{
+  const std::vector<uint8_t> &wire = seg.controller->wire();
+  HOST_CHECK(wire.size() == 3 * seg.count);
+  bool all_match = true;
+  for (ledctr_t l=0; l<seg.count && 3*l+2 < wire.size(); l++)
+  {
+    CRGB want = testColor(seg.reversed ? seg.first + seg.count - 1 - l : seg.first + l);
+    for (uint8_t c=0; c<3; c++)
+      all_match &= wire[3*l+c] == want.raw[order[c]];
+  }
+  HOST_CHECK(all_match);
+}
+
+void testWireContent()
+{
+  const uint8_t grb[3] = {1, 0, 2};
+  const uint8_t rgb[3] = {0, 1, 2};
+  const uint8_t brg[3] = {2, 0, 1};
+  FastLED.setBrightness(255);
+  for (ledctr_t origin : {static_cast<ledctr_t>(0), static_cast<ledctr_t>(7), static_cast<ledctr_t>(NUM_LEDS-1)})
+  {
+    //what RotatingStrip leaves in the buffer: leds_[l] shows at physical position l+origin
+    for (ledctr_t l=0; l<NUM_LEDS; l++)
+      frame_[l] = testColor((l + origin) % NUM_LEDS);
+    const CRGB *shown = three_pins_layout_.show(frame_, origin, scratch_);
+    HOST_CHECK(shown == scratch_);
+    checkWire(three_pins_[0], grb);
+    checkWire(three_pins_[1], rgb);
+    checkWire(three_pins_[2], brg);
+  }
+}
+
+/// frames/s the pins of layout reached, showing as fast as the CPU can
+uint32_t sinkFps(StripLayout &layout, StripSegment *segments, uint8_t num_segments)
+{
+  for (uint16_t f=0; f<TEST_FRAMES; f++)
+    layout.show(frame_, 0, scratch_);
+  uint32_t frames = segments[0].controller->frames();
+  uint64_t first = UINT64_MAX, last = 0;
+  for (uint8_t s=0; s<num_segments; s++)
+  {
+    const CLEDController &pin = *segments[s].controller;
+    HOST_CHECK(pin.frames() == frames);
+    first = min(first, pin.firstStartUs());
+    last = max(last, pin.lastEndUs());
+  }
+  return static_cast<uint64_t>(frames) * 1000000 / (last - first);
+}
+
+void checkFps(uint32_t fps, StripLayout &layout)
+{
+  uint32_t predicted = 1000000 / layout.frameWireUs();
+  HOST_CHECK(fps + 1 >= predicted && fps <= predicted + 1);
+}
+
+/// FastLED.show() sends on every pin attached so far, so the single pin is attached last:
+/// it would limit the three pin layout otherwise
+void testParallelPins()
+{
+  uint32_t three = sinkFps(three_pins_layout_, three_pins_, 3);
+  one_pin_layout_.attach<5,GRB>(0, frame_);
+  uint32_t one = sinkFps(one_pin_layout_, one_pin_, 1);
+  printf("# sink fps three pins %u one pin %u, frameWireUs() predicts %u and %u\n", three, one,
+    static_cast<uint32_t>(1000000 / three_pins_layout_.frameWireUs()), static_cast<uint32_t>(1000000 / one_pin_layout_.frameWireUs()));
+  checkFps(three, three_pins_layout_);
+  checkFps(one, one_pin_layout_);
+  HOST_CHECK(three > 5 * one / 2);
+  //all pins of a frame start together
+  HOST_CHECK(three_pins_[0].controller->lastStartUs() == three_pins_[1].controller->lastStartUs());
+  HOST_CHECK(three_pins_[0].controller->lastStartUs() == three_pins_[2].controller->lastStartUs());
+}
+
+int main()
+{
+  three_pins_layout_.attach<1,GRB>(0, frame_);
+  three_pins_layout_.attach<10,RGB>(1, frame_);
+  three_pins_layout_.attach<8,BRG>(2, frame_);
+  testWireContent();
+  testParallelPins();
+  return hostTestResult("strip layout");
+}
@@ -0,0 +1,154 @@
+#ifndef LATENCY_INCLUDE__H
+#define LATENCY_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// How long from a sound at the microphone to the LEDs showing it.
+///
+/// Every audio feature update carries the time its newest sample was captured.
+/// audio_latency_ collects three stages, each in a LatencyHistogram:
+///  * analysis: capture until the features are published (buffering, FFT, polling by the mic task)
+///  * pickup:   published until an animation reads them (animation polling, next_run delay)
+///  * total:    capture until the frame using them is out on the wire (show() plus transmit time)
+///
+/// // example use:
+/// audio_features_.setFFT(bins, capture_us);  //producer, calls published()
+/// audio_.newFFT();                           //animation's AudioFeatureReader, calls consumed()
+/// FastLED.show();
+/// audio_latency_.shown(micros(), wire_us);
+/// audio_latency_.print(Serial);
+///
+
+#define LATENCY_BUCKET_US 250
+#define LATENCY_BUCKETS 160 //up to 40ms, anything slower counts in the last bucket
+
+class LatencyHistogram
+{
+private:
+  uint16_t buckets_[LATENCY_BUCKETS];
+  uint32_t count_;
+  uint32_t min_us_;
+  uint32_t max_us_;
+  uint64_t sum_us_;
+
+public:
+  LatencyHistogram()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    memset(buckets_, 0, sizeof(buckets_));
+    count_ = 0;
+    min_us_ = UINT32_MAX;
+    max_us_ = 0;
+    sum_us_ = 0;
+  }
+
+  void add(uint32_t us)
+  {
+    uint16_t b = min(us / LATENCY_BUCKET_US, static_cast<uint32_t>(LATENCY_BUCKETS-1));
+    if (buckets_[b] < UINT16_MAX)
+      buckets_[b]++;
+    count_++;
+    min_us_ = min(min_us_, us);
+    max_us_ = max(max_us_, us);
+    sum_us_ += us;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t minUs() const { return (count_ > 0) ? min_us_ : 0; }
+  uint32_t maxUs() const { return max_us_; }
+  uint32_t meanUs() const { return (count_ > 0) ? sum_us_ / count_ : 0; }
+
+  /// upper edge of the bucket holding the given percentile, at most maxUs()
+  uint32_t percentileUs(uint8_t percent) const
+  {
+    uint32_t total = 0;
+    for (uint16_t b=0; b<LATENCY_BUCKETS; b++)
+      total += buckets_[b];
+    uint32_t want = (total * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint16_t b=0; b<LATENCY_BUCKETS; b++)
+    {
+      seen += buckets_[b];
+      if (seen >= want && seen > 0)
+        return min(static_cast<uint32_t>(b+1) * LATENCY_BUCKET_US, max_us_);
+    }
+    return max_us_;
+  }
+
+  void print(Print &out, const char *name) const
+  {
+    out.print(name);
+    out.print('\t');
+    out.print(count());
+    out.print('\t');
+    out.print(minUs());
+    out.print('\t');
+    out.print(meanUs());
+    out.print('\t');
+    out.print(percentileUs(50));
+    out.print('\t');
+    out.print(percentileUs(99));
+    out.print('\t');
+    out.println(maxUs());
+  }
+};
+
+class AudioLatency
+{
+private:
+  LatencyHistogram analysis_;
+  LatencyHistogram pickup_;
+  LatencyHistogram total_;
+  uint32_t frame_capture_us_=0; //newest audio the frame being rendered has read
+  bool frame_has_audio_=false;
+
+public:
+  /// a producer published features from audio captured at capture_us
+  void published(uint32_t capture_us, uint32_t now)
+  {
+    analysis_.add(now - capture_us);
+  }
+
+  /// an animation read features published at publish_us
+  void consumed(uint32_t capture_us, uint32_t publish_us, uint32_t now)
+  {
+    pickup_.add(now - publish_us);
+    if (!frame_has_audio_ || static_cast<int32_t>(capture_us - frame_capture_us_) > 0)
+      frame_capture_us_ = capture_us;
+    frame_has_audio_ = true;
+  }
+
+  /// frame was handed to the LED driver at now and takes wire_us to transmit
+  void shown(uint32_t now, uint32_t wire_us)
+  {
+    if (!frame_has_audio_)
+      return;
+    total_.add(now + wire_us - frame_capture_us_);
+    frame_has_audio_ = false;
+  }
+
+  void reset()
+  {
+    analysis_.reset();
+    pickup_.reset();
+    total_.reset();
+    frame_has_audio_ = false;
+  }
+
+  void print(Print &out) const
+  {
+    out.println("# latency\tcount\tmin_us\tmean_us\tp50_us\tp99_us\tmax_us");
+    analysis_.print(out, "analysis");
+    pickup_.print(out, "pickup");
+    total_.print(out, "total");
+  }
+};
+
+AudioLatency audio_latency_;
+
+#endif //LATENCY_INCLUDE__H
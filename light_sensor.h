@@ -0,0 +1,83 @@
+#ifndef LIGHT_SENSOR_INCLUDE__H
+#define LIGHT_SENSOR_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Ambient light from the photoresistor, sampled at a fixed low rate.
+///  * samples in millivolts, filtered by an integer exponential moving average
+///    with a time constant in ms (rounded down to a power of two of sample periods)
+///  * dark() with hysteresis: becomes true below dark_mv, false again above bright_mv
+///  * ambient(): continuous 0 (pitch dark) .. 255 (at bright_mv and above), only meaningful
+///    for an analog source, a digital pin just jumps between 0 and 255
+/// Whatever the source (ADC, digital pin as 0 or full scale mV), it only needs update().
+///
+/// // example use:
+/// LightSensor light_sensor_(450, 550, 1000, 100000); //dark below 450mV, light above 550mV, 1s, 10Hz
+/// light_sensor_.update(analogRead(A3) * 3300 / 4095);
+/// if (light_sensor_.dark()) ...
+///
+
+#define LIGHT_SENSOR_FULL_SCALE_MV 3300
+
+class LightSensor
+{
+private:
+  uint16_t dark_mv_;
+  uint16_t bright_mv_;
+  uint8_t shift_=0; //filter: 2^shift samples
+  uint32_t filtered_q8_=0; //mV << 8
+  uint16_t raw_mv_=0;
+  bool dark_=true;
+  bool primed_=false;
+
+public:
+  LightSensor(uint16_t dark_mv, uint16_t bright_mv, uint32_t time_constant_ms, uint32_t period_us) : dark_mv_(dark_mv), bright_mv_(bright_mv)
+  {
+    uint32_t periods = time_constant_ms * 1000 / period_us;
+    while ((2UL << shift_) <= periods && shift_ < 16)
+      shift_++;
+  }
+
+  /// new sample
+  void update(uint16_t mv)
+  {
+    raw_mv_ = mv;
+    uint32_t sample_q8 = static_cast<uint32_t>(mv) << 8;
+    if (!primed_)
+    {
+      filtered_q8_ = sample_q8;
+      primed_ = true;
+    } else {
+      filtered_q8_ = filtered_q8_ + (static_cast<int32_t>(sample_q8 - filtered_q8_) >> shift_);
+    }
+    uint16_t level = mV();
+    if (level < dark_mv_)
+      dark_ = true;
+    else if (level > bright_mv_)
+      dark_ = false;
+  }
+
+  void setThresholds(uint16_t dark_mv, uint16_t bright_mv)
+  {
+    dark_mv_ = dark_mv;
+    bright_mv_ = (bright_mv > dark_mv) ? bright_mv : dark_mv;
+  }
+
+  bool dark() const { return dark_; }
+  /// filtered level
+  uint16_t mV() const { return filtered_q8_ >> 8; }
+  /// last sample, unfiltered
+  uint16_t rawMV() const { return raw_mv_; }
+  uint16_t darkThresholdMV() const { return dark_mv_; }
+  uint16_t brightThresholdMV() const { return bright_mv_; }
+
+  /// 0 in darkness up to 255 at the bright threshold
+  uint8_t ambient() const
+  {
+    uint32_t level = static_cast<uint32_t>(mV()) * 255 / bright_mv_;
+    return (level > 255) ? 255 : level;
+  }
+};
+
+#endif //LIGHT_SENSOR_INCLUDE__H
@@ -0,0 +1,138 @@
+#ifndef PIXEL_KERNELS_INCLUDE__H
+#define PIXEL_KERNELS_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Whole-buffer pixel kernels, working on 4 channels per 32-bit word (SWAR).
+/// A CRGB buffer is treated as a flat array of 3*num_leds bytes, the same
+/// channel of the neighbouring pixel is 3 bytes away.
+///
+/// Cortex-M4 (Teensy 3.x) uses the uqadd8 SIMD instruction for saturating adds,
+/// everywhere else a portable bit-trick fallback gives the same result.
+/// The scalar tail of every kernel computes exactly what the word loop computes,
+/// so results do not depend on buffer length or platform.
+
+inline uint32_t kernelLoad32(const uint8_t *p)
+{
+  uint32_t w;
+  memcpy(&w, p, 4); //unaligned loads are fine on Cortex-M4, gcc makes this a single ldr
+  return w;
+}
+
+inline void kernelStore32(uint8_t *p, uint32_t w)
+{
+  memcpy(p, &w, 4);
+}
+
+/// per byte saturating add of 4 lanes
+inline uint32_t kernelQadd8x4(uint32_t a, uint32_t b)
+{
+#if defined(__ARM_FEATURE_SIMD32)
+  uint32_t r;
+  asm ("uqadd8 %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+  return r;
+#else
+  uint32_t sum = ((a & 0x7F7F7F7F) + (b & 0x7F7F7F7F)) ^ ((a ^ b) & 0x80808080);
+  uint32_t carry = ((a & b) | ((a | b) & ~sum)) & 0x80808080;
+  return sum | ((carry >> 7) * 0xFF);
+#endif
+}
+
+/// per byte x/4 of 4 lanes
+inline uint32_t kernelQuarter8x4(uint32_t w)
+{
+  return (w >> 2) & 0x3F3F3F3F;
+}
+
+/// per byte scale8(x, scale) of 4 lanes, same rounding as FastLED's scale8: x*(1+scale)/256
+inline uint32_t kernelScale8x4(uint32_t w, uint8_t scale)
+{
+  uint32_t s1 = static_cast<uint32_t>(scale) + 1;
+  uint32_t even = ((w & 0x00FF00FF) * s1) >> 8;
+  uint32_t odd = ((w >> 8) & 0x00FF00FF) * s1;
+  return (even & 0x00FF00FF) | (odd & 0xFF00FF00);
+}
+
+/// per byte (a + 2*b)/3 of 4 lanes, rounded (within one unit of integer division)
+inline uint32_t kernelHeat8x4(uint32_t a, uint32_t b)
+{
+  //16bit lanes: (255+2*255)*85+128 = 65153 does not carry into the next lane
+  uint32_t even = ((a & 0x00FF00FF) + 2*(b & 0x00FF00FF)) * 85 + 0x00800080;
+  uint32_t odd = (((a >> 8) & 0x00FF00FF) + 2*((b >> 8) & 0x00FF00FF)) * 85 + 0x00800080;
+  return ((even >> 8) & 0x00FF00FF) | (odd & 0xFF00FF00);
+}
+
+inline uint8_t kernelHeat8(uint8_t a, uint8_t b)
+{
+  return ((static_cast<uint16_t>(a) + 2*static_cast<uint16_t>(b)) * 85 + 0x80) >> 8;
+}
+
+/// fadeToBlackBy() for a whole buffer
+inline void fadePixels(CRGB *leds, ledctr_t num_leds, uint8_t fade_by)
+{
+  uint8_t *b = reinterpret_cast<uint8_t*>(leds);
+  const uint32_t len = 3*num_leds;
+  const uint8_t scale = 255 - fade_by;
+  uint32_t k = 0;
+  for (; k + 4 <= len; k += 4)
+  {
+    kernelStore32(b+k, kernelScale8x4(kernelLoad32(b+k), scale));
+  }
+  for (; k < len; k++)
+  {
+    b[k] = scale8(b[k], scale);
+  }
+}
+
+/// every channel gets a quarter of the same channel of both neighbours added:
+///   px[i] = px[i] + px[i-1]/4 + px[i+1]/4 (saturating, using the values before the pass)
+/// Pixels outside the strip count as black.
+inline void diffusePixels(CRGB *leds, ledctr_t num_leds)
+{
+  uint8_t *b = reinterpret_cast<uint8_t*>(leds);
+  const uint32_t len = 3*num_leds;
+  uint32_t k = 0;
+  uint32_t prev_old = 0; //bytes [k-4..k-1] before they were overwritten
+  for (; k + 7 <= len; k += 4)
+  {
+    uint32_t cur = kernelLoad32(b+k);
+    uint32_t next = kernelLoad32(b+k+3);
+    uint32_t prev = (prev_old >> 8) | (cur << 24);
+    kernelStore32(b+k, kernelQadd8x4(cur, kernelQadd8x4(kernelQuarter8x4(prev), kernelQuarter8x4(next))));
+    prev_old = cur;
+  }
+  //byte-wise tail, hist holds bytes [k-3..k-1] before they were overwritten
+  uint8_t hist[3] = {static_cast<uint8_t>(prev_old >> 8), static_cast<uint8_t>(prev_old >> 16), static_cast<uint8_t>(prev_old >> 24)};
+  for (; k < len; k++)
+  {
+    uint8_t cur = b[k];
+    uint8_t next = (k+3 < len) ? b[k+3] : 0;
+    b[k] = qadd8(cur, qadd8(hist[0] >> 2, next >> 2));
+    hist[0] = hist[1];
+    hist[1] = hist[2];
+    hist[2] = cur;
+  }
+}
+
+/// Fire2012 step 2: heat drifts up and diffuses, heat[k] = (heat[k-1] + 2*heat[k-2])/3
+/// for k from num_cells-1 down to 2. Cells 0 and 1 are left as they are.
+inline void diffuseHeat(uint8_t *heat, ledctr_t num_cells)
+{
+  if (num_cells < 3)
+    return;
+  ledctr_t k = num_cells - 1;
+  //write heat[k-3..k] from heat[k-4..k-1] and heat[k-5..k-2], going down keeps the sources unmodified
+  for (; k >= 5; k -= 4)
+  {
+    uint32_t prev1 = kernelLoad32(heat + k - 4);
+    uint32_t prev2 = kernelLoad32(heat + k - 5);
+    kernelStore32(heat + k - 3, kernelHeat8x4(prev1, prev2));
+  }
+  for (; k >= 2; k--)
+  {
+    heat[k] = kernelHeat8(heat[k-1], heat[k-2]);
+  }
+}
+
+#endif //PIXEL_KERNELS_INCLUDE__H
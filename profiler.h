@@ -0,0 +1,167 @@
+#ifndef PROFILER_INCLUDE__H
+#define PROFILER_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Cycle count histograms per animation, per scheduler task and for show(),
+/// to find what stutters. Only with USE_PROFILER defined, otherwise the macros
+/// below compile to nothing.
+///
+/// Every slot keeps a log2 histogram of cycles (so p50/p99 are upper bounds, within 2x),
+/// the exact max and mean, and how often a budget (the delay an animation asked for,
+/// a task's deadline) was overrun. All in a fixed array, no allocation.
+/// Cycles come from cycle_counter.h (DWT on Teensy, micros() elsewhere).
+///
+/// // example use:
+/// PROFILER_START(start);
+/// delay_ms = animations_.run(idx);
+/// PROFILER_ADD(profilerAnimSlot(idx), nullptr, start);
+/// PROFILER_BUDGET(profilerAnimSlot(idx), start, delay_ms*1000);
+/// ...
+/// profiler_.print(Serial);
+///
+
+#ifdef USE_PROFILER
+
+#include "cycle_counter.h"
+
+#ifndef PROFILER_SLOTS
+#define PROFILER_SLOTS 40
+#endif
+#define PROFILER_BUCKETS 24 //2^24 cycles = 175ms at 96MHz, slower counts in the last bucket
+#define PROFILER_TASK_SLOTS 8
+#define PROFILER_SLOT_SHOW 0
+#define PROFILER_SLOT_FIRST_TASK 1
+#define PROFILER_SLOT_FIRST_ANIM (PROFILER_SLOT_FIRST_TASK + PROFILER_TASK_SLOTS)
+
+/// slot of scheduler task t and of animation idx, the last slot is shared by all that do not fit
+inline uint8_t profilerTaskSlot(uint8_t t)
+{
+  return PROFILER_SLOT_FIRST_TASK + min(t, static_cast<uint8_t>(PROFILER_TASK_SLOTS-1));
+}
+
+inline uint8_t profilerAnimSlot(uint8_t idx)
+{
+  return min(PROFILER_SLOT_FIRST_ANIM + idx, PROFILER_SLOTS-1);
+}
+
+struct ProfilerSlot
+{
+  const char *name; //nullptr for animations, printed as "anim <idx>"
+  uint16_t buckets[PROFILER_BUCKETS]; //bucket b: cycles < 2^(b+1)
+  uint32_t count;
+  uint32_t max_cycles;
+  uint32_t overruns;
+  uint64_t sum_cycles;
+};
+
+class Profiler
+{
+private:
+  ProfilerSlot slots_[PROFILER_SLOTS];
+
+  static uint8_t bucket(uint32_t cycles)
+  {
+    uint8_t b = (cycles > 1) ? 31 - __builtin_clz(cycles) : 0;
+    return min(b, static_cast<uint8_t>(PROFILER_BUCKETS-1));
+  }
+
+  /// upper bound of the percentile, from the histogram
+  uint32_t percentile(const ProfilerSlot &slot, uint8_t percent) const
+  {
+    uint32_t total = 0;
+    for (uint8_t b=0; b<PROFILER_BUCKETS; b++)
+      total += slot.buckets[b];
+    uint32_t want = (total * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t b=0; b<PROFILER_BUCKETS; b++)
+    {
+      seen += slot.buckets[b];
+      if (seen >= want && seen > 0)
+        return min((2UL << b) - 1, slot.max_cycles);
+    }
+    return slot.max_cycles;
+  }
+
+public:
+  Profiler()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    memset(slots_, 0, sizeof(slots_));
+  }
+
+  void add(uint8_t slot, const char *name, uint32_t cycles)
+  {
+    ProfilerSlot &s = slots_[slot];
+    s.name = name;
+    uint8_t b = bucket(cycles);
+    if (s.buckets[b] < UINT16_MAX)
+      s.buckets[b]++;
+    s.count++;
+    s.max_cycles = max(s.max_cycles, cycles);
+    s.sum_cycles += cycles;
+  }
+
+  void overrun(uint8_t slot)
+  {
+    slots_[slot].overruns++;
+  }
+
+  void print(Print &out) const
+  {
+    const uint32_t cycles_per_us = F_CPU / 1000000;
+    out.println("# profile\tcount\tp50_cycles\tp99_cycles\tmax_cycles\tmean_us\tmax_us\toverruns");
+    for (uint8_t i=0; i<PROFILER_SLOTS; i++)
+    {
+      const ProfilerSlot &s = slots_[i];
+      if (0 == s.count)
+        continue;
+      if (s.name)
+      {
+        out.print(s.name);
+      } else {
+        out.print("anim ");
+        out.print(i - PROFILER_SLOT_FIRST_ANIM);
+        if (PROFILER_SLOTS-1 == i)
+          out.print('+');
+      }
+      out.print('\t');
+      out.print(s.count);
+      out.print('\t');
+      out.print(percentile(s, 50));
+      out.print('\t');
+      out.print(percentile(s, 99));
+      out.print('\t');
+      out.print(s.max_cycles);
+      out.print('\t');
+      out.print(static_cast<uint32_t>(s.sum_cycles / s.count / cycles_per_us));
+      out.print('\t');
+      out.print(s.max_cycles / cycles_per_us);
+      out.print('\t');
+      out.println(s.overruns);
+    }
+  }
+};
+
+Profiler profiler_;
+
+#define PROFILER_START(var) uint32_t var = cycleCount()
+#define PROFILER_ADD(slot, name, start) profiler_.add((slot), (name), cycleCount() - (start))
+/// counts an overrun if more than budget_us passed since start
+#define PROFILER_BUDGET(slot, start, budget_us) \
+  do { if (cycleCount() - (start) > static_cast<uint32_t>(budget_us) * (F_CPU / 1000000)) profiler_.overrun(slot); } while (0)
+
+#else
+
+#define PROFILER_START(var)
+#define PROFILER_ADD(slot, name, start)
+#define PROFILER_BUDGET(slot, start, budget_us)
+
+#endif //USE_PROFILER
+
+#endif //PROFILER_INCLUDE__H
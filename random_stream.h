@@ -0,0 +1,118 @@
+#ifndef RANDOM_STREAM_INCLUDE__H
+#define RANDOM_STREAM_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Fast, seedable random bytes for pixel effects.
+///
+/// Four independent xorshift32 lanes refill a block of RANDOM_STREAM_BLOCK bytes
+/// in one pass (the lanes do not depend on each other, so the loop vectorizes
+/// where the CPU can). Effects then take bytes from the block, either one at a time
+/// or a whole run with take() for per-LED loops.
+/// With the same seed, the same sequence comes out on every platform,
+/// so frames can be reproduced exactly.
+///
+/// // example use:
+/// RandomStream rnd;
+/// rnd.seed(42);
+/// uint8_t r = rnd.next8(64);   // 0..63
+/// const uint8_t *run = rnd.take(32);  // 32 random bytes
+///
+
+#define RANDOM_STREAM_BLOCK 256 //bytes, multiple of 16
+#define RANDOM_STREAM_SEED 0x5EED
+
+class RandomStream
+{
+private:
+  uint32_t lanes_[4];
+  uint8_t block_[RANDOM_STREAM_BLOCK] __attribute__ ((aligned (4)));
+  uint16_t pos_=RANDOM_STREAM_BLOCK;
+
+  void refill()
+  {
+    uint32_t *words = reinterpret_cast<uint32_t*>(block_);
+    for (uint16_t w=0; w<RANDOM_STREAM_BLOCK/4; w+=4)
+    {
+      for (uint8_t l=0; l<4; l++)
+      {
+        uint32_t x = lanes_[l];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        lanes_[l] = x;
+        words[w+l] = x;
+      }
+    }
+    pos_ = 0;
+  }
+
+public:
+  RandomStream(uint32_t seed=RANDOM_STREAM_SEED) { this->seed(seed); }
+
+  void seed(uint32_t seed)
+  {
+    //splitmix32, so similar seeds give unrelated lanes
+    for (uint8_t l=0; l<4; l++)
+    {
+      uint32_t z = (seed += 0x9E3779B9);
+      z = (z ^ (z >> 16)) * 0x85EBCA6B;
+      z = (z ^ (z >> 13)) * 0xC2B2AE35;
+      z ^= z >> 16;
+      lanes_[l] = (z) ? z : 0xA5A5A5A5; //xorshift must not start at 0
+    }
+    pos_ = RANDOM_STREAM_BLOCK;
+  }
+
+  /// n random bytes in one piece, n <= RANDOM_STREAM_BLOCK
+  const uint8_t *take(uint16_t n)
+  {
+    if (pos_ + n > RANDOM_STREAM_BLOCK)
+      refill();
+    const uint8_t *run = block_ + pos_;
+    pos_ += n;
+    return run;
+  }
+
+  uint8_t next8()
+  {
+    if (pos_ >= RANDOM_STREAM_BLOCK)
+      refill();
+    return block_[pos_++];
+  }
+
+  uint16_t next16()
+  {
+    const uint8_t *r = take(2);
+    return static_cast<uint16_t>(r[0]) | static_cast<uint16_t>(r[1]) << 8;
+  }
+
+  uint32_t next32()
+  {
+    const uint8_t *r = take(4);
+    uint32_t w;
+    memcpy(&w, r, 4);
+    return w;
+  }
+
+  //// range reduction by multiply and shift, like FastLED's random8(lim)
+
+  /// scales an 8bit random value r into 0..lim-1
+  static uint8_t range8(uint8_t r, uint8_t lim) { return (static_cast<uint16_t>(r) * lim) >> 8; }
+
+  /// 0..lim-1
+  uint8_t next8(uint8_t lim) { return range8(next8(), lim); }
+  /// min..lim-1
+  uint8_t next8(uint8_t min, uint8_t lim) { return min + next8(lim - min); }
+  /// 0..lim-1, lim <= 65536
+  uint32_t next16(uint32_t lim) { return (static_cast<uint32_t>(next16()) * lim) >> 16; }
+  /// min..lim-1
+  uint32_t next16(uint32_t min, uint32_t lim) { return min + next16(lim - min); }
+  /// 0..lim-1
+  uint32_t next32(uint32_t lim) { return (static_cast<uint64_t>(next32()) * lim) >> 32; }
+  /// min..lim-1
+  uint32_t next32(uint32_t min, uint32_t lim) { return min + next32(lim - min); }
+};
+
+#endif //RANDOM_STREAM_INCLUDE__H
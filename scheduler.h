@@ -0,0 +1,206 @@
+#ifndef SCHEDULER_INCLUDE__H
+#define SCHEDULER_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Small cooperative deadline scheduler.
+///
+/// Every task has a period and a deadline in microseconds. A task function returns
+/// the time until it wants to run again, or 0 to keep its configured period.
+/// All time comparisons are done on differences, so micros() wrapping around
+/// every ~71 minutes does not matter.
+///
+/// // example use:
+/// SchedulerTask tasks_[] = {
+///   //name, function, period_us, deadline_us
+///   {"button", task_check_button, 1000, 1000},
+///   {"leds", task_animate_leds, 10000, 5000},
+/// };
+/// CooperativeScheduler scheduler_(tasks_, sizeof(tasks_)/sizeof(SchedulerTask));
+/// void loop() { scheduler_.runDue(); }
+///
+/// sleepUntilDue() halts the CPU (WFI) until the next task is due. Any interrupt
+/// (SysTick every 1ms, audio DMA, timers, pins) wakes it early, so call it in a loop.
+///
+/// With USE_PROFILER, every task also gets a cycle histogram in profiler_.
+///
+
+#include "profiler.h"
+
+typedef uint32_t micros_t;
+typedef micros_t (*task_fn_t)(void);
+
+/// true if time a is at or after time b, wraparound safe
+inline bool timeReached(micros_t a, micros_t b)
+{
+  return static_cast<int32_t>(a - b) >= 0;
+}
+
+struct SchedulerTask
+{
+  const char *name;
+  task_fn_t fn;
+  micros_t period_us;
+  micros_t deadline_us; //max time from due until run finished
+  micros_t next_due_us;
+  //statistics
+  uint32_t runs;
+  uint32_t overruns;
+  micros_t max_jitter_us; //start - due
+  uint64_t sum_jitter_us;
+  micros_t max_exec_us;
+};
+
+class CooperativeScheduler
+{
+private:
+  SchedulerTask *tasks_;
+  uint8_t num_tasks_;
+  micros_t stats_since_us_=0;
+  uint64_t busy_us_=0;
+  uint64_t sleep_us_=0;
+
+public:
+  CooperativeScheduler(SchedulerTask *tasks, uint8_t num_tasks) : tasks_(tasks), num_tasks_(num_tasks) {}
+
+  void begin()
+  {
+    micros_t now = micros();
+    for (uint8_t t=0; t<num_tasks_; t++)
+    {
+      tasks_[t].next_due_us = now;
+    }
+    resetStats();
+  }
+
+  /// runs every task that is due, once
+  void runDue()
+  {
+    for (uint8_t t=0; t<num_tasks_; t++)
+    {
+      SchedulerTask &task = tasks_[t];
+      micros_t start = micros();
+      if (!timeReached(start, task.next_due_us))
+        continue;
+
+      PROFILER_START(task_start);
+      micros_t next_in = task.fn();
+      PROFILER_ADD(profilerTaskSlot(t), task.name, task_start);
+      PROFILER_BUDGET(profilerTaskSlot(t), task_start, task.deadline_us);
+      micros_t finish = micros();
+
+      micros_t jitter = start - task.next_due_us;
+      task.runs++;
+      task.sum_jitter_us += jitter;
+      task.max_jitter_us = max(task.max_jitter_us, jitter);
+      task.max_exec_us = max(task.max_exec_us, finish - start);
+      if (finish - task.next_due_us > task.deadline_us)
+        task.overruns++;
+      busy_us_ += finish - start;
+
+      if (0 == next_in)
+        next_in = task.period_us;
+      task.next_due_us += next_in;
+      //if we fell behind more than one period, skip instead of catching up in a burst
+      if (timeReached(start, task.next_due_us))
+        task.next_due_us = start + next_in;
+    }
+  }
+
+  /// time until the earliest task is due, 0 if one is due already
+  micros_t timeUntilNextDue()
+  {
+    micros_t now = micros();
+    micros_t earliest = 0xFFFFFFFF;
+    for (uint8_t t=0; t<num_tasks_; t++)
+    {
+      if (timeReached(now, tasks_[t].next_due_us))
+        return 0;
+      earliest = min(earliest, tasks_[t].next_due_us - now);
+    }
+    return earliest;
+  }
+
+  /// halt until an interrupt if no task is due, counts the time halted
+  void sleepUntilDue()
+  {
+    if (0 == timeUntilNextDue())
+      return;
+    micros_t start = micros();
+#if defined(TEENSYDUINO) && defined(__arm__)
+    asm volatile("wfi");
+#endif
+    sleep_us_ += micros() - start;
+  }
+
+  /// make a task due immediately, e.g. after switching animations
+  void runSoon(task_fn_t fn)
+  {
+    for (uint8_t t=0; t<num_tasks_; t++)
+    {
+      if (tasks_[t].fn == fn)
+        tasks_[t].next_due_us = micros();
+    }
+  }
+
+  void resetStats()
+  {
+    for (uint8_t t=0; t<num_tasks_; t++)
+    {
+      SchedulerTask &task = tasks_[t];
+      task.runs = 0;
+      task.overruns = 0;
+      task.max_jitter_us = 0;
+      task.sum_jitter_us = 0;
+      task.max_exec_us = 0;
+    }
+    busy_us_ = 0;
+    sleep_us_ = 0;
+    stats_since_us_ = micros();
+  }
+
+  /// idle time since last resetStats() in 1/1000
+  uint16_t idlePermille()
+  {
+    uint64_t elapsed = micros() - stats_since_us_;
+    if (0 == elapsed)
+      return 1000;
+    return 1000 - min(1000, static_cast<uint16_t>(busy_us_ * 1000 / elapsed));
+  }
+
+  /// time halted in sleepUntilDue() since last resetStats() in 1/1000
+  uint16_t sleepPermille()
+  {
+    uint64_t elapsed = micros() - stats_since_us_;
+    if (0 == elapsed)
+      return 0;
+    return min(1000, static_cast<uint16_t>(sleep_us_ * 1000 / elapsed));
+  }
+
+  void printStats(Print &out)
+  {
+    out.println("# task\truns\toverruns\tjitter_mean_us\tjitter_max_us\texec_max_us");
+    for (uint8_t t=0; t<num_tasks_; t++)
+    {
+      SchedulerTask &task = tasks_[t];
+      out.print(task.name);
+      out.print('\t');
+      out.print(task.runs);
+      out.print('\t');
+      out.print(task.overruns);
+      out.print('\t');
+      out.print(static_cast<uint32_t>((task.runs > 0) ? task.sum_jitter_us / task.runs : 0));
+      out.print('\t');
+      out.print(task.max_jitter_us);
+      out.print('\t');
+      out.println(task.max_exec_us);
+    }
+    out.print("# idle permille ");
+    out.print(idlePermille());
+    out.print(" sleeping ");
+    out.println(sleepPermille());
+  }
+};
+
+#endif //SCHEDULER_INCLUDE__H
@@ -0,0 +1,500 @@
+#ifndef SD_RECORDING_INCLUDE__H
+#define SD_RECORDING_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Records rendered frames and audio features to SD card, and plays frames back as an animation.
+/// tools/ledrec.py reads and writes the same format on the host (generate shows offline, inspect, benchmark).
+///
+/// File format, little endian, in blocks of 512 bytes (the SD card's sector size):
+///   block 0: "WSLEDREC", version (u16), number of LEDs (u16), FFT bins per audio record (u16), zero padding
+///   then records, each starting at a block boundary and zero padded to the end of its last block:
+///     type (u8), reserved (u8), payload length (u16), time in us since the recording started (u32), seq (u32, gaps: dropped records), payload
+///   SD_RECORD_FRAME payload: brightness (u8), flags (u8), origin (u16), RGB of every LED
+///     flags 0: in render order (what StripLayout::show() gets), e.g. generated by tools/ledrec.py
+///     SD_FRAME_WIRE_ORDER: what went out to the strip (what StripLayout::show() returns, origin 0,
+///     reversed segments already reversed), with the brightness the animation set. The recorder writes these.
+///   SD_RECORD_AUDIO payload: rms (u16), peak (u16), number of bins (u16), bins (u16 each)
+/// With 150 LEDs a frame is one block, the RAM buffers hold two frames and two spectra at any length.
+///
+/// Append only: whole blocks queue up in a small RAM buffer, the recorder task writes one block per call,
+/// so the render loop never waits for the card. If the card falls behind, records are dropped, not delayed.
+/// Playback keeps reading blocks ahead of the frame it shows, SD_PLAYBACK_READS_PER_FRAME per frame,
+/// so card latency is absorbed as long as it reads faster than frames are shown on average.
+/// Played back, a frame goes through show_leds() again: reversed segments are turned back into render
+/// order first. Frames carry the animation's brightness, not what went out, so the light sensor and
+/// global brightness scale them once, like any other animation.
+///
+/// // example use:
+/// SDRecorder sd_recorder_;
+/// sd_recorder_.begin("RECORD.LED");
+/// sd_recorder_.recordFrame(shown, FastLED.getBrightness()); //after every show
+/// sd_recorder_.recordAudio(); //from a task, records new spectra
+/// sd_recorder_.service(); //from a task, writes a block
+/// ...
+/// AnimationSDPlayback anim_sd_playback("SHOW.LED");
+///
+
+#define SD_RECORDING_BLOCK 512
+#define SD_RECORDING_MAGIC "WSLEDREC"
+#define SD_RECORDING_VERSION 1
+#define SD_RECORD_FRAME 1
+#define SD_RECORD_AUDIO 2
+#define SD_FRAME_WIRE_ORDER 0x01
+#define SD_RECORD_HEADER 12
+#define SD_FRAME_PAYLOAD (4 + 3*NUM_LEDS)
+#define SD_AUDIO_PAYLOAD (6 + 2*FFT_BINS)
+#define SD_FRAME_BLOCKS sdRecordBlocks(SD_FRAME_PAYLOAD)
+#define SD_AUDIO_BLOCKS sdRecordBlocks(SD_AUDIO_PAYLOAD)
+#define SD_RECORDER_BUFFER_BLOCKS (2*SD_FRAME_BLOCKS + 2*SD_AUDIO_BLOCKS) //two frames and two spectra, 4 with 150 LEDs
+#define SD_RECORDER_FLUSH_BLOCKS 64 //update the directory entry every 32KB, so a power cut loses at most that
+#define SD_PLAYBACK_BUFFER_BLOCKS (2*SD_FRAME_BLOCKS + 2*SD_AUDIO_BLOCKS)
+#define SD_PLAYBACK_READS_PER_FRAME (SD_FRAME_BLOCKS + SD_AUDIO_BLOCKS) //a frame and a spectrum
+
+constexpr uint16_t sdRecordBlocks(uint16_t payload)
+{
+  return (SD_RECORD_HEADER + payload + SD_RECORDING_BLOCK - 1) / SD_RECORDING_BLOCK;
+}
+
+static_assert(SD_FRAME_PAYLOAD <= 0xFFFF, "too many LEDs for the u16 payload length of a frame record");
+static_assert(SD_RECORDER_BUFFER_BLOCKS <= 0xFF && SD_PLAYBACK_BUFFER_BLOCKS <= 0xFF, "too many LEDs for SDBlockRing");
+
+inline void sdPutU16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+inline void sdPutU32(uint8_t *p, uint32_t v)
+{
+  sdPutU16(p, v & 0xFFFF);
+  sdPutU16(p+2, v >> 16);
+}
+
+inline uint16_t sdGetU16(const uint8_t *p)
+{
+  return p[0] | static_cast<uint16_t>(p[1]) << 8;
+}
+
+inline uint32_t sdGetU32(const uint8_t *p)
+{
+  return sdGetU16(p) | static_cast<uint32_t>(sdGetU16(p+2)) << 16;
+}
+
+/// blocks in RAM, in file order, oldest first
+template <uint8_t BLOCKS>
+class SDBlockRing
+{
+private:
+  uint8_t data_[BLOCKS][SD_RECORDING_BLOCK];
+  uint8_t first_=0;
+  uint8_t used_=0;
+
+public:
+  uint8_t used() const { return used_; }
+  uint8_t freeBlocks() const { return BLOCKS - used_; }
+  void clear() { first_ = used_ = 0; }
+
+  /// n-th block from the oldest, n may be up to BLOCKS-1 (also blocks not pushed yet)
+  uint8_t *block(uint8_t n) { return data_[(first_ + n) % BLOCKS]; }
+
+  void push(uint8_t n) { used_ += n; }
+
+  void pop(uint8_t n)
+  {
+    first_ = (first_ + n) % BLOCKS;
+    used_ -= n;
+  }
+
+  /// copies len bytes at offset pos (from the start of the n-th block), across block boundaries
+  void copyOut(uint8_t n, uint16_t pos, void *dst, uint16_t len)
+  {
+    uint8_t *out = static_cast<uint8_t*>(dst);
+    while (len > 0)
+    {
+      uint8_t b = n + pos / SD_RECORDING_BLOCK;
+      uint16_t offset = pos % SD_RECORDING_BLOCK;
+      uint16_t chunk = min(len, static_cast<uint16_t>(SD_RECORDING_BLOCK - offset));
+      memcpy(out, block(b) + offset, chunk);
+      out += chunk;
+      pos += chunk;
+      len -= chunk;
+    }
+  }
+
+  void copyIn(uint8_t n, uint16_t pos, const void *src, uint16_t len)
+  {
+    const uint8_t *in = static_cast<const uint8_t*>(src);
+    while (len > 0)
+    {
+      uint8_t b = n + pos / SD_RECORDING_BLOCK;
+      uint16_t offset = pos % SD_RECORDING_BLOCK;
+      uint16_t chunk = min(len, static_cast<uint16_t>(SD_RECORDING_BLOCK - offset));
+      memcpy(block(b) + offset, in, chunk);
+      in += chunk;
+      pos += chunk;
+      len -= chunk;
+    }
+  }
+};
+
+class SDRecorder
+{
+private:
+  File file_;
+  bool active_=false;
+  SDBlockRing<SD_RECORDER_BUFFER_BLOCKS> ring_;
+  micros_t start_us_=0;
+  uint32_t seq_=0;
+  uint32_t audio_seen_=0;
+  uint32_t since_flush_=0;
+
+  uint32_t blocks_written_=0;
+  uint32_t frames_=0;
+  uint32_t audio_records_=0;
+  uint32_t dropped_=0;
+  uint32_t write_errors_=0;
+  micros_t max_write_us_=0;
+
+  /// queues the header, returns the ring index of the record or -1 if there is no room
+  int16_t beginRecord(uint8_t type, uint16_t payload_len, micros_t time_us)
+  {
+    if (!active_)
+      return -1;
+    //dropped records leave a gap in seq
+    uint32_t seq = seq_++;
+    uint8_t blocks = sdRecordBlocks(payload_len);
+    if (ring_.freeBlocks() < blocks)
+    {
+      dropped_++;
+      return -1;
+    }
+    uint8_t n = ring_.used();
+    for (uint8_t b=0; b<blocks; b++)
+      memset(ring_.block(n+b), 0, SD_RECORDING_BLOCK);
+    uint8_t *h = ring_.block(n);
+    h[0] = type;
+    sdPutU16(h+2, payload_len);
+    sdPutU32(h+4, time_us - start_us_);
+    sdPutU32(h+8, seq);
+    return n;
+  }
+
+  void writeBlock(const uint8_t *block)
+  {
+    micros_t t0 = micros();
+    if (file_.write(block, SD_RECORDING_BLOCK) != SD_RECORDING_BLOCK)
+      write_errors_++;
+    blocks_written_++;
+    if (++since_flush_ >= SD_RECORDER_FLUSH_BLOCKS)
+    {
+      file_.flush();
+      since_flush_ = 0;
+    }
+    max_write_us_ = max(max_write_us_, micros() - t0);
+  }
+
+public:
+  /// replaces filename
+  bool begin(const char *filename)
+  {
+    end();
+    if (SD.exists(filename))
+      SD.remove(filename);
+    file_ = SD.open(filename, FILE_WRITE);
+    if (!file_)
+      return false;
+    uint8_t header[SD_RECORDING_BLOCK] = {0};
+    memcpy(header, SD_RECORDING_MAGIC, 8);
+    sdPutU16(header+8, SD_RECORDING_VERSION);
+    sdPutU16(header+10, NUM_LEDS);
+    sdPutU16(header+12, FFT_BINS);
+    ring_.clear();
+    seq_ = 0;
+    since_flush_ = 0;
+    blocks_written_ = frames_ = audio_records_ = dropped_ = write_errors_ = 0;
+    max_write_us_ = 0;
+    writeBlock(header);
+    audio_seen_ = audio_features_.fft_seq;
+    start_us_ = micros();
+    active_ = true;
+    return true;
+  }
+
+  /// writes what is queued and closes the file
+  void end()
+  {
+    if (!active_)
+      return;
+    while (ring_.used() > 0)
+      service();
+    file_.close();
+    active_ = false;
+  }
+
+  bool active() const { return active_; }
+
+  /// shown: what StripLayout::show() returned, brightness: the animation's, before ambient and settings scaling
+  void recordFrame(const CRGB *shown, uint8_t brightness)
+  {
+    int16_t n = beginRecord(SD_RECORD_FRAME, SD_FRAME_PAYLOAD, micros());
+    if (n < 0)
+      return;
+    uint8_t *p = ring_.block(n) + SD_RECORD_HEADER;
+    p[0] = brightness;
+    p[1] = SD_FRAME_WIRE_ORDER;
+    sdPutU16(p+2, 0);
+    ring_.copyIn(n, SD_RECORD_HEADER + 4, shown, 3*NUM_LEDS);
+    ring_.push(sdRecordBlocks(SD_FRAME_PAYLOAD));
+    frames_++;
+  }
+
+  /// records the spectrum (and levels) if there is a new one
+  void recordAudio()
+  {
+    if (!active_ || audio_features_.fft_seq == audio_seen_)
+      return;
+    audio_seen_ = audio_features_.fft_seq;
+    int16_t n = beginRecord(SD_RECORD_AUDIO, SD_AUDIO_PAYLOAD, audio_features_.fft_capture_us);
+    if (n < 0)
+      return;
+    uint8_t *p = ring_.block(n) + SD_RECORD_HEADER;
+    sdPutU16(p, audio_features_.rms);
+    sdPutU16(p+2, audio_features_.peak);
+    sdPutU16(p+4, FFT_BINS);
+    for (uint16_t b=0; b<FFT_BINS; b++)
+    {
+      uint8_t le[2];
+      sdPutU16(le, audio_features_.fft[b]);
+      ring_.copyIn(n, SD_RECORD_HEADER + 6 + 2*b, le, 2);
+    }
+    ring_.push(sdRecordBlocks(SD_AUDIO_PAYLOAD));
+    audio_records_++;
+  }
+
+  /// writes one queued block
+  void service()
+  {
+    if (!active_ || 0 == ring_.used())
+      return;
+    writeBlock(ring_.block(0));
+    ring_.pop(1);
+  }
+
+  void printStats(Print &out)
+  {
+    out.print("# recorder frames ");
+    out.print(frames_);
+    out.print(" audio ");
+    out.print(audio_records_);
+    out.print(" dropped ");
+    out.print(dropped_);
+    out.print(" blocks ");
+    out.print(blocks_written_);
+    out.print(" write errors ");
+    out.print(write_errors_);
+    out.print(" max block write us ");
+    out.println(max_write_us_);
+  }
+};
+
+/// reads frame records with read ahead, loops at the end of the file
+class SDPlayback
+{
+private:
+  File file_;
+  bool open_=false;
+  SDBlockRing<SD_PLAYBACK_BUFFER_BLOCKS> ring_;
+  uint32_t underruns_=0;
+  uint32_t loops_=0;
+  uint32_t resyncs_=0;
+
+  /// blocks of the record starting at the n-th buffered block,
+  /// 0 if it can not be one (longer than the buffer: corrupt, or not a record boundary)
+  uint8_t recordBlocks(uint8_t n)
+  {
+    uint16_t blocks = sdRecordBlocks(sdGetU16(ring_.block(n)+2));
+    return (blocks > SD_PLAYBACK_BUFFER_BLOCKS) ? 0 : blocks;
+  }
+
+public:
+  /// false if the file is missing or not recorded for NUM_LEDS
+  bool begin(const char *filename)
+  {
+    end();
+    file_ = SD.open(filename);
+    if (!file_)
+      return false;
+    uint8_t header[16];
+    if (file_.read(header, sizeof(header)) != sizeof(header)
+      || 0 != memcmp(header, SD_RECORDING_MAGIC, 8)
+      || SD_RECORDING_VERSION != sdGetU16(header+8)
+      || NUM_LEDS != sdGetU16(header+10))
+    {
+      file_.close();
+      return false;
+    }
+    file_.seek(SD_RECORDING_BLOCK);
+    ring_.clear();
+    open_ = true;
+    return true;
+  }
+
+  void end()
+  {
+    if (open_)
+      file_.close();
+    open_ = false;
+  }
+
+  bool isOpen() const { return open_; }
+  uint32_t underruns() const { return underruns_; }
+  uint32_t loops() const { return loops_; }
+  uint32_t resyncs() const { return resyncs_; }
+
+  /// reads up to max_blocks blocks into free buffer space, rewinds at the end of the file
+  void readAhead(uint8_t max_blocks)
+  {
+    for (uint8_t r=0; open_ && r<max_blocks && ring_.freeBlocks() > 0; r++)
+    {
+      if (file_.read(ring_.block(ring_.used()), SD_RECORDING_BLOCK) != SD_RECORDING_BLOCK)
+      {
+        if (file_.position() <= SD_RECORDING_BLOCK)
+          return; //no records at all
+        file_.seek(SD_RECORDING_BLOCK);
+        loops_++;
+        continue;
+      }
+      ring_.push(1);
+    }
+  }
+
+  /// next frame into frame, false (frame untouched) if it is not buffered yet
+  bool nextFrame(CRGB *frame, ledctr_t &origin, uint8_t &brightness, uint8_t &flags, uint32_t &time_us)
+  {
+    for (;;)
+    {
+      if (0 == ring_.used())
+      {
+        underruns_++;
+        return false;
+      }
+      uint8_t blocks = recordBlocks(0);
+      if (0 == blocks)
+      {
+        //would never fit the buffer, waiting for it would stall forever.
+        //Records start at block boundaries, so look for one in the next block
+        ring_.pop(1);
+        resyncs_++;
+        continue;
+      }
+      if (blocks > ring_.used())
+      {
+        underruns_++;
+        return false;
+      }
+      const uint8_t *h = ring_.block(0);
+      if (SD_RECORD_FRAME == h[0] && sdGetU16(h+2) == SD_FRAME_PAYLOAD)
+      {
+        time_us = sdGetU32(h+4);
+        brightness = h[SD_RECORD_HEADER];
+        flags = h[SD_RECORD_HEADER+1];
+        origin = sdGetU16(h+SD_RECORD_HEADER+2) % NUM_LEDS;
+        ring_.copyOut(0, SD_RECORD_HEADER + 4, frame, 3*NUM_LEDS);
+        ring_.pop(blocks);
+        return true;
+      }
+      //audio or unknown record
+      ring_.pop(blocks);
+    }
+  }
+
+  /// time of the next buffered frame, false if none is buffered
+  bool peekFrameTime(uint32_t &time_us)
+  {
+    uint8_t n = 0;
+    while (n < ring_.used())
+    {
+      const uint8_t *h = ring_.block(n);
+      uint8_t blocks = recordBlocks(n);
+      if (0 == blocks)
+      {
+        n++; //skipped by nextFrame() too
+        continue;
+      }
+      if (SD_RECORD_FRAME == h[0])
+      {
+        time_us = sdGetU32(h+4);
+        return true;
+      }
+      n += blocks;
+    }
+    return false;
+  }
+};
+
+/// plays filename from SD card, in the timing it was recorded (or generated) with
+class AnimationSDPlayback : public BaseAnimation {
+private:
+  const char *filename_;
+  SDPlayback playback_;
+  uint32_t frame_time_us_=0;
+  millis_t delay_ms_=20;
+  uint32_t carry_us_=0;
+
+public:
+  AnimationSDPlayback(const char *filename) : filename_(filename) {}
+
+  virtual void init()
+  {
+    BaseAnimation::init();
+    carry_us_ = 0;
+    if (playback_.begin(filename_))
+      playback_.readAhead(SD_PLAYBACK_BUFFER_BLOCKS);
+  }
+
+  virtual millis_t run()
+  {
+    if (!playback_.isOpen())
+    {
+      //no file or recorded for another strip length: one dim red LED
+      fill_solid(leds_, NUM_LEDS, CRGB::Black);
+      leds_[0] = CRGB(40,0,0);
+      return 1000;
+    }
+    uint8_t brightness;
+    uint8_t flags;
+    ledctr_t origin;
+    if (playback_.nextFrame(leds_, origin, brightness, flags, frame_time_us_))
+    {
+      //recorded as it went out, StripLayout::show() will reverse those segments again
+      if (flags & SD_FRAME_WIRE_ORDER)
+        strip_layout_.reverseSegments(leds_);
+      leds_origin_ = origin;
+      FastLED.setBrightness(brightness);
+    }
+    playback_.readAhead(SD_PLAYBACK_READS_PER_FRAME);
+    //until the next frame is due, keep the last interval when the file loops or the card is behind
+    uint32_t next_us;
+    if (playback_.peekFrameTime(next_us) && next_us > frame_time_us_)
+    {
+      uint32_t interval_us = next_us - frame_time_us_ + carry_us_;
+      delay_ms_ = interval_us / 1000;
+      carry_us_ = interval_us % 1000;
+    }
+    return delay_ms_;
+  }
+
+  void printStats(Print &out)
+  {
+    out.print("# playback underruns ");
+    out.print(playback_.underruns());
+    out.print(" loops ");
+    out.print(playback_.loops());
+    out.print(" resyncs ");
+    out.println(playback_.resyncs());
+  }
+};
+
+#endif //SD_RECORDING_INCLUDE__H
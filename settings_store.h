@@ -0,0 +1,212 @@
+#ifndef SETTINGS_STORE_INCLUDE__H
+#define SETTINGS_STORE_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Keeps a settings struct in EEPROM without stalling the animations.
+///
+/// Log structured: the area is split into slots of one record each
+/// (magic, version, sequence number, the struct, CRC16). Every commit goes into the
+/// slot after the newest one, so writes are spread over the whole area (wear leveling)
+/// and the previous record stays valid until the new one is complete.
+/// load() picks the valid record with the highest sequence number.
+///
+/// Commits are deferred: changed() only marks the settings dirty, service() starts
+/// writing once nothing changed for SETTINGS_COMMIT_DELAY_MS (so a burst of button
+/// presses costs one record), and writes SETTINGS_BYTES_PER_SERVICE bytes per call.
+///
+/// The backing store is a template parameter: EEPROMSettingsBackend, or
+/// RamSettingsBackend to run without touching the EEPROM (and count writes).
+///
+/// // example use:
+/// struct Settings { uint8_t animation; uint8_t brightness; };
+/// Settings settings_ = {0, 255};
+/// SettingsStore<Settings, EEPROMSettingsBackend, 0, 2048> settings_store_(settings_, 1);
+/// settings_store_.load();
+/// settings_.brightness = 128;
+/// settings_store_.changed(millis());
+/// ...
+/// settings_store_.service(millis()); //from a task, every few ms
+///
+
+#define SETTINGS_MAGIC 0xA5
+#define SETTINGS_COMMIT_DELAY_MS 5000
+#define SETTINGS_BYTES_PER_SERVICE 4
+
+#ifdef EEPROM_h
+struct EEPROMSettingsBackend
+{
+  uint8_t read(uint16_t addr) { return EEPROM.read(addr); }
+  void write(uint16_t addr, uint8_t value) { EEPROM.update(addr, value); }
+};
+#endif
+
+/// emulated store in RAM, starts erased. Counts writes like EEPROM.update() does them, also per byte
+template <uint16_t SIZE>
+struct RamSettingsBackend
+{
+  uint8_t mem[SIZE];
+  uint32_t wear[SIZE];
+  uint32_t writes=0;
+
+  RamSettingsBackend()
+  {
+    memset(mem, 0xFF, SIZE);
+    memset(wear, 0, sizeof(wear));
+  }
+
+  uint8_t read(uint16_t addr) { return mem[addr]; }
+  void write(uint16_t addr, uint8_t value)
+  {
+    if (mem[addr] == value)
+      return;
+    mem[addr] = value;
+    wear[addr]++;
+    writes++;
+  }
+};
+
+/// CRC-16/CCITT-FALSE
+inline uint16_t settingsCRC16(const uint8_t *data, uint16_t len)
+{
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i=0; i<len; i++)
+  {
+    crc ^= static_cast<uint16_t>(data[i]) << 8;
+    for (uint8_t b=0; b<8; b++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+template <class Settings, class Backend, uint16_t START, uint16_t SIZE>
+class SettingsStore
+{
+private:
+  static const uint16_t HEADER = 4; //magic, version, seq lo, seq hi
+  static const uint16_t RECORD = HEADER + sizeof(Settings) + 2;
+  static const uint16_t SLOTS = SIZE / RECORD;
+  static_assert(SLOTS >= 2, "SettingsStore area has to hold at least two records");
+
+  Backend backend_;
+  Settings &settings_;
+  const uint8_t version_;
+  uint16_t newest_slot_=SLOTS-1; //so the first commit goes to slot 0
+  uint16_t seq_=0;
+  bool dirty_=false;
+  uint32_t changed_ms_=0;
+  bool writing_=false;
+  uint16_t write_slot_=0;
+  uint16_t write_pos_=0;
+  uint8_t record_[RECORD];
+  uint32_t commits_=0;
+
+  uint16_t slotAddr(uint16_t slot) const { return START + slot * RECORD; }
+
+  /// reads slot into record_, true if it holds a valid record of our version
+  bool readSlot(uint16_t slot)
+  {
+    for (uint16_t i=0; i<RECORD; i++)
+      record_[i] = backend_.read(slotAddr(slot) + i);
+    if (SETTINGS_MAGIC != record_[0] || version_ != record_[1])
+      return false;
+    uint16_t crc = record_[RECORD-2] | static_cast<uint16_t>(record_[RECORD-1]) << 8;
+    return crc == settingsCRC16(record_, RECORD-2);
+  }
+
+  uint16_t recordSeq() const
+  {
+    return record_[2] | static_cast<uint16_t>(record_[3]) << 8;
+  }
+
+public:
+  SettingsStore(Settings &settings, uint8_t version) : settings_(settings), version_(version) {}
+
+  Backend &backend() { return backend_; }
+
+  /// newest valid record into settings, false (settings untouched) if there is none
+  bool load()
+  {
+    bool found = false;
+    for (uint16_t slot=0; slot<SLOTS; slot++)
+    {
+      if (!readSlot(slot))
+        continue;
+      uint16_t seq = recordSeq();
+      if (found && static_cast<int16_t>(seq - seq_) <= 0)
+        continue;
+      found = true;
+      seq_ = seq;
+      newest_slot_ = slot;
+      memcpy(&settings_, record_ + HEADER, sizeof(Settings));
+    }
+    return found;
+  }
+
+  /// settings were modified, commit them once they stay unchanged for a while
+  void changed(uint32_t now_ms)
+  {
+    dirty_ = true;
+    changed_ms_ = now_ms;
+  }
+
+  /// call regularly, writes a few bytes if a commit is due or in progress
+  void service(uint32_t now_ms)
+  {
+    if (!writing_)
+    {
+      if (!dirty_ || now_ms - changed_ms_ < SETTINGS_COMMIT_DELAY_MS)
+        return;
+      //snapshot, later changes go into the next record
+      dirty_ = false;
+      record_[0] = SETTINGS_MAGIC;
+      record_[1] = version_;
+      record_[2] = (seq_ + 1) & 0xFF;
+      record_[3] = (seq_ + 1) >> 8;
+      memcpy(record_ + HEADER, &settings_, sizeof(Settings));
+      uint16_t crc = settingsCRC16(record_, RECORD-2);
+      record_[RECORD-2] = crc & 0xFF;
+      record_[RECORD-1] = crc >> 8;
+      write_slot_ = (newest_slot_ + 1) % SLOTS;
+      write_pos_ = 0;
+      writing_ = true;
+    }
+    //CRC goes last, so a record cut short by a reset does not validate
+    for (uint8_t n=0; n<SETTINGS_BYTES_PER_SERVICE && write_pos_ < RECORD; n++, write_pos_++)
+      backend_.write(slotAddr(write_slot_) + write_pos_, record_[write_pos_]);
+    if (write_pos_ < RECORD)
+      return;
+    writing_ = false;
+    newest_slot_ = write_slot_;
+    seq_++;
+    commits_++;
+  }
+
+  /// true while changes wait for or are in a commit
+  bool pending() const { return dirty_ || writing_; }
+
+  uint16_t seq() const { return seq_; }
+  uint16_t newestSlot() const { return newest_slot_; }
+  uint32_t commits() const { return commits_; }
+  static uint16_t slots() { return SLOTS; }
+  static uint16_t recordBytes() { return RECORD; }
+
+  void printStats(Print &out)
+  {
+    out.print("# settings slots ");
+    out.print(SLOTS);
+    out.print(" record bytes ");
+    out.print(RECORD);
+    out.print(" newest slot ");
+    out.print(newest_slot_);
+    out.print(" seq ");
+    out.print(seq_);
+    out.print(" commits since boot ");
+    out.print(commits_);
+    out.print(" pending ");
+    out.println(pending() ? 1 : 0);
+  }
+};
+
+#endif //SETTINGS_STORE_INCLUDE__H
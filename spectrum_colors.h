@@ -0,0 +1,86 @@
+#ifndef SPECTRUM_COLORS_INCLUDE__H
+#define SPECTRUM_COLORS_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Table based replacement for hsv2rgb_rainbow() in the spectrum animations.
+///
+/// hsv2rgb_rainbow() first picks a fully saturated, full brightness color for the hue,
+/// then scales it for saturation and value. The first step is a table lookup here,
+/// the second step is computed once per (sat, val) pair into a ColorScale and applied
+/// with three multiplies per pixel. Both steps together give the same result as
+/// hsv2rgb_rainbow() of FastLED 3.4+ (with FASTLED_SCALE8_FIXED).
+///
+/// // example use:
+/// ColorScale cs = colorScale(200, magnitude);
+/// leds_[l] = applyColorScale(rainbow_lut_.hue(h), cs);
+///
+
+class RainbowLUT
+{
+private:
+  CRGB hue_[256];
+
+public:
+  RainbowLUT()
+  {
+    for (uint16_t h=0; h<256; h++)
+    {
+      hsv2rgb_rainbow(CHSV(h,255,255), hue_[h]);
+    }
+  }
+
+  const CRGB &hue(uint8_t h) const { return hue_[h]; }
+};
+
+RainbowLUT rainbow_lut_;
+
+/// saturation and value stage of hsv2rgb_rainbow(), precomputed
+struct ColorScale
+{
+  uint8_t sat_scale;
+  uint8_t sat_floor;
+  uint8_t val_scale;
+};
+
+inline ColorScale colorScale(uint8_t sat, uint8_t val)
+{
+  uint8_t desat = scale8_video(255-sat, 255-sat);
+  ColorScale cs;
+  cs.sat_scale = 255 - desat;
+  cs.sat_floor = desat;
+  cs.val_scale = scale8_video(val, val);
+  return cs;
+}
+
+inline CRGB applyColorScale(const CRGB &c, const ColorScale &cs)
+{
+  return CRGB(
+    scale8(scale8(c.r, cs.sat_scale) + cs.sat_floor, cs.val_scale),
+    scale8(scale8(c.g, cs.sat_scale) + cs.sat_floor, cs.val_scale),
+    scale8(scale8(c.b, cs.sat_scale) + cs.sat_floor, cs.val_scale)
+  );
+}
+
+/// paints colors[0..n-1] to every second LED starting at dst and fills the LEDs
+/// in between with the average of both neighbours. Writes 2*n-1 LEDs.
+inline void paintSpectrumInterpolated(CRGB *dst, const CRGB *colors, uint8_t n)
+{
+  if (0 == n)
+    return;
+  dst[0] = colors[0];
+  for (uint8_t c=1; c<n; c++)
+  {
+    const CRGB &before = colors[c-1];
+    const CRGB &after = colors[c];
+    dst[2*c-1] = CRGB(
+      (static_cast<uint16_t>(before.r) + after.r) >> 1,
+      (static_cast<uint16_t>(before.g) + after.g) >> 1,
+      (static_cast<uint16_t>(before.b) + after.b) >> 1
+    );
+    dst[2*c] = after;
+  }
+}
+
+#endif //SPECTRUM_COLORS_INCLUDE__H
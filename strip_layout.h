@@ -0,0 +1,176 @@
+#ifndef STRIP_LAYOUT_INCLUDE__H
+#define STRIP_LAYOUT_INCLUDE__H
+
+//(c) Bernhard Tittelbach, xro@realraum.at, 2018
+//MIT license, except where code from other projects was borrowed and other licenses might apply
+
+/// Splits the one logical framebuffer the animations render into over several
+/// output pins. Every segment gets its own WS2812Serial controller, so segments
+/// on different serial ports transmit at the same time by DMA and the frame takes
+/// as long as the longest segment instead of the whole strip.
+/// Color order is a template parameter per segment, reversal is done when the
+/// frame is copied out, so animations never see either.
+///
+/// WS2812Serial pins on Teensy 3.2: 1 or 5 (Serial1), 10 or 31 (Serial2), 8 (Serial3).
+/// Two segments on the same serial port do not work.
+///
+/// // example use: 300 LEDs, second half mounted the other way round
+/// StripSegment strip_segments_[] = {
+///   //first, count, reversed
+///   {0, 150, false},
+///   {150, 150, true},
+/// };
+/// StripLayout strip_layout_(strip_segments_, 2);
+/// ...
+/// strip_layout_.attach<5,GRB>(0, leds_);
+/// strip_layout_.attach<8,RGB>(1, leds_);
+/// ...
+/// strip_layout_.show(leds_, leds_origin_, leds_out_);
+///
+
+#define STRIP_WIRE_NS_PER_LED 30000 //24 bits at 800kHz
+#define STRIP_WIRE_RESET_US 300
+
+struct StripSegment
+{
+  ledctr_t first;
+  ledctr_t count;
+  bool reversed;
+  CLEDController *controller;
+};
+
+class StripLayout
+{
+private:
+  StripSegment *segments_;
+  uint8_t num_segments_;
+  bool any_reversed_=false;
+
+  /// copies frame (rotated by origin, see RotatingStrip) into out in physical order,
+  /// reversing segments on the way. frame may be out if origin is 0.
+  void compose(const CRGB *frame, ledctr_t origin, CRGB *out)
+  {
+    if (frame == out)
+    {
+      for (uint8_t s=0; s<num_segments_; s++)
+      {
+        if (!segments_[s].reversed || segments_[s].count < 2)
+          continue;
+        CRGB *lo = out + segments_[s].first;
+        CRGB *hi = lo + segments_[s].count - 1;
+        for (; lo < hi; lo++, hi--)
+          std::swap(*lo, *hi);
+      }
+      return;
+    }
+    if (!any_reversed_)
+    {
+      resolveStripOrigin(frame, origin, out);
+      return;
+    }
+    for (uint8_t s=0; s<num_segments_; s++)
+    {
+      const StripSegment &seg = segments_[s];
+      ledctr_t src = (seg.first + NUM_LEDS - origin) % NUM_LEDS;
+      if (seg.reversed)
+      {
+        CRGB *dst = out + seg.first + seg.count - 1;
+        for (ledctr_t l=0; l<seg.count; l++, dst--)
+        {
+          *dst = frame[src];
+          if (++src == NUM_LEDS)
+            src = 0;
+        }
+      } else {
+        CRGB *dst = out + seg.first;
+        for (ledctr_t l=0; l<seg.count; l++, dst++)
+        {
+          *dst = frame[src];
+          if (++src == NUM_LEDS)
+            src = 0;
+        }
+      }
+    }
+  }
+
+public:
+  StripLayout(StripSegment *segments, uint8_t num_segments) : segments_(segments), num_segments_(num_segments)
+  {
+    for (uint8_t s=0; s<num_segments_; s++)
+    {
+      any_reversed_ |= segments_[s].reversed;
+    }
+  }
+
+  /// creates the WS2812Serial controller of segment s, call once per segment in setup()
+  template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+  void attach(uint8_t s, CRGB *frame)
+  {
+    segments_[s].controller = &FastLED.addLeds<WS2812SERIAL,DATA_PIN,RGB_ORDER>(frame + segments_[s].first, segments_[s].count);
+  }
+
+  /// reverses the reversed segments of frame in place, e.g. to turn what show() returned back into render order
+  void reverseSegments(CRGB *frame)
+  {
+    compose(frame, 0, frame);
+  }
+
+  /// hands the frame to the controllers and starts sending.
+  /// scratch is only written if the frame has to be rotated or reversed.
+  /// Returns the buffer that went out, in physical order.
+  const CRGB *show(CRGB *frame, ledctr_t origin, CRGB *scratch)
+  {
+    CRGB *out = frame;
+    if (any_reversed_ || origin != 0)
+    {
+      compose(frame, origin, scratch);
+      out = scratch;
+    }
+    for (uint8_t s=0; s<num_segments_; s++)
+    {
+      segments_[s].controller->setLeds(out + segments_[s].first, segments_[s].count);
+    }
+    FastLED.show();
+    return out;
+  }
+
+  /// time on the wire for one frame, segments send in parallel
+  static micros_t wireTimeUs(ledctr_t count)
+  {
+    return static_cast<uint64_t>(count) * STRIP_WIRE_NS_PER_LED / 1000 + STRIP_WIRE_RESET_US;
+  }
+
+  /// time until the last segment has sent a frame
+  micros_t frameWireUs() const
+  {
+    micros_t slowest = 0;
+    for (uint8_t s=0; s<num_segments_; s++)
+      slowest = max(slowest, wireTimeUs(segments_[s].count));
+    return slowest;
+  }
+
+  /// per segment transmit time and the resulting frame rate limit
+  void printTiming(Print &out)
+  {
+    out.println("# segment\tfirst\tcount\treversed\twire_us");
+    for (uint8_t s=0; s<num_segments_; s++)
+    {
+      micros_t wire_us = wireTimeUs(segments_[s].count);
+      out.print(s);
+      out.print('\t');
+      out.print(segments_[s].first);
+      out.print('\t');
+      out.print(segments_[s].count);
+      out.print('\t');
+      out.print(segments_[s].reversed ? 1 : 0);
+      out.print('\t');
+      out.println(wire_us);
+    }
+    out.print("# wire limited fps all segments ");
+    out.print(1000000UL / frameWireUs());
+    out.print(" single pin ");
+    out.println(1000000UL / wireTimeUs(NUM_LEDS));
+  }
+};
+
+#endif //STRIP_LAYOUT_INCLUDE__H
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+# (c) Bernhard Tittelbach, xro@realraum.at, 2018
+# MIT license
+"""Decodes the frame stream of frame_stream.h (Serial command v or V).
+
+Reads from a serial port (needs pyserial) or a file / stdin ("-") with a capture,
+prints frames/s, bandwidth, compression and dropped frames once per second.
+Text lines the sketch prints in between (starting with #) go to stderr.
+
+  ./frame_stream_decode.py /dev/ttyACM0 --send v
+  ./frame_stream_decode.py /dev/ttyACM0 --send V --preview
+  ./frame_stream_decode.py capture.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+SYNC = b"\xa5\x5a"
+KEYFRAME, DELTA, AUDIO = 1, 2, 3
+OP_SKIP, OP_LITERAL, OP_RUN = 0, 1, 2
+HEADER = 7  # sync, type, seq, length
+
+
+def fletcher16(data):
+    s1 = s2 = 0
+    for b in data:
+        s1 = (s1 + b) % 255
+        s2 = (s2 + s1) % 255
+    return s1, s2
+
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.frame = None
+        self.brightness = 255
+        self.audio = None
+        self.last_seq = None
+        self.waiting_for_keyframe = True
+        self.text = bytearray()
+        self.reset_stats()
+
+    def reset_stats(self):
+        self.frames = 0
+        self.dropped = 0
+        self.bad = 0
+        self.bytes = 0
+        self.raw_bytes = 0
+        self.audio_packets = 0
+
+    def feed(self, data):
+        """yields ("frame", rgb list) and ("audio", (rms, peak, bins)) as they complete"""
+        self.buf += data
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self._text(self.buf[:len(self.buf) - keep])
+                del self.buf[:len(self.buf) - keep]
+                return
+            self._text(self.buf[:start])
+            del self.buf[:start]
+            if len(self.buf) < HEADER:
+                return
+            ptype, seq, length = struct.unpack_from("<BHH", self.buf, 2)
+            if ptype not in (KEYFRAME, DELTA, AUDIO):
+                self._skip_sync()
+                continue
+            if len(self.buf) < HEADER + length + 2:
+                return
+            packet = bytes(self.buf[2:HEADER + length])
+            if tuple(self.buf[HEADER + length:HEADER + length + 2]) != fletcher16(packet):
+                # cut short on the device, or not a packet at all
+                self.bad += 1
+                self._skip_sync()
+                continue
+            del self.buf[:HEADER + length + 2]
+            self.bytes += HEADER + length + 2
+            payload = packet[5:]
+            if ptype == AUDIO:
+                yield self._audio(payload)
+            else:
+                result = self._frame(ptype, seq, payload)
+                if result:
+                    yield result
+
+    def _skip_sync(self):
+        del self.buf[:1]
+
+    def _text(self, data):
+        self.text += data
+        while b"\n" in self.text:
+            line, _, rest = bytes(self.text).partition(b"\n")
+            self.text = bytearray(rest)
+            line = line.strip(b"\r")
+            if line.startswith(b"#"):
+                sys.stderr.write(line.decode("ascii", "replace") + "\n")
+        if len(self.text) > 1024:
+            self.text.clear()
+
+    def _audio(self, payload):
+        rms, peak, n = struct.unpack_from("<HHB", payload)
+        bins = struct.unpack_from("<%dH" % n, payload, 5)
+        self.audio = (rms, peak, bins)
+        self.audio_packets += 1
+        return ("audio", self.audio)
+
+    def _frame(self, ptype, seq, payload):
+        if self.last_seq is not None:
+            self.dropped += (seq - self.last_seq - 1) & 0xFFFF
+        self.last_seq = seq
+        num_leds, brightness = struct.unpack_from("<HB", payload)
+        if ptype == KEYFRAME:
+            self.waiting_for_keyframe = False
+            self.frame = [(0, 0, 0)] * num_leds
+        elif self.waiting_for_keyframe or self.frame is None or len(self.frame) != num_leds:
+            return None
+        pos, led = 3, 0
+        frame = self.frame
+        while led < num_leds and pos < len(payload):
+            op = payload[pos]
+            kind, count = op >> 6, (op & 0x3F) + 1
+            pos += 1
+            if kind == OP_SKIP:
+                if ptype == KEYFRAME:
+                    raise ValueError("skip in keyframe")
+            elif kind == OP_LITERAL:
+                for i in range(count):
+                    frame[led + i] = tuple(payload[pos:pos + 3])
+                    pos += 3
+            elif kind == OP_RUN:
+                rgb = tuple(payload[pos:pos + 3])
+                pos += 3
+                for i in range(count):
+                    frame[led + i] = rgb
+            else:
+                raise ValueError("unknown op %02x" % op)
+            led += count
+        self.brightness = brightness
+        self.frames += 1
+        self.raw_bytes += 3 * num_leds
+        return ("frame", frame)
+
+
+def preview(frame, brightness, width):
+    """one line of 24bit color blocks, LEDs averaged down to the terminal width"""
+    step = max(1, (len(frame) + width - 1) // width)
+    out = []
+    for i in range(0, len(frame), step):
+        group = frame[i:i + step]
+        r, g, b = (sum(c[k] for c in group) * brightness // (255 * len(group)) for k in range(3))
+        out.append("\x1b[48;2;%d;%d;%dm " % (r, g, b))
+    return "\r" + "".join(out) + "\x1b[0m"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="serial port, capture file or - for stdin")
+    parser.add_argument("--send", help="command to send to the serial port first, e.g. v or V")
+    parser.add_argument("--save", help="also write everything received to this file")
+    parser.add_argument("--preview", action="store_true", help="show the strip in the terminal")
+    parser.add_argument("--width", type=int, default=150, help="preview width in characters")
+    args = parser.parse_args()
+
+    port = None
+    if args.source == "-":
+        read = sys.stdin.buffer.read1 if hasattr(sys.stdin.buffer, "read1") else sys.stdin.buffer.read
+    elif args.source.startswith("/dev/") or args.source.upper().startswith("COM"):
+        import serial
+        port = serial.Serial(args.source, timeout=0.1)
+        if args.send:
+            port.write(args.send.encode("ascii"))
+        read = lambda n: port.read(max(1, min(n, port.in_waiting)))
+    else:
+        f = open(args.source, "rb")
+        read = f.read
+    save = open(args.save, "wb") if args.save else None
+
+    decoder = Decoder()
+    started = last_report = time.monotonic()
+    try:
+        while True:
+            data = read(65536)
+            if not data and port is None:
+                break
+            if save:
+                save.write(data)
+            for kind, value in decoder.feed(data):
+                if kind == "frame" and args.preview:
+                    sys.stdout.write(preview(value, decoder.brightness, args.width))
+                    sys.stdout.flush()
+            now = time.monotonic()
+            if port is not None and now - last_report >= 1.0:
+                report(decoder, now - last_report, args.preview)
+                decoder.reset_stats()
+                last_report = now
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if port is not None and args.send:
+            port.write(args.send.encode("ascii"))  # same command stops the stream
+    if port is None:
+        report(decoder, None, False)
+
+
+def report(d, seconds, newline):
+    ratio = d.bytes / d.raw_bytes if d.raw_bytes else 0
+    line = "frames %d dropped %d bad %d audio %d bytes %d (%.0f%% of raw)" % (
+        d.frames, d.dropped, d.bad, d.audio_packets, d.bytes, 100 * ratio)
+    if seconds:
+        line += " | %.1f fps %.1f kB/s" % (d.frames / seconds, d.bytes / seconds / 1000)
+    sys.stderr.write(("\n" if newline else "") + line + "\n")
+
+
+if __name__ == "__main__":
+    main()
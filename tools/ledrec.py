@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+# (c) Bernhard Tittelbach, xro@realraum.at, 2018
+# MIT license
+"""Reads and writes the SD card recordings of sd_recording.h.
+
+  ./ledrec.py info RECORD.LED             header, record counts, duration, frame rate
+  ./ledrec.py dump RECORD.LED             one line per record
+  ./ledrec.py generate SHOW.LED --leds 150 --fps 100 --seconds 60 --pattern plasma
+  ./ledrec.py bench SHOW.LED              parse speed, and the read rate playback needs
+
+Copy a generated file to the SD card as SHOW.LED and select the playback animation.
+"""
+
+import argparse
+import math
+import struct
+import sys
+import time
+
+BLOCK = 512
+MAGIC = b"WSLEDREC"
+VERSION = 1
+FRAME, AUDIO = 1, 2
+RECORD_HEADER = struct.Struct("<BBHII")  # type, reserved, payload length, time us, seq
+FRAME_HEADER = struct.Struct("<BBH")  # brightness, flags, origin
+WIRE_ORDER = 0x01  # frame flag: as it went out to the strip, reversed segments already reversed
+AUDIO_HEADER = struct.Struct("<HHH")  # rms, peak, bins
+
+
+def padded(data):
+    return data + bytes(-len(data) % BLOCK)
+
+
+class Writer:
+    def __init__(self, f, num_leds, fft_bins=128):
+        self.f = f
+        self.num_leds = num_leds
+        self.fft_bins = fft_bins
+        self.seq = 0
+        f.write(padded(MAGIC + struct.pack("<HHH", VERSION, num_leds, fft_bins)))
+
+    def _record(self, rtype, time_us, payload):
+        self.f.write(padded(RECORD_HEADER.pack(rtype, 0, len(payload), time_us & 0xFFFFFFFF, self.seq) + payload))
+        self.seq += 1
+
+    def frame(self, time_us, rgb, brightness=255, origin=0):
+        """rgb: bytes of 3*num_leds"""
+        assert len(rgb) == 3 * self.num_leds
+        self._record(FRAME, time_us, FRAME_HEADER.pack(brightness, 0, origin) + bytes(rgb))
+
+    def audio(self, time_us, rms, peak, bins):
+        self._record(AUDIO, time_us, AUDIO_HEADER.pack(rms, peak, len(bins)) + struct.pack("<%dH" % len(bins), *bins))
+
+
+class Frame:
+    __slots__ = ("seq", "time_us", "brightness", "flags", "origin", "rgb")
+
+
+class Audio:
+    __slots__ = ("seq", "time_us", "rms", "peak", "bins")
+
+
+class Reader:
+    def __init__(self, f):
+        self.f = f
+        header = f.read(BLOCK)
+        if len(header) < 14 or header[:8] != MAGIC:
+            raise ValueError("not a recording")
+        self.version, self.num_leds, self.fft_bins = struct.unpack_from("<HHH", header, 8)
+        if self.version != VERSION:
+            raise ValueError("version %d, expected %d" % (self.version, VERSION))
+
+    def __iter__(self):
+        while True:
+            block = self.f.read(BLOCK)
+            if len(block) < BLOCK:
+                return
+            rtype, _, length, time_us, seq = RECORD_HEADER.unpack_from(block)
+            blocks = (RECORD_HEADER.size + length + BLOCK - 1) // BLOCK
+            if blocks > 1:
+                block += self.f.read((blocks - 1) * BLOCK)
+                if len(block) < blocks * BLOCK:
+                    return  # cut short, e.g. power lost while recording
+            payload = block[RECORD_HEADER.size:RECORD_HEADER.size + length]
+            if rtype == FRAME:
+                r = Frame()
+                r.brightness, r.flags, r.origin = FRAME_HEADER.unpack_from(payload)
+                r.rgb = payload[FRAME_HEADER.size:]
+            elif rtype == AUDIO:
+                r = Audio()
+                r.rms, r.peak, n = AUDIO_HEADER.unpack_from(payload)
+                r.bins = struct.unpack_from("<%dH" % n, payload, AUDIO_HEADER.size)
+            else:
+                continue
+            r.seq, r.time_us = seq, time_us
+            yield r
+
+
+def cmd_info(args):
+    with open(args.file, "rb") as f:
+        reader = Reader(f)
+        frames = audio = 0
+        first = last = None
+        seq_gaps = 0
+        prev_seq = None
+        for r in reader:
+            if isinstance(r, Frame):
+                frames += 1
+                first = r.time_us if first is None else first
+                last = r.time_us
+            else:
+                audio += 1
+            if prev_seq is not None and r.seq != prev_seq + 1:
+                seq_gaps += 1
+            prev_seq = r.seq
+        size = f.tell()
+    print("leds %d fft bins %d version %d" % (reader.num_leds, reader.fft_bins, reader.version))
+    print("frames %d audio records %d bytes %d seq gaps %d" % (frames, audio, size, seq_gaps))
+    if frames > 1:
+        seconds = (last - first) / 1e6
+        print("duration %.2fs frame rate %.1f/s" % (seconds, (frames - 1) / seconds if seconds else 0))
+
+
+def cmd_dump(args):
+    with open(args.file, "rb") as f:
+        for r in Reader(f):
+            if isinstance(r, Frame):
+                lit = sum(1 for i in range(0, len(r.rgb), 3) if any(r.rgb[i:i + 3]))
+                order = "wire" if r.flags & WIRE_ORDER else "render"
+                print("%d\t%d\tframe\tbrightness %d origin %d %s order lit %d" % (r.seq, r.time_us, r.brightness, r.origin, order, lit))
+            else:
+                top = max(range(len(r.bins)), key=lambda b: r.bins[b]) if r.bins else 0
+                print("%d\t%d\taudio\trms %d peak %d loudest bin %d" % (r.seq, r.time_us, r.rms, r.peak, top))
+
+
+def hsv(h, s, v):
+    """h, s, v 0..1 to an RGB tuple 0..255"""
+    i = int(h * 6) % 6
+    f = h * 6 - int(h * 6)
+    p, q, t = v * (1 - s), v * (1 - f * s), v * (1 - (1 - f) * s)
+    r, g, b = ((v, t, p), (q, v, p), (p, v, t), (p, q, v), (t, p, v), (v, p, q))[i]
+    return int(r * 255), int(g * 255), int(b * 255)
+
+
+PATTERNS = {
+    "rainbow": lambda l, n, t: hsv((l / n + t / 4) % 1, 1, 1),
+    "plasma": lambda l, n, t: hsv((math.sin(l / 7 + t) + math.sin(l / 13 - t * 1.7) + 2) / 4 % 1, 1,
+                                  0.5 + 0.5 * math.sin(l / 5 - t * 3)),
+    "chase": lambda l, n, t: (255, 255, 255) if l == int(t * 30) % n else (0, 0, 0),
+}
+
+
+def cmd_generate(args):
+    pattern = PATTERNS[args.pattern]
+    period_us = 1000000 // args.fps
+    with open(args.file, "wb") as f:
+        w = Writer(f, args.leds)
+        for i in range(int(args.seconds * args.fps)):
+            t = i / args.fps
+            rgb = bytearray()
+            for l in range(args.leds):
+                rgb.extend(pattern(l, args.leds, t))
+            w.frame(i * period_us, rgb, args.brightness)
+        size = f.tell()
+    print("%d frames, %d bytes" % (w.seq, size))
+
+
+def cmd_bench(args):
+    with open(args.file, "rb") as f:
+        start = time.perf_counter()
+        reader = Reader(f)
+        frames = 0
+        first = last = None
+        for r in reader:
+            if isinstance(r, Frame):
+                frames += 1
+                first = r.time_us if first is None else first
+                last = r.time_us
+        seconds = time.perf_counter() - start
+        size = f.tell()
+    print("parsed %d bytes in %.3fs: %.1f MB/s %.0f frames/s" % (size, seconds, size / seconds / 1e6, frames / seconds))
+    if frames > 1 and last > first:
+        needed = size / ((last - first) / 1e6)
+        print("playback needs %.1f kB/s from the card (%.0f blocks/s)" % (needed / 1e3, needed / BLOCK))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command")
+    sub.required = True
+    for name in ("info", "dump", "bench"):
+        p = sub.add_parser(name)
+        p.add_argument("file")
+    p = sub.add_parser("generate")
+    p.add_argument("file")
+    p.add_argument("--leds", type=int, default=150)
+    p.add_argument("--fps", type=int, default=100)
+    p.add_argument("--seconds", type=float, default=10)
+    p.add_argument("--brightness", type=int, default=80)
+    p.add_argument("--pattern", choices=sorted(PATTERNS), default="plasma")
+    args = parser.parse_args()
+    globals()["cmd_" + args.command](args)
+
+
+if __name__ == "__main__":
+    main()